@@ -0,0 +1,483 @@
+#include "assetpack.hpp"
+#include "texturecache.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+std::unordered_map<std::string, AssetPack::Entry> AssetPack::sEntries;
+const unsigned char* AssetPack::sData = 0;
+size_t AssetPack::sSize = 0;
+
+#ifdef _WIN32
+static HANDLE sFile = INVALID_HANDLE_VALUE;
+static HANDLE sMapping = 0;
+#endif
+
+// NOTE: Header is magic, version, entry count. Index entries are path length, path,
+// offset, size and hash. Fields are read with memcpy since the index isn't aligned
+template<typename T> static bool
+readField(const unsigned char*& cursor, const unsigned char* end, T& value) {
+    if ((size_t)(end - cursor) < sizeof(T)) {
+        return false;
+    }
+    memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+template<typename T> static void
+writeField(std::ofstream& out, T value) {
+    out.write((const char*)&value, sizeof(T));
+}
+
+bool
+AssetPack::map(const std::string& packPath) {
+#ifdef _WIN32
+    sFile = CreateFileA(packPath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+    if (sFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(sFile, &FileSize) || FileSize.QuadPart == 0) {
+        unmap();
+        return false;
+    }
+
+    sMapping = CreateFileMappingA(sFile, 0, PAGE_READONLY, 0, 0, 0);
+    if (!sMapping) {
+        unmap();
+        return false;
+    }
+
+    sData = (const unsigned char*)MapViewOfFile(sMapping, FILE_MAP_READ, 0, 0, 0);
+    sSize = (size_t)FileSize.QuadPart;
+#else
+    int File = open(packPath.c_str(), O_RDONLY);
+    if (File < 0) {
+        return false;
+    }
+
+    struct stat Info;
+    if (fstat(File, &Info) != 0 || Info.st_size == 0) {
+        close(File);
+        return false;
+    }
+
+    void* Mapped = mmap(0, (size_t)Info.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    // NOTE: The mapping keeps its own reference to the file
+    close(File);
+    if (Mapped == MAP_FAILED) {
+        return false;
+    }
+
+    sData = (const unsigned char*)Mapped;
+    sSize = (size_t)Info.st_size;
+#endif
+    if (!sData) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+void
+AssetPack::unmap() {
+#ifdef _WIN32
+    if (sData) {
+        UnmapViewOfFile(sData);
+    }
+    if (sMapping) {
+        CloseHandle(sMapping);
+        sMapping = 0;
+    }
+    if (sFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(sFile);
+        sFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (sData) {
+        munmap((void*)sData, sSize);
+    }
+#endif
+    sData = 0;
+    sSize = 0;
+}
+
+bool
+AssetPack::Open(const std::string& packPath) {
+    Close();
+    if (!map(packPath)) {
+        std::cout << "No asset pack at " << packPath << ", loading loose files" << std::endl;
+        return false;
+    }
+
+    const unsigned char* Cursor = sData;
+    const unsigned char* End = sData + sSize;
+    uint32_t Magic = 0, Version = 0, EntryCount = 0;
+    if (!readField(Cursor, End, Magic) || !readField(Cursor, End, Version) || !readField(Cursor, End, EntryCount)
+        || Magic != MAGIC || Version != VERSION) {
+        std::cerr << "[Err] Invalid asset pack " << packPath << ", loading loose files" << std::endl;
+        Close();
+        return false;
+    }
+
+    sEntries.reserve(EntryCount);
+    for (uint32_t EntryIdx = 0; EntryIdx < EntryCount; ++EntryIdx) {
+        uint32_t PathLength = 0;
+        Entry CurrEntry;
+        bool Valid = readField(Cursor, End, PathLength) && (size_t)(End - Cursor) >= PathLength;
+        std::string Path;
+        if (Valid) {
+            Path.assign((const char*)Cursor, PathLength);
+            Cursor += PathLength;
+            Valid = readField(Cursor, End, CurrEntry.Offset) && readField(Cursor, End, CurrEntry.Size)
+                && readField(Cursor, End, CurrEntry.Hash);
+        }
+        if (!Valid || CurrEntry.Offset > sSize || CurrEntry.Size > sSize - CurrEntry.Offset) {
+            std::cerr << "[Err] Corrupt asset pack index in " << packPath << ", loading loose files" << std::endl;
+            Close();
+            return false;
+        }
+        sEntries[Path] = CurrEntry;
+    }
+
+    std::cout << "Mapped asset pack " << packPath << ": " << sEntries.size() << " files, "
+        << sSize / 1024 << " KB" << std::endl;
+    return true;
+}
+
+void
+AssetPack::Close() {
+    sEntries.clear();
+    unmap();
+}
+
+bool
+AssetPack::IsOpen() {
+    return sData != 0;
+}
+
+bool
+AssetPack::Find(const std::string& filePath, View& view) {
+    if (!sData) {
+        return false;
+    }
+
+    auto It = sEntries.find(TextureCache::NormalizePath(filePath));
+    if (It == sEntries.end()) {
+        return false;
+    }
+
+    view.Data = sData + It->second.Offset;
+    view.Size = (size_t)It->second.Size;
+    view.Hash = It->second.Hash;
+    return true;
+}
+
+std::vector<std::string>
+AssetPack::GetPaths() {
+    std::vector<std::string> Paths;
+    Paths.reserve(sEntries.size());
+    for (const auto& It : sEntries) {
+        Paths.push_back(It.first);
+    }
+    std::sort(Paths.begin(), Paths.end());
+    return Paths;
+}
+
+uint64_t
+AssetPack::HashBytes(const unsigned char* data, size_t size) {
+    uint64_t Hash = 14695981039346656037ull;
+    for (size_t Idx = 0; Idx < size; ++Idx) {
+        Hash ^= data[Idx];
+        Hash *= 1099511628211ull;
+    }
+    return Hash;
+}
+
+void
+AssetPack::ListFiles(const std::string& directory, std::vector<std::string>& files) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA FindData;
+    HANDLE Find = FindFirstFileA((directory + "/*").c_str(), &FindData);
+    if (Find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        std::string Name = FindData.cFileName;
+        if (Name == "." || Name == "..") {
+            continue;
+        }
+        if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            ListFiles(directory + "/" + Name, files);
+        } else {
+            files.push_back(directory + "/" + Name);
+        }
+    } while (FindNextFileA(Find, &FindData));
+    FindClose(Find);
+#else
+    DIR* Dir = opendir(directory.c_str());
+    if (!Dir) {
+        return;
+    }
+    for (dirent* DirEntry = readdir(Dir); DirEntry; DirEntry = readdir(Dir)) {
+        std::string Name = DirEntry->d_name;
+        if (Name == "." || Name == "..") {
+            continue;
+        }
+        std::string Path = directory + "/" + Name;
+        struct stat Info;
+        if (stat(Path.c_str(), &Info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(Info.st_mode)) {
+            ListFiles(Path, files);
+        } else {
+            files.push_back(Path);
+        }
+    }
+    closedir(Dir);
+#endif
+}
+
+bool
+AssetPack::Build(const std::string& packPath, const std::vector<std::string>& directories) {
+    std::vector<std::string> Files;
+    for (const std::string& Directory : directories) {
+        ListFiles(Directory, Files);
+    }
+    // NOTE: Mesh caches are keyed by loose source file timestamps and are rebuilt next to the model
+    Files.erase(std::remove_if(Files.begin(), Files.end(), [](const std::string& path) {
+        const std::string Extension = ".meshcache";
+        return path.size() >= Extension.size() && path.compare(path.size() - Extension.size(), Extension.size(), Extension) == 0;
+    }), Files.end());
+    std::sort(Files.begin(), Files.end());
+
+    std::vector<std::string> Paths(Files.size());
+    std::vector<std::vector<unsigned char>> Contents;
+    std::vector<Entry> Entries(Files.size());
+    std::unordered_map<uint64_t, size_t> ContentIndices;
+    std::vector<size_t> ContentOf(Files.size());
+    size_t IndexSize = 3 * sizeof(uint32_t);
+    for (size_t FileIdx = 0; FileIdx < Files.size(); ++FileIdx) {
+        std::ifstream In(Files[FileIdx], std::ios::binary);
+        if (!In) {
+            std::cerr << "[Err] Failed to read " << Files[FileIdx] << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> Data((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+
+        Paths[FileIdx] = TextureCache::NormalizePath(Files[FileIdx]);
+        Entries[FileIdx].Size = Data.size();
+        Entries[FileIdx].Hash = HashBytes(Data.data(), Data.size());
+        IndexSize += sizeof(uint32_t) + Paths[FileIdx].size() + 3 * sizeof(uint64_t);
+
+        auto It = ContentIndices.find(Entries[FileIdx].Hash);
+        if (It != ContentIndices.end() && Contents[It->second] == Data) {
+            ContentOf[FileIdx] = It->second;
+            continue;
+        }
+        ContentIndices[Entries[FileIdx].Hash] = Contents.size();
+        ContentOf[FileIdx] = Contents.size();
+        Contents.push_back(std::move(Data));
+    }
+
+    std::vector<uint64_t> ContentOffsets(Contents.size());
+    uint64_t Offset = IndexSize;
+    for (size_t ContentIdx = 0; ContentIdx < Contents.size(); ++ContentIdx) {
+        Offset = (Offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+        ContentOffsets[ContentIdx] = Offset;
+        Offset += Contents[ContentIdx].size();
+    }
+
+    std::ofstream Out(packPath, std::ios::binary);
+    if (!Out) {
+        std::cerr << "[Err] Failed to write asset pack " << packPath << std::endl;
+        return false;
+    }
+
+    writeField(Out, MAGIC);
+    writeField(Out, VERSION);
+    writeField(Out, (uint32_t)Files.size());
+    for (size_t FileIdx = 0; FileIdx < Files.size(); ++FileIdx) {
+        writeField(Out, (uint32_t)Paths[FileIdx].size());
+        Out.write(Paths[FileIdx].data(), Paths[FileIdx].size());
+        writeField(Out, ContentOffsets[ContentOf[FileIdx]]);
+        writeField(Out, Entries[FileIdx].Size);
+        writeField(Out, Entries[FileIdx].Hash);
+    }
+
+    const char Padding[DATA_ALIGNMENT] = { 0 };
+    uint64_t Written = IndexSize;
+    for (size_t ContentIdx = 0; ContentIdx < Contents.size(); ++ContentIdx) {
+        Out.write(Padding, (std::streamsize)(ContentOffsets[ContentIdx] - Written));
+        Out.write((const char*)Contents[ContentIdx].data(), Contents[ContentIdx].size());
+        Written = ContentOffsets[ContentIdx] + Contents[ContentIdx].size();
+    }
+
+    if (!Out) {
+        std::cerr << "[Err] Failed to write asset pack " << packPath << std::endl;
+        return false;
+    }
+    std::cout << "Packed " << Files.size() << " files (" << Files.size() - Contents.size()
+        << " duplicates) into " << packPath << ": " << Written / 1024 << " KB" << std::endl;
+    return true;
+}
+
+void
+AssetPack::DropFromFileCache(const std::string& filePath) {
+#ifdef _WIN32
+    // NOTE: Opening a file unbuffered makes Windows purge its cached pages
+    HANDLE File = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, 0);
+    if (File != INVALID_HANDLE_VALUE) {
+        CloseHandle(File);
+    }
+#else
+    int File = open(filePath.c_str(), O_RDONLY);
+    if (File >= 0) {
+        posix_fadvise(File, 0, 0, POSIX_FADV_DONTNEED);
+        close(File);
+    }
+#endif
+}
+
+bool
+AssetPack::IOSystem::Exists(const char* filePath) const {
+    View Packed;
+    if (Find(filePath, Packed)) {
+        return true;
+    }
+    FILE* File = fopen(filePath, "rb");
+    if (File) {
+        fclose(File);
+    }
+    return File != 0;
+}
+
+char
+AssetPack::IOSystem::getOsSeparator() const {
+    return '/';
+}
+
+Assimp::IOStream*
+AssetPack::IOSystem::Open(const char* filePath, const char* mode) {
+    View Packed;
+    if (!strchr(mode, 'w') && Find(filePath, Packed)) {
+        return new AssetPack::IOStream(Packed);
+    }
+    // NOTE: Not packed, e.g. a material file added after the pack was built
+    FILE* File = fopen(filePath, mode);
+    return File ? new AssetPack::FileStream(File) : 0;
+}
+
+void
+AssetPack::IOSystem::Close(Assimp::IOStream* stream) {
+    // NOTE: Pack views own nothing, disk streams close their file when deleted
+    delete stream;
+}
+
+AssetPack::IOStream::IOStream(const View& view) : mView(view), mPosition(0) {}
+
+size_t
+AssetPack::IOStream::Read(void* buffer, size_t size, size_t count) {
+    if (size == 0) {
+        return 0;
+    }
+    size_t Count = std::min(count, (mView.Size - mPosition) / size);
+    memcpy(buffer, mView.Data + mPosition, Count * size);
+    mPosition += Count * size;
+    return Count;
+}
+
+size_t
+AssetPack::IOStream::Write(const void* /*buffer*/, size_t /*size*/, size_t /*count*/) {
+    return 0;
+}
+
+aiReturn
+AssetPack::IOStream::Seek(size_t offset, aiOrigin origin) {
+    size_t Position = 0;
+    switch (origin) {
+    case aiOrigin_SET: Position = offset; break;
+    case aiOrigin_CUR: Position = mPosition + offset; break;
+    case aiOrigin_END: Position = mView.Size - offset; break;
+    default: return aiReturn_FAILURE;
+    }
+    if (Position > mView.Size) {
+        return aiReturn_FAILURE;
+    }
+    mPosition = Position;
+    return aiReturn_SUCCESS;
+}
+
+size_t
+AssetPack::IOStream::Tell() const {
+    return mPosition;
+}
+
+size_t
+AssetPack::IOStream::FileSize() const {
+    return mView.Size;
+}
+
+void
+AssetPack::IOStream::Flush() {}
+
+AssetPack::FileStream::FileStream(FILE* file) : mFile(file) {}
+
+AssetPack::FileStream::~FileStream() {
+    fclose(mFile);
+}
+
+size_t
+AssetPack::FileStream::Read(void* buffer, size_t size, size_t count) {
+    return fread(buffer, size, count, mFile);
+}
+
+size_t
+AssetPack::FileStream::Write(const void* buffer, size_t size, size_t count) {
+    return fwrite(buffer, size, count, mFile);
+}
+
+aiReturn
+AssetPack::FileStream::Seek(size_t offset, aiOrigin origin) {
+    int Origin = 0;
+    switch (origin) {
+    case aiOrigin_SET: Origin = SEEK_SET; break;
+    case aiOrigin_CUR: Origin = SEEK_CUR; break;
+    case aiOrigin_END: Origin = SEEK_END; break;
+    default: return aiReturn_FAILURE;
+    }
+    return fseek(mFile, (long)offset, Origin) == 0 ? aiReturn_SUCCESS : aiReturn_FAILURE;
+}
+
+size_t
+AssetPack::FileStream::Tell() const {
+    return (size_t)ftell(mFile);
+}
+
+size_t
+AssetPack::FileStream::FileSize() const {
+    long Position = ftell(mFile);
+    fseek(mFile, 0, SEEK_END);
+    long Size = ftell(mFile);
+    fseek(mFile, Position, SEEK_SET);
+    return (size_t)Size;
+}
+
+void
+AssetPack::FileStream::Flush() {
+    fflush(mFile);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file assetpack.hpp
+ * @brief Single memory-mapped pack file holding the asset directories
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <iostream>
+#include <assimp/IOSystem.hpp>
+#include <assimp/IOStream.hpp>
+
+static const std::string ASSET_PACK_PATH = "assets.pack";
+
+class AssetPack {
+public:
+    // NOTE: Bump whenever the on-disk layout changes
+    static const uint32_t VERSION = 1;
+    static const uint32_t MAGIC = 0x4B504743; // "CGPK"
+    // NOTE: File data is aligned so views can be handed to loaders expecting aligned memory
+    static const uint64_t DATA_ALIGNMENT = 16;
+
+    /**
+     * @brief Read-only view into the mapped pack. Valid until Close
+     *
+     */
+    struct View {
+        const unsigned char* Data = 0;
+        size_t Size = 0;
+        uint64_t Hash = 0;
+    };
+
+    /**
+     * @brief Memory-maps the pack file and reads its index. Nothing else is read,
+     * file data is paged in by the OS as loaders touch it
+     *
+     * @param packPath Pack file path
+     * @returns true - Success, false - Missing or invalid pack, loaders fall back to loose files
+     */
+    static bool Open(const std::string& packPath);
+
+    /**
+     * @brief Unmaps the pack. Invalidates all views
+     *
+     */
+    static void Close();
+
+    /**
+     * @brief Checks whether a pack is mapped
+     *
+     * @returns true - Pack mapped, false - Loaders use loose files
+     */
+    static bool IsOpen();
+
+    /**
+     * @brief Looks up a file in the mapped pack. Safe to call from any thread while the pack is open
+     *
+     * @param filePath File path, normalized before lookup
+     * @param view Output view
+     * @returns true - Found, false - Not in pack or no pack mapped
+     */
+    static bool Find(const std::string& filePath, View& view);
+
+    /**
+     * @brief Returns the paths of all packed files
+     *
+     * @returns Normalized file paths
+     */
+    static std::vector<std::string> GetPaths();
+
+    /**
+     * @brief Packs every file under the given directories into a single file.
+     * Files with identical contents are stored once
+     *
+     * @param packPath Output pack file path
+     * @param directories Directories to pack, recursively
+     * @returns true - Success, false - Failure
+     */
+    static bool Build(const std::string& packPath, const std::vector<std::string>& directories);
+
+    /**
+     * @brief Recursively lists files under a directory
+     *
+     * @param directory Directory path
+     * @param files Output file paths, appended to
+     */
+    static void ListFiles(const std::string& directory, std::vector<std::string>& files);
+
+    /**
+     * @brief Hashes file contents (64-bit FNV-1a)
+     *
+     * @param data File contents
+     * @param size Size in bytes
+     * @returns 64-bit content hash
+     */
+    static uint64_t HashBytes(const unsigned char* data, size_t size);
+
+    /**
+     * @brief Asks the OS to drop a file from its file cache, best effort.
+     * Used for cold-cache measurements
+     *
+     * @param filePath File path
+     */
+    static void DropFromFileCache(const std::string& filePath);
+
+    /**
+     * @brief Assimp IOSystem serving files from the mapped pack without copying. Files
+     * missing from the pack, and writes, go to disk
+     *
+     */
+    class IOSystem : public Assimp::IOSystem {
+    public:
+        bool Exists(const char* filePath) const override;
+        char getOsSeparator() const override;
+        Assimp::IOStream* Open(const char* filePath, const char* mode = "rb") override;
+        void Close(Assimp::IOStream* stream) override;
+    };
+
+private:
+    struct Entry {
+        uint64_t Offset;
+        uint64_t Size;
+        uint64_t Hash;
+    };
+
+    class IOStream : public Assimp::IOStream {
+    public:
+        IOStream(const View& view);
+        size_t Read(void* buffer, size_t size, size_t count) override;
+        size_t Write(const void* buffer, size_t size, size_t count) override;
+        aiReturn Seek(size_t offset, aiOrigin origin) override;
+        size_t Tell() const override;
+        size_t FileSize() const override;
+        void Flush() override;
+
+    private:
+        View mView;
+        size_t mPosition;
+    };
+
+    class FileStream : public Assimp::IOStream {
+    public:
+        FileStream(FILE* file);
+        ~FileStream();
+        size_t Read(void* buffer, size_t size, size_t count) override;
+        size_t Write(const void* buffer, size_t size, size_t count) override;
+        aiReturn Seek(size_t offset, aiOrigin origin) override;
+        size_t Tell() const override;
+        size_t FileSize() const override;
+        void Flush() override;
+
+    private:
+        FILE* mFile;
+    };
+
+    static std::unordered_map<std::string, Entry> sEntries;
+    static const unsigned char* sData;
+    static size_t sSize;
+
+    static bool map(const std::string& packPath);
+    static void unmap();
+};
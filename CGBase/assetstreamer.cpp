@@ -0,0 +1,279 @@
+#include "assetstreamer.hpp"
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
+std::vector<TextureCache::Reference> AssetStreamer::sTextures;
+std::deque<Model> AssetStreamer::sModels;
+std::deque<std::unique_ptr<AssetStreamer::Job>> AssetStreamer::sQueued;
+std::deque<std::unique_ptr<AssetStreamer::Job>> AssetStreamer::sDecoded;
+std::unique_ptr<AssetStreamer::Job> AssetStreamer::sUploading;
+std::mutex AssetStreamer::sMutex;
+std::condition_variable AssetStreamer::sWake;
+std::vector<std::thread> AssetStreamer::sWorkers;
+bool AssetStreamer::sStopping = false;
+unsigned AssetStreamer::sPending = 0;
+AssetStreamer::Stats AssetStreamer::sStats = { 0, 0.0, 0.0 };
+
+double
+AssetStreamer::now() {
+    std::chrono::duration<double, std::milli> Time = std::chrono::steady_clock::now().time_since_epoch();
+    return Time.count();
+}
+
+StreamHandle
+AssetStreamer::RequestTexture(const std::string& filePath) {
+    StreamHandle Handle = (StreamHandle)sTextures.size();
+    sTextures.emplace_back(TextureCache::GetMissingTexture());
+
+    std::unique_ptr<Job> NewJob(new Job());
+    NewJob->Type = JOB_TEXTURE;
+    NewJob->Handle = Handle;
+    NewJob->Path = filePath;
+    NewJob->ImagePaths.push_back(filePath);
+    submit(std::move(NewJob));
+    return Handle;
+}
+
+StreamHandle
+AssetStreamer::RequestModel(const std::string& filePath, unsigned importOptions, EImportProfile importProfile) {
+    StreamHandle Handle = (StreamHandle)sModels.size();
+    sModels.emplace_back(filePath, importOptions, importProfile);
+
+    std::unique_ptr<Job> NewJob(new Job());
+    NewJob->Type = JOB_MODEL;
+    NewJob->Handle = Handle;
+    NewJob->Path = filePath;
+    NewJob->ImportOptions = importOptions;
+    NewJob->Staging.reset(new Model(filePath, importOptions, importProfile));
+    submit(std::move(NewJob));
+    return Handle;
+}
+
+unsigned
+AssetStreamer::GetTexture(StreamHandle handle) {
+    return sTextures[handle].Get();
+}
+
+Model&
+AssetStreamer::GetModel(StreamHandle handle) {
+    return sModels[handle];
+}
+
+unsigned
+AssetStreamer::GetPendingCount() {
+    return sPending;
+}
+
+void
+AssetStreamer::submit(std::unique_ptr<Job> job) {
+    job->Imported = false;
+    job->NextStep = 0;
+    job->StepOffset = 0;
+    job->RequestTime = now();
+    job->UploadMs = 0.0;
+    job->UploadFrames = 0;
+    ++sPending;
+
+    std::lock_guard<std::mutex> Lock(sMutex);
+    if (sWorkers.empty()) {
+        sStopping = false;
+        // NOTE: Leave a core for the render thread. hardware_concurrency may return 0 when unknown
+        unsigned Hc = std::thread::hardware_concurrency();
+        unsigned ThreadCount = Hc > 1 ? Hc - 1 : 1;
+        for (unsigned ThreadIdx = 0; ThreadIdx < ThreadCount; ++ThreadIdx) {
+            sWorkers.emplace_back(workerMain);
+        }
+    }
+    sQueued.push_back(std::move(job));
+    sWake.notify_one();
+}
+
+void
+AssetStreamer::workerMain() {
+    for (;;) {
+        std::unique_ptr<Job> CurrJob;
+        {
+            std::unique_lock<std::mutex> Lock(sMutex);
+            sWake.wait(Lock, []() { return sStopping || !sQueued.empty(); });
+            if (sStopping) {
+                return;
+            }
+            CurrJob = std::move(sQueued.front());
+            sQueued.pop_front();
+        }
+
+        process(*CurrJob);
+
+        std::lock_guard<std::mutex> Lock(sMutex);
+        sDecoded.push_back(std::move(CurrJob));
+    }
+}
+
+void
+AssetStreamer::process(Job& job) {
+    if (job.Type == JOB_MODEL) {
+        job.Imported = job.Staging->Import();
+        if (job.Imported) {
+            // NOTE: Meshes usually share textures, decode each path once
+            std::unordered_map<std::string, int> ImageIndices;
+            for (const std::string& Path : job.Staging->GetTexturePaths()) {
+                if (Path.empty()) {
+                    job.TextureSlots.push_back(-1);
+                    continue;
+                }
+                std::string Normalized = TextureCache::NormalizePath(Path);
+                auto It = ImageIndices.find(Normalized);
+                if (It == ImageIndices.end()) {
+                    It = ImageIndices.insert(std::make_pair(Normalized, (int)job.ImagePaths.size())).first;
+                    job.ImagePaths.push_back(Normalized);
+                }
+                job.TextureSlots.push_back(It->second);
+            }
+        }
+    } else {
+        job.Imported = true;
+    }
+
+    double DecodeStart = now();
+    job.Images.resize(job.ImagePaths.size());
+    for (size_t ImageIdx = 0; ImageIdx < job.ImagePaths.size(); ++ImageIdx) {
+        Texture::DecodeImage(job.ImagePaths[ImageIdx], job.Images[ImageIdx]);
+    }
+    if (job.Staging) {
+        job.Staging->mImportStats.TextureMs += now() - DecodeStart;
+    }
+}
+
+bool
+AssetStreamer::uploadStep(Job& job) {
+    size_t MeshCount = job.Imported && job.Staging ? job.Staging->GetMeshCount() : 0;
+    size_t StepCount = job.Imported ? MeshCount + job.ImagePaths.size() : 0;
+    if (job.NextStep < MeshCount) {
+        if (!job.Staging->UploadMeshPart(job.NextStep, job.StepOffset, STREAM_UPLOAD_CHUNK_BYTES)) {
+            return false;
+        }
+        job.StepOffset = 0;
+    } else if (job.NextStep < StepCount) {
+        size_t ImageIdx = job.NextStep - MeshCount;
+        double TextureStart = now();
+        job.Textures.push_back(TextureCache::AcquireDecoded(job.ImagePaths[ImageIdx], job.Images[ImageIdx]));
+        Texture::FreeImage(job.Images[ImageIdx]);
+        if (job.Staging) {
+            job.Staging->mImportStats.TextureMs += now() - TextureStart;
+        }
+    }
+    job.NextStep = std::min(job.NextStep + 1, StepCount);
+    return job.NextStep >= StepCount;
+}
+
+void
+AssetStreamer::finish(Job& job) {
+    double Latency = now() - job.RequestTime;
+    if (!job.Imported) {
+        std::cerr << "[Err] Failed to stream " << job.Path << std::endl;
+        return;
+    }
+
+    if (job.Type == JOB_TEXTURE) {
+        sTextures[job.Handle] = TextureCache::Reference(job.Textures[0]);
+    } else {
+        std::vector<unsigned> Textures;
+        std::vector<bool> HandedOver(job.Textures.size(), false);
+        for (int Slot : job.TextureSlots) {
+            if (Slot < 0) {
+                Textures.push_back(0);
+                continue;
+            }
+            // NOTE: Every mesh owns a reference, images shared by several meshes need more than the one acquired
+            if (HandedOver[Slot]) {
+                TextureCache::AddReference(job.Textures[Slot]);
+            }
+            HandedOver[Slot] = true;
+            Textures.push_back(job.Textures[Slot]);
+        }
+        job.Staging->SetTextures(Textures);
+        job.Staging->PrintMemoryReport();
+        job.Staging->PrintImportReport();
+        // NOTE: Swapped in whole between frames, Render never sees a half uploaded model
+        sModels[job.Handle] = std::move(*job.Staging);
+    }
+    ++sStats.Completed;
+    std::cout << "Streamed " << job.Path << " in " << Latency << " ms (upload " << job.UploadMs << " ms over "
+        << job.UploadFrames << " frames)" << std::endl;
+}
+
+void
+AssetStreamer::Update(double budgetMs) {
+    double FrameStart = now();
+    bool Uploaded = false;
+    for (;;) {
+        if (!sUploading) {
+            std::lock_guard<std::mutex> Lock(sMutex);
+            if (sDecoded.empty()) {
+                break;
+            }
+            sUploading = std::move(sDecoded.front());
+            sDecoded.pop_front();
+        }
+        if (Uploaded && now() - FrameStart >= budgetMs) {
+            break;
+        }
+
+        double StepStart = now();
+        bool Started = sUploading->NextStep > 0 || sUploading->StepOffset > 0;
+        bool Done = uploadStep(*sUploading);
+        sUploading->UploadMs += now() - StepStart;
+        if (!Uploaded || !Started) {
+            ++sUploading->UploadFrames;
+        }
+        Uploaded = true;
+        if (Done) {
+            finish(*sUploading);
+            sUploading.reset();
+            --sPending;
+        }
+    }
+
+    if (!Uploaded) {
+        return;
+    }
+    double FrameUploadMs = now() - FrameStart;
+    sStats.MaxFrameUploadMs = std::max(sStats.MaxFrameUploadMs, FrameUploadMs);
+    sStats.TotalUploadMs += FrameUploadMs;
+    if (sPending == 0) {
+        std::cout << "Streaming done: " << sStats.Completed << " assets, " << sStats.TotalUploadMs
+            << " ms uploading, at most " << sStats.MaxFrameUploadMs << " ms per frame" << std::endl;
+        MemoryStats::Print();
+    }
+}
+
+void
+AssetStreamer::Shutdown() {
+    {
+        std::lock_guard<std::mutex> Lock(sMutex);
+        sStopping = true;
+    }
+    sWake.notify_all();
+    for (std::thread& Worker : sWorkers) {
+        Worker.join();
+    }
+    sWorkers.clear();
+
+    if (sUploading) {
+        sDecoded.push_back(std::move(sUploading));
+    }
+    for (std::unique_ptr<Job>& Decoded : sDecoded) {
+        for (Texture::Image& CurrImage : Decoded->Images) {
+            Texture::FreeImage(CurrImage);
+        }
+        for (unsigned CurrTexture : Decoded->Textures) {
+            TextureCache::Release(CurrTexture);
+        }
+    }
+    sDecoded.clear();
+    sQueued.clear();
+    sPending = 0;
+    sModels.clear();
+    sTextures.clear();
+}
@@ -0,0 +1,139 @@
+/**
+ * @file assetstreamer.hpp
+ * @brief Non-blocking model and texture loading. Workers do file I/O, decoding and
+ * vertex processing, GL uploads are spread over frames within a time budget
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <iostream>
+#include "model.hpp"
+#include "texture.hpp"
+
+// NOTE: GL upload time the render loop spends on streamed assets per frame
+static const double STREAM_UPLOAD_BUDGET_MS = 2.0;
+// NOTE: Meshes are uploaded in parts of at most this many bytes, the budget is checked between parts
+static const size_t STREAM_UPLOAD_CHUNK_BYTES = 256 * 1024;
+
+typedef unsigned StreamHandle;
+
+class AssetStreamer {
+public:
+    /**
+     * @brief Requests a texture. Returns right away, the handle resolves to the
+     * missing texture until the image is decoded and uploaded
+     *
+     * @param filePath Image file path
+     * @returns Texture handle
+     */
+    static StreamHandle RequestTexture(const std::string& filePath);
+
+    /**
+     * @brief Requests a model. Returns right away, the handle resolves to an empty
+     * model (nothing is drawn) until all meshes and textures are uploaded
+     *
+     * @param filePath Model file path
+     * @param importOptions EImportOptions bit mask
+     * @param importProfile Assimp post-processing profile
+     * @returns Model handle
+     */
+    static StreamHandle RequestModel(const std::string& filePath, unsigned importOptions = 0, EImportProfile importProfile = IMPORT_PROFILE_MINIMAL);
+
+    /**
+     * @brief Resolves a texture handle
+     *
+     * @param handle Texture handle
+     * @returns TextureID, the missing texture while loading or if loading failed
+     */
+    static unsigned GetTexture(StreamHandle handle);
+
+    /**
+     * @brief Resolves a model handle
+     *
+     * @param handle Model handle
+     * @returns Model, empty while loading or if loading failed
+     */
+    static Model& GetModel(StreamHandle handle);
+
+    /**
+     * @brief Runs pending GL uploads until the budget is spent and swaps finished assets in.
+     * Call once per frame on the context thread. At least one upload step runs per call, a step
+     * being one texture or up to STREAM_UPLOAD_CHUNK_BYTES of a mesh
+     *
+     * @param budgetMs Upload time budget in milliseconds
+     */
+    static void Update(double budgetMs = STREAM_UPLOAD_BUDGET_MS);
+
+    /**
+     * @brief Gets the number of requests which aren't swapped in yet
+     *
+     * @returns Pending request count
+     */
+    static unsigned GetPendingCount();
+
+    /**
+     * @brief Stops and joins the worker threads. Requests still in flight are dropped and
+     * every streamed model and texture is freed, handles are invalid afterwards
+     *
+     */
+    static void Shutdown();
+
+private:
+    enum EJobType {
+        JOB_TEXTURE,
+        JOB_MODEL,
+    };
+
+    struct Job {
+        EJobType Type;
+        StreamHandle Handle;
+        std::string Path;
+        unsigned ImportOptions;
+        bool Imported;
+        std::unique_ptr<Model> Staging;
+        // NOTE: Unique image paths and their decoded images. For models, TextureSlots maps
+        // each Model::GetTexturePaths slot to an image, -1 for meshes without that texture
+        std::vector<std::string> ImagePaths;
+        std::vector<Texture::Image> Images;
+        std::vector<int> TextureSlots;
+        // NOTE: One texture cache reference per image, handed over in finish
+        std::vector<unsigned> Textures;
+        size_t NextStep;
+        // NOTE: Bytes of the mesh at NextStep uploaded so far
+        size_t StepOffset;
+        double RequestTime;
+        double UploadMs;
+        unsigned UploadFrames;
+    };
+
+    struct Stats {
+        unsigned Completed;
+        double MaxFrameUploadMs;
+        double TotalUploadMs;
+    };
+
+    static std::vector<TextureCache::Reference> sTextures;
+    static std::deque<Model> sModels;
+    static std::deque<std::unique_ptr<Job>> sQueued;
+    static std::deque<std::unique_ptr<Job>> sDecoded;
+    static std::unique_ptr<Job> sUploading;
+    static std::mutex sMutex;
+    static std::condition_variable sWake;
+    static std::vector<std::thread> sWorkers;
+    static bool sStopping;
+    static unsigned sPending;
+    static Stats sStats;
+
+    static void submit(std::unique_ptr<Job> job);
+    static void workerMain();
+    static void process(Job& job);
+    static bool uploadStep(Job& job);
+    static void finish(Job& job);
+    static double now();
+};
@@ -0,0 +1,774 @@
+#include "benchmarks.hpp"
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <assimp/scene.h>
+#include "mesh.hpp"
+#include "model.hpp"
+#include "assetpack.hpp"
+#include "texture.hpp"
+#include "shader.hpp"
+#include "renderstats.hpp"
+#include "skeleton.hpp"
+#include "memorystats.hpp"
+#include "frameuniforms.hpp"
+#include "glstate.hpp"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+template<typename Fn> static double
+bestOf(unsigned runs, Fn fn) {
+    double Best = 1e30;
+    for (unsigned Run = 0; Run < runs; ++Run) {
+        auto Start = Clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> Elapsed = Clock::now() - Start;
+        Best = std::min(Best, Elapsed.count());
+    }
+    return Best;
+}
+
+static aiMesh*
+createSyntheticMesh(unsigned vertexCount) {
+    aiMesh* Synthetic = new aiMesh();
+    Synthetic->mNumVertices = vertexCount;
+    Synthetic->mVertices = new aiVector3D[vertexCount];
+    Synthetic->mNormals = new aiVector3D[vertexCount];
+    Synthetic->mTextureCoords[0] = new aiVector3D[vertexCount];
+    Synthetic->mNumUVComponents[0] = 2;
+    for (unsigned Idx = 0; Idx < vertexCount; ++Idx) {
+        float T = (float)Idx / vertexCount;
+        Synthetic->mVertices[Idx] = aiVector3D(T, T * 2.0f, T * 3.0f);
+        Synthetic->mNormals[Idx] = aiVector3D(0.0f, 1.0f, 0.0f);
+        Synthetic->mTextureCoords[0][Idx] = aiVector3D(T, 1.0f - T, 0.0f);
+    }
+
+    // NOTE: Triangle strip like connectivity, vertexCount - 2 triangles
+    Synthetic->mNumFaces = vertexCount > 2 ? vertexCount - 2 : 0;
+    Synthetic->mFaces = new aiFace[Synthetic->mNumFaces];
+    for (unsigned Idx = 0; Idx < Synthetic->mNumFaces; ++Idx) {
+        aiFace& Face = Synthetic->mFaces[Idx];
+        Face.mNumIndices = 3;
+        Face.mIndices = new unsigned[3];
+        Face.mIndices[0] = Idx;
+        Face.mIndices[1] = Idx + 1;
+        Face.mIndices[2] = Idx + 2;
+    }
+    return Synthetic;
+}
+
+/**
+ * @brief Spider like rig: root, body and legCount legs of segmentCount bones, every node
+ * animated with keysPerSecond position, rotation and scale keys over duration seconds
+ *
+ */
+static aiScene*
+createSyntheticRig(unsigned legCount, unsigned segmentCount, unsigned keysPerSecond, float duration, std::vector<std::string>& nodeNames) {
+    aiScene* Synthetic = new aiScene();
+    Synthetic->mRootNode = new aiNode("Root");
+    aiNode* Body = new aiNode("Body");
+    Body->mParent = Synthetic->mRootNode;
+    Synthetic->mRootNode->mNumChildren = 1;
+    Synthetic->mRootNode->mChildren = new aiNode*[1];
+    Synthetic->mRootNode->mChildren[0] = Body;
+    nodeNames.push_back("Root");
+    nodeNames.push_back("Body");
+
+    Body->mNumChildren = legCount;
+    Body->mChildren = new aiNode*[legCount];
+    for (unsigned Leg = 0; Leg < legCount; ++Leg) {
+        aiNode* Parent = Body;
+        for (unsigned Segment = 0; Segment < segmentCount; ++Segment) {
+            std::string Name = "Leg" + std::to_string(Leg) + "_" + std::to_string(Segment);
+            aiNode* Node = new aiNode(Name);
+            Node->mParent = Parent;
+            aiMatrix4x4::Translation(aiVector3D(0.0f, 0.0f, 1.0f), Node->mTransformation);
+            if (Segment == 0) {
+                Body->mChildren[Leg] = Node;
+            } else {
+                Parent->mNumChildren = 1;
+                Parent->mChildren = new aiNode*[1];
+                Parent->mChildren[0] = Node;
+            }
+            nodeNames.push_back(Name);
+            Parent = Node;
+        }
+    }
+
+    unsigned KeyCount = (unsigned)(keysPerSecond * duration) + 1;
+    aiAnimation* Walk = new aiAnimation();
+    Walk->mTicksPerSecond = keysPerSecond;
+    Walk->mDuration = KeyCount - 1;
+    Walk->mNumChannels = (unsigned)nodeNames.size();
+    Walk->mChannels = new aiNodeAnim*[Walk->mNumChannels];
+    for (unsigned Channel = 0; Channel < Walk->mNumChannels; ++Channel) {
+        aiNodeAnim* Track = new aiNodeAnim();
+        Track->mNodeName = aiString(nodeNames[Channel]);
+        Track->mNumPositionKeys = Track->mNumRotationKeys = Track->mNumScalingKeys = KeyCount;
+        Track->mPositionKeys = new aiVectorKey[KeyCount];
+        Track->mRotationKeys = new aiQuatKey[KeyCount];
+        Track->mScalingKeys = new aiVectorKey[KeyCount];
+        for (unsigned Key = 0; Key < KeyCount; ++Key) {
+            float Phase = 6.2831853f * Key / (KeyCount - 1) + Channel;
+            Track->mPositionKeys[Key] = aiVectorKey(Key, aiVector3D(0.0f, 0.0f, Channel > 1 ? 1.0f : 0.0f));
+            Track->mRotationKeys[Key] = aiQuatKey(Key, aiQuaternion(aiVector3D(1.0f, 0.0f, 0.0f), 0.4f * std::sin(Phase)));
+            Track->mScalingKeys[Key] = aiVectorKey(Key, aiVector3D(1.0f, 1.0f, 1.0f));
+        }
+        Walk->mChannels[Channel] = Track;
+    }
+    Synthetic->mNumAnimations = 1;
+    Synthetic->mAnimations = new aiAnimation*[1];
+    Synthetic->mAnimations[0] = Walk;
+    return Synthetic;
+}
+
+// NOTE: Copy of the original Mesh::processMesh interleaving, kept as the baseline
+static void
+legacyInterleave(const aiMesh* mesh, std::vector<float>& vertices, std::vector<unsigned>& indices) {
+    const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+    for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
+        std::vector<float> Position = { mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z };
+        vertices.insert(vertices.end(), Position.begin(), Position.end());
+        std::vector<float> Normals = { mesh->mNormals[VertexIndex].x, mesh->mNormals[VertexIndex].y, mesh->mNormals[VertexIndex].z };
+        vertices.insert(vertices.end(), Normals.begin(), Normals.end());
+        const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? &(mesh->mTextureCoords[0][VertexIndex]) : &Zero3D;
+        std::vector<float> UV = { TexCoords->x, TexCoords->y };
+        vertices.insert(vertices.end(), UV.begin(), UV.end());
+    }
+
+    for (unsigned FaceIndex = 0; FaceIndex < mesh->mNumFaces; ++FaceIndex) {
+        const aiFace& Face = mesh->mFaces[FaceIndex];
+        indices.push_back(Face.mIndices[0]);
+        indices.push_back(Face.mIndices[1]);
+        indices.push_back(Face.mIndices[2]);
+    }
+}
+
+bool
+Benchmarks::Run(const std::string& name) {
+    bool All = name == "all";
+    bool Found = false;
+    if (All || name == "interleave") {
+        interleave();
+        Found = true;
+    }
+
+    if (All || name == "compact") {
+        compactVertices();
+        Found = true;
+    }
+
+    if (All || name == "startup") {
+        startup();
+        Found = true;
+    }
+
+    if (All || name == "meshcache") {
+        meshCache();
+        Found = true;
+    }
+
+    if (All || name == "textures") {
+        bakedTextures();
+        Found = true;
+    }
+
+    if (All || name == "lod") {
+        lod();
+        Found = true;
+    }
+
+    if (All || name == "meshlets") {
+        meshlets();
+        Found = true;
+    }
+
+    if (All || name == "skinning") {
+        skinning();
+        Found = true;
+    }
+
+    if (All || name == "profiles") {
+        profiles();
+        Found = true;
+    }
+
+    if (All || name == "instancing") {
+        instancing();
+        Found = true;
+    }
+
+    if (All || name == "directupload") {
+        directUpload();
+        Found = true;
+    }
+
+    if (All || name == "uniforms") {
+        uniforms();
+        Found = true;
+    }
+
+    if (All || name == "bounds") {
+        bounds();
+        Found = true;
+    }
+
+    if (!Found) {
+        std::cerr << "Unknown benchmark: " << name << std::endl;
+    }
+    return Found;
+}
+
+void
+Benchmarks::interleave() {
+    const unsigned VertexCounts[] = { 10000, 100000, 1000000, 10000000 };
+    std::cout << "[Bench] Vertex interleaving (best of 3)" << std::endl;
+    for (unsigned VertexCount : VertexCounts) {
+        aiMesh* Synthetic = createSyntheticMesh(VertexCount);
+
+        double Legacy = bestOf(3, [&]() {
+            std::vector<float> Vertices;
+            std::vector<unsigned> Indices;
+            legacyInterleave(Synthetic, Vertices, Indices);
+        });
+
+        double SinglePass = bestOf(3, [&]() {
+            std::vector<float> Vertices((size_t)Synthetic->mNumVertices * Mesh::VERTEX_STRIDE);
+            std::vector<unsigned> Indices((size_t)Synthetic->mNumFaces * 3);
+            Bounds MeshBounds;
+            Mesh::InterleaveVertices(Synthetic, Vertices.data(), MeshBounds);
+            Indices.resize(Mesh::CopyIndices(Synthetic, Indices.data()));
+        });
+
+        std::cout << "  " << VertexCount << " vertices: legacy " << Legacy << " ms, single pass "
+            << SinglePass << " ms (" << Legacy / SinglePass << "x)" << std::endl;
+        delete Synthetic;
+    }
+}
+
+void
+Benchmarks::compactVertices() {
+    const char* ModelPaths[] = { "spider/spider.obj" };
+    std::cout << "[Bench] Compact vertex layout" << std::endl;
+    for (const char* ModelPath : ModelPaths) {
+        Model Compact(ModelPath, IMPORT_COMPACT_VERTICES);
+        if (!Compact.Load()) {
+            std::cerr << "  Failed to load " << ModelPath << std::endl;
+        }
+    }
+}
+
+static volatile unsigned char sPageSink;
+
+// NOTE: Reads every file the way the startup loaders do, returns bytes touched
+static size_t
+readStartupFiles(const std::vector<std::string>& paths) {
+    size_t Bytes = 0;
+    for (const std::string& Path : paths) {
+        AssetPack::View Packed;
+        if (AssetPack::Find(Path, Packed)) {
+            // NOTE: Touch one byte per page, that's what faults the mapped data in
+            for (size_t Offset = 0; Offset < Packed.Size; Offset += 4096) {
+                sPageSink = Packed.Data[Offset];
+            }
+            Bytes += Packed.Size;
+            continue;
+        }
+
+        std::ifstream In(Path, std::ios::binary);
+        std::vector<char> Data((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+        Bytes += Data.size();
+    }
+    return Bytes;
+}
+
+void
+Benchmarks::startup() {
+    if (!AssetPack::Open(ASSET_PACK_PATH)) {
+        std::cerr << "  Build the pack first: CGBase --pack" << std::endl;
+        return;
+    }
+    std::vector<std::string> Paths = AssetPack::GetPaths();
+    std::vector<std::string> ImagePaths;
+    for (const std::string& Path : Paths) {
+        size_t Dot = Path.find_last_of('.');
+        std::string Extension = Dot == std::string::npos ? "" : Path.substr(Dot);
+        if (Extension == ".png" || Extension == ".jpg") {
+            ImagePaths.push_back(Path);
+        }
+    }
+
+    std::cout << "[Bench] Startup asset loading, " << Paths.size() << " files" << std::endl;
+    const char* Sources[] = { "loose files", "asset pack" };
+    for (unsigned Source = 0; Source < 2; ++Source) {
+        bool UsePack = Source == 1;
+        for (unsigned Pass = 0; Pass < 2; ++Pass) {
+            bool Cold = Pass == 0;
+            AssetPack::Close();
+            if (Cold) {
+                if (UsePack) {
+                    AssetPack::DropFromFileCache(ASSET_PACK_PATH);
+                } else {
+                    for (const std::string& Path : Paths) {
+                        AssetPack::DropFromFileCache(Path);
+                    }
+                }
+            }
+
+            auto Start = Clock::now();
+            if (UsePack) {
+                AssetPack::Open(ASSET_PACK_PATH);
+            }
+            size_t Bytes = readStartupFiles(Paths);
+            std::chrono::duration<double, std::milli> ReadTime = Clock::now() - Start;
+
+            // NOTE: Second read of the images is warm either way, this measures decode overhead
+            std::vector<Texture::Image> Images;
+            auto DecodeStart = Clock::now();
+            Texture::DecodeImages(ImagePaths, Images);
+            std::chrono::duration<double, std::milli> DecodeTime = Clock::now() - DecodeStart;
+            for (Texture::Image& Decoded : Images) {
+                Texture::FreeImage(Decoded);
+            }
+
+            std::cout << "  " << Sources[Source] << (Cold ? " cold: " : " warm: ") << "read " << Bytes / 1024
+                << " KB in " << ReadTime.count() << " ms, decode " << ImagePaths.size() << " images in "
+                << DecodeTime.count() << " ms" << std::endl;
+        }
+    }
+    AssetPack::Close();
+    // NOTE: Leave the pack mapped like the scene expects
+    AssetPack::Open(ASSET_PACK_PATH);
+}
+
+void
+Benchmarks::meshCache() {
+    const char* ModelPaths[] = { "spider/spider.obj" };
+    // NOTE: Same options as the scene, runtime options aren't part of the cache key
+    const unsigned Options = IMPORT_OPTIMIZE_MESHES | IMPORT_GENERATE_LODS | IMPORT_BUILD_MESHLETS;
+    std::cout << "[Bench] Mesh cache, cold (Assimp) vs warm (cache) load" << std::endl;
+    for (const char* ModelPath : ModelPaths) {
+        auto Start = Clock::now();
+        Model Cold(ModelPath, Options | IMPORT_SKIP_CACHE);
+        if (!Cold.Load()) {
+            std::cerr << "  Failed to load " << ModelPath << std::endl;
+            continue;
+        }
+        glFinish();
+        std::chrono::duration<double, std::milli> ColdTime = Clock::now() - Start;
+
+        // NOTE: The cold load leaves the cache alone, a missing or stale cache is written
+        // by the first regular load and read by the second
+        std::chrono::duration<double, std::milli> WarmTime(0.0);
+        bool Warm = false;
+        for (unsigned Attempt = 0; Attempt < 2 && !Warm; ++Attempt) {
+            Start = Clock::now();
+            Model Cached(ModelPath, Options);
+            if (!Cached.Load()) {
+                break;
+            }
+            glFinish();
+            WarmTime = Clock::now() - Start;
+            Warm = Cached.mImportedFromCache;
+        }
+        if (!Warm) {
+            std::cerr << "  Failed to load " << ModelPath << " from the mesh cache" << std::endl;
+            continue;
+        }
+        std::cout << "  " << ModelPath << ": cold " << ColdTime.count() << " ms, warm " << WarmTime.count()
+            << " ms (" << ColdTime.count() / WarmTime.count() << "x)" << std::endl;
+    }
+}
+
+void
+Benchmarks::bakedTextures() {
+    std::vector<std::string> Files;
+    AssetPack::ListFiles("res", Files);
+    std::vector<std::string> ImagePaths;
+    for (const std::string& Path : Files) {
+        size_t Dot = Path.find_last_of('.');
+        std::string Extension = Dot == std::string::npos ? "" : Path.substr(Dot);
+        if (Extension == ".png" || Extension == ".jpg") {
+            ImagePaths.push_back(Path);
+        }
+    }
+
+    std::cout << "[Bench] Baked textures, " << ImagePaths.size() << " images (bake first: CGBase --bake)" << std::endl;
+    const char* Sources[] = { "source images", "baked containers" };
+    for (unsigned Source = 0; Source < 2; ++Source) {
+        Texture::SetUseBakedTextures(Source == 1);
+        std::cout << "  " << Sources[Source] << ":" << std::endl;
+        std::vector<GLTexture> Textures = Texture::LoadImagesToTextures(ImagePaths);
+        glFinish();
+    }
+    Texture::SetUseBakedTextures(true);
+}
+
+void
+Benchmarks::lod() {
+    const unsigned GridSize = 24;
+    const float Spacing = 4.0f;
+    const float ViewportHeight = 800.0f;
+    Model Spider("spider/spider.obj", IMPORT_OPTIMIZE_MESHES | IMPORT_GENERATE_LODS);
+    if (!Spider.Load()) {
+        std::cerr << "  Failed to load spider/spider.obj" << std::endl;
+        return;
+    }
+
+    Shader PhongShader("shaders/basic.vert", "shaders/phong_material_texture.frag");
+    glm::vec3 CameraPosition(0.0f, 2.0f, -4.0f);
+    glm::mat4 Projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 200.0f);
+    glm::mat4 View = glm::lookAt(CameraPosition, glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    RenderView CameraView = Model::CreateRenderView(Projection, View, CameraPosition, ViewportHeight);
+    GLState::UseProgram(PhongShader.GetId());
+    FrameUniforms::Camera BenchCamera = { Projection, View, CameraPosition, 0.0f };
+    FrameUniforms::SetCamera(BenchCamera);
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "[Bench] Mesh LODs, " << GridSize * GridSize << " spiders up to " << GridSize * Spacing << " units away" << std::endl;
+    const char* Modes[] = { "full detail", "LOD selection" };
+    for (unsigned Mode = 0; Mode < 2; ++Mode) {
+        RenderStats::Frame Submitted = { 0, 0, 0, 0, 0 };
+        double FrameTime = bestOf(5, [&]() {
+            RenderStats::EndFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (unsigned Row = 0; Row < GridSize; ++Row) {
+                for (unsigned Column = 0; Column < GridSize; ++Column) {
+                    glm::vec3 Position((Column - GridSize / 2.0f) * Spacing, 0.0f, Row * Spacing);
+                    glm::mat4 ModelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), Position), glm::vec3(0.05f));
+                    if (Mode == 0) {
+                        PhongShader.SetModel(ModelMatrix);
+                        Spider.Render(PhongShader);
+                    } else {
+                        Spider.Render(PhongShader, ModelMatrix, CameraView);
+                    }
+                }
+            }
+            glFinish();
+            Submitted = RenderStats::GetCurrentFrame();
+        });
+        std::cout << "  " << Modes[Mode] << ": " << Submitted.Triangles << " triangles in " << Submitted.DrawCalls
+            << " draw calls, " << FrameTime << " ms per frame" << std::endl;
+    }
+    RenderStats::EndFrame();
+    GLState::UseProgram(0);
+}
+
+void
+Benchmarks::meshlets() {
+    const float ViewportHeight = 800.0f;
+    Model Spider("spider/spider.obj", IMPORT_OPTIMIZE_MESHES | IMPORT_BUILD_MESHLETS);
+    if (!Spider.Load()) {
+        std::cerr << "  Failed to load spider/spider.obj" << std::endl;
+        return;
+    }
+
+    Shader PhongShader("shaders/basic.vert", "shaders/phong_material_texture.frag");
+    glm::mat4 Projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 200.0f);
+    glm::mat4 ModelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f));
+    Bounds WorldBounds = Spider.GetBounds().Transform(ModelMatrix);
+    GLState::UseProgram(PhongShader.GetId());
+    glEnable(GL_DEPTH_TEST);
+
+    // NOTE: Whole spider in view from two sides, and a close-up where most of it is off screen
+    const char* Views[] = { "front", "above", "close-up" };
+    glm::vec3 Offsets[] = { glm::vec3(0.0f, 0.0f, -2.5f), glm::vec3(0.0f, 2.5f, -0.1f), glm::vec3(0.4f, 0.2f, -0.6f) };
+    std::cout << "[Bench] Meshlet culling, spider" << std::endl;
+    for (unsigned ViewIdx = 0; ViewIdx < 3; ++ViewIdx) {
+        glm::vec3 CameraPosition = WorldBounds.Center + Offsets[ViewIdx] * WorldBounds.Radius;
+        glm::mat4 View = glm::lookAt(CameraPosition, WorldBounds.Center, glm::vec3(0.0f, 1.0f, 0.0f));
+        RenderView CameraView = Model::CreateRenderView(Projection, View, CameraPosition, ViewportHeight);
+        FrameUniforms::Camera BenchCamera = { Projection, View, CameraPosition, 0.0f };
+        FrameUniforms::SetCamera(BenchCamera);
+
+        const char* Modes[] = { "no culling", "meshlet culling" };
+        for (unsigned Mode = 0; Mode < 2; ++Mode) {
+            RenderStats::Frame Submitted = { 0, 0, 0, 0, 0 };
+            double FrameTime = bestOf(20, [&]() {
+                RenderStats::EndFrame();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (Mode == 0) {
+                    PhongShader.SetModel(ModelMatrix);
+                    Spider.Render(PhongShader);
+                } else {
+                    Spider.Render(PhongShader, ModelMatrix, CameraView);
+                }
+                glFinish();
+                Submitted = RenderStats::GetCurrentFrame();
+            });
+            std::cout << "  " << Views[ViewIdx] << ", " << Modes[Mode] << ": " << Submitted.Triangles << " triangles ("
+                << Submitted.TrianglesCulled << " culled) in " << Submitted.DrawCalls << " draw calls, " << FrameTime << " ms per frame" << std::endl;
+        }
+    }
+    RenderStats::EndFrame();
+    GLState::UseProgram(0);
+}
+
+void
+Benchmarks::skinning() {
+    const unsigned InstanceCounts[] = { 1, 100, 500 };
+    std::vector<std::string> NodeNames;
+    aiScene* Rig = createSyntheticRig(8, 5, 30, 2.0f, NodeNames);
+    Skeleton Spider;
+    Spider.Import(Rig);
+    for (const std::string& Name : NodeNames) {
+        Spider.AddBone(Name, glm::mat4(1.0f));
+    }
+    delete Rig;
+
+    const Skeleton::Animation& Walk = Spider.mAnimations[0];
+    std::cout << "[Bench] Pose evaluation, synthetic spider rig: " << Spider.mBoneNodes.size() << " bones, "
+        << Walk.Tracks.size() << " tracks, " << Walk.Keys.size() << " keys (" << Walk.Keys.size() * (sizeof(glm::vec4) + sizeof(float)) / 1024
+        << " KB)" << std::endl;
+    for (unsigned InstanceCount : InstanceCounts) {
+        std::vector<Skeleton::Pose> Poses(InstanceCount);
+        // NOTE: Instances are out of phase so each samples different keys
+        double FrameTime = bestOf(20, [&]() {
+            for (unsigned Instance = 0; Instance < InstanceCount; ++Instance) {
+                Spider.EvaluatePose(0, 0.5f + Instance * 0.013f, Poses[Instance]);
+            }
+        });
+        std::cout << "  " << InstanceCount << " instances: " << FrameTime << " ms per frame, "
+            << FrameTime * 1e3 / InstanceCount << " us per palette" << std::endl;
+    }
+}
+
+void
+Benchmarks::profiles() {
+    std::cout << "[Bench] Import profiles, spider/spider.obj (cold Assimp imports, mesh cache skipped)" << std::endl;
+    for (unsigned Profile = 0; Profile < IMPORT_PROFILE_COUNT; ++Profile) {
+        EImportProfile CurrProfile = (EImportProfile)Profile;
+        std::cout << "  " << Model::GetProfileName(CurrProfile) << ":" << std::endl;
+        Model Spider("spider/spider.obj", IMPORT_OPTIMIZE_MESHES | IMPORT_SKIP_CACHE, CurrProfile);
+        auto Start = Clock::now();
+        if (!Spider.Load()) {
+            std::cerr << "  Failed to load spider/spider.obj" << std::endl;
+            return;
+        }
+        glFinish();
+        std::chrono::duration<double, std::milli> Elapsed = Clock::now() - Start;
+        std::cout << "  " << Model::GetProfileName(CurrProfile) << " total: " << Elapsed.count() << " ms, "
+            << Spider.GetMeshCount() << " draw calls per instance" << std::endl;
+    }
+}
+
+/**
+ * @brief Writes a gridSize x gridSize vertex grid as OBJ. Assimp gives every face corner its
+ * own vertex, so it imports as about 6 * gridSize^2 vertices
+ *
+ */
+static bool
+writeGridObj(const std::string& path, unsigned gridSize) {
+    std::ofstream Out(path);
+    if (!Out) {
+        return false;
+    }
+
+    for (unsigned Row = 0; Row < gridSize; ++Row) {
+        for (unsigned Column = 0; Column < gridSize; ++Column) {
+            float U = (float)Column / (gridSize - 1);
+            float V = (float)Row / (gridSize - 1);
+            Out << "v " << U * 100.0f << " " << std::sin(U * 20.0f) * std::cos(V * 20.0f) << " " << V * 100.0f << "\n";
+            Out << "vt " << U << " " << V << "\n";
+        }
+    }
+    Out << "vn 0 1 0\n";
+    for (unsigned Row = 0; Row + 1 < gridSize; ++Row) {
+        for (unsigned Column = 0; Column + 1 < gridSize; ++Column) {
+            unsigned Corner = Row * gridSize + Column + 1;
+            unsigned Right = Corner + 1, Below = Corner + gridSize, Diagonal = Below + 1;
+            Out << "f " << Corner << "/" << Corner << "/1 " << Below << "/" << Below << "/1 " << Right << "/" << Right << "/1\n";
+            Out << "f " << Right << "/" << Right << "/1 " << Below << "/" << Below << "/1 " << Diagonal << "/" << Diagonal << "/1\n";
+        }
+    }
+    return (bool)Out;
+}
+
+void
+Benchmarks::directUpload() {
+    const unsigned GridSize = 700;
+    const std::string GridPath = "bench_grid.obj";
+    if (!writeGridObj(GridPath, GridSize)) {
+        std::cerr << "  Failed to write " << GridPath << std::endl;
+        return;
+    }
+
+    std::cout << "[Bench] Direct upload, " << GridSize << "x" << GridSize << " grid" << std::endl;
+    // NOTE: Peak resident size only ever grows, so the direct path runs first and the
+    // regular path's peak is what it adds on top of that
+    const unsigned Options[] = { IMPORT_SKIP_CACHE | IMPORT_DIRECT_UPLOAD, IMPORT_SKIP_CACHE };
+    const char* Names[] = { "direct (mapped)", "regular (CPU copy)" };
+    for (unsigned Mode = 0; Mode < 2; ++Mode) {
+        size_t PeakBefore = MemoryStats::GetPeakResidentBytes();
+        auto Start = Clock::now();
+        Model Grid(GridPath, Options[Mode]);
+        if (!Grid.Load()) {
+            std::cerr << "  Failed to load " << GridPath << std::endl;
+            break;
+        }
+        glFinish();
+        std::chrono::duration<double, std::milli> Elapsed = Clock::now() - Start;
+        size_t PeakGrowth = MemoryStats::GetPeakResidentBytes() - PeakBefore;
+        std::cout << "  " << Names[Mode] << ": " << Grid.mImportStats.Vertices << " vertices, interleave + upload "
+            << Grid.mImportStats.InterleaveMs + Grid.mImportStats.UploadMs << " ms, total " << Elapsed.count()
+            << " ms, peak resident +" << PeakGrowth / (1024 * 1024) << " MB" << std::endl;
+    }
+    std::remove(GridPath.c_str());
+}
+
+void
+Benchmarks::instancing() {
+    const unsigned InstanceCounts[] = { 1000, 10000, 100000 };
+    const float Spacing = 2.0f;
+    Model Spider("spider/spider.obj", IMPORT_OPTIMIZE_MESHES);
+    if (!Spider.Load()) {
+        std::cerr << "  Failed to load spider/spider.obj" << std::endl;
+        return;
+    }
+
+    Shader PhongShader("shaders/basic.vert", "shaders/phong_material_texture.frag");
+    glm::vec3 CameraPosition(0.0f, 40.0f, -20.0f);
+    glm::mat4 Projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f);
+    glm::mat4 View = glm::lookAt(CameraPosition, glm::vec3(0.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    GLState::UseProgram(PhongShader.GetId());
+    FrameUniforms::Camera BenchCamera = { Projection, View, CameraPosition, 0.0f };
+    FrameUniforms::SetCamera(BenchCamera);
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "[Bench] Instanced rendering (best of 3)" << std::endl;
+    for (unsigned InstanceCount : InstanceCounts) {
+        unsigned GridSize = (unsigned)std::ceil(std::sqrt((float)InstanceCount));
+        std::vector<glm::mat4> ModelMatrices(InstanceCount);
+        for (unsigned InstanceIdx = 0; InstanceIdx < InstanceCount; ++InstanceIdx) {
+            glm::vec3 Position(((InstanceIdx % GridSize) - GridSize / 2.0f) * Spacing, 0.0f, (InstanceIdx / GridSize) * Spacing);
+            ModelMatrices[InstanceIdx] = glm::scale(glm::translate(glm::mat4(1.0f), Position), glm::vec3(0.02f));
+        }
+
+        RenderStats::Frame PerObjectFrame = { 0, 0, 0, 0, 0 };
+        double PerObject = bestOf(3, [&]() {
+            RenderStats::EndFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (const glm::mat4& ModelMatrix : ModelMatrices) {
+                PhongShader.SetModel(ModelMatrix);
+                Spider.Render(PhongShader);
+            }
+            glFinish();
+            PerObjectFrame = RenderStats::GetCurrentFrame();
+        });
+
+        RenderStats::Frame InstancedFrame = { 0, 0, 0, 0, 0 };
+        double Instanced = bestOf(3, [&]() {
+            RenderStats::EndFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            Spider.RenderInstanced(PhongShader, ModelMatrices.data(), ModelMatrices.size());
+            glFinish();
+            InstancedFrame = RenderStats::GetCurrentFrame();
+        });
+
+        std::cout << "  " << InstanceCount << " spiders: per object " << PerObject << " ms in " << PerObjectFrame.DrawCalls
+            << " draw calls, instanced " << Instanced << " ms in " << InstancedFrame.DrawCalls << " draw calls ("
+            << PerObject / Instanced << "x)" << std::endl;
+    }
+    RenderStats::EndFrame();
+    GLState::UseProgram(0);
+}
+
+void
+Benchmarks::uniforms() {
+    const unsigned DrawCount = 1000;
+    Shader PhongShader("shaders/basic.vert", "shaders/phong_material_texture.frag");
+    GLState::UseProgram(PhongShader.GetId());
+    std::vector<glm::mat4> ModelMatrices(DrawCount);
+    for (unsigned DrawIdx = 0; DrawIdx < DrawCount; ++DrawIdx) {
+        ModelMatrices[DrawIdx] = glm::translate(glm::mat4(1.0f), glm::vec3((float)DrawIdx, 0.0f, 0.0f));
+    }
+    glm::vec3 Scale(1.0f / 32767.0f);
+    glm::vec3 Offset(0.0f);
+
+    // NOTE: What Mesh and Model set for every compact, skinned draw
+    std::cout << "[Bench] Uniform updates, " << DrawCount << " draws x 6 uniforms (best of 5)" << std::endl;
+    unsigned Program = PhongShader.GetId();
+    double GLLookup = bestOf(5, [&]() {
+        for (const glm::mat4& ModelMatrix : ModelMatrices) {
+            glUniformMatrix4fv(glGetUniformLocation(Program, std::string("uModel").c_str()), 1, GL_FALSE, &ModelMatrix[0][0]);
+            glUniform1i(glGetUniformLocation(Program, std::string("uSkinned").c_str()), 1);
+            glUniform1i(glGetUniformLocation(Program, std::string("uCompactVertices").c_str()), 1);
+            glUniform3f(glGetUniformLocation(Program, std::string("uPositionScale").c_str()), Scale.x, Scale.y, Scale.z);
+            glUniform3f(glGetUniformLocation(Program, std::string("uPositionOffset").c_str()), Offset.x, Offset.y, Offset.z);
+            glUniform1i(glGetUniformLocation(Program, std::string("uSkinned").c_str()), 0);
+        }
+        glFinish();
+    });
+
+    double Reflected = bestOf(5, [&]() {
+        for (const glm::mat4& ModelMatrix : ModelMatrices) {
+            PhongShader.SetUniform4m("uModel", ModelMatrix);
+            PhongShader.SetUniform1i("uSkinned", 1);
+            PhongShader.SetUniform1i("uCompactVertices", 1);
+            PhongShader.SetUniform3f("uPositionScale", Scale);
+            PhongShader.SetUniform3f("uPositionOffset", Offset);
+            PhongShader.SetUniform1i("uSkinned", 0);
+        }
+        glFinish();
+    });
+
+    const Shader::MeshUniforms& Uniforms = PhongShader.GetMeshUniforms();
+    double Handles = bestOf(5, [&]() {
+        for (const glm::mat4& ModelMatrix : ModelMatrices) {
+            PhongShader.Set(Uniforms.Model, ModelMatrix);
+            PhongShader.Set(Uniforms.Skinned, 1);
+            PhongShader.Set(Uniforms.CompactVertices, 1);
+            PhongShader.Set(Uniforms.PositionScale, Scale);
+            PhongShader.Set(Uniforms.PositionOffset, Offset);
+            PhongShader.Set(Uniforms.Skinned, 0);
+        }
+        glFinish();
+    });
+
+    std::cout << "  glGetUniformLocation " << GLLookup << " ms, reflected table " << Reflected << " ms, handles "
+        << Handles << " ms per frame (" << GLLookup / Handles << "x)" << std::endl;
+    PhongShader.Set(Uniforms.CompactVertices, 0);
+    GLState::UseProgram(0);
+}
+
+void
+Benchmarks::bounds() {
+    const unsigned InstanceCount = 10000;
+    Model Spider("spider/spider.obj", IMPORT_OPTIMIZE_MESHES);
+    if (!Spider.Import()) {
+        std::cerr << "  Failed to import spider/spider.obj" << std::endl;
+        return;
+    }
+
+    const Bounds& Local = Spider.GetBounds();
+    std::cout << "[Bench] Bounds, spider: box (" << Local.Min.x << ", " << Local.Min.y << ", " << Local.Min.z << ") - ("
+        << Local.Max.x << ", " << Local.Max.y << ", " << Local.Max.z << "), sphere radius " << Local.Radius << std::endl;
+
+    std::vector<glm::mat4> Matrices(InstanceCount);
+    for (unsigned InstanceIdx = 0; InstanceIdx < InstanceCount; ++InstanceIdx) {
+        glm::vec3 Position((float)(InstanceIdx % 100), 0.0f, (float)(InstanceIdx / 100));
+        Matrices[InstanceIdx] = glm::scale(glm::translate(glm::mat4(1.0f), Position), glm::vec3(0.05f));
+    }
+    std::vector<Bounds> WorldBounds(InstanceCount);
+    double TransformTime = bestOf(5, [&]() {
+        for (unsigned InstanceIdx = 0; InstanceIdx < InstanceCount; ++InstanceIdx) {
+            WorldBounds[InstanceIdx] = Local.Transform(Matrices[InstanceIdx]);
+        }
+    });
+    std::cout << "  Transformed " << InstanceCount << " instance bounds in " << TransformTime << " ms ("
+        << TransformTime * 1e6 / InstanceCount << " ns each)" << std::endl;
+
+    const unsigned VertexCount = 1000000;
+    aiMesh* Synthetic = createSyntheticMesh(VertexCount);
+    std::vector<float> Vertices((size_t)VertexCount * Mesh::VERTEX_STRIDE);
+    Bounds MeshBounds;
+    Mesh::InterleaveVertices(Synthetic, Vertices.data(), MeshBounds);
+    double FitTime = bestOf(3, [&]() {
+        MeshBounds = Bounds::FromVertices(Vertices.data(), VertexCount, Mesh::VERTEX_STRIDE);
+    });
+    std::cout << "  Bounds of " << VertexCount << " vertices in " << FitTime << " ms" << (CG_SIMD_SSE2 ? " (SSE2)" : " (scalar)") << std::endl;
+    delete Synthetic;
+}
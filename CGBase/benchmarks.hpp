@@ -0,0 +1,112 @@
+/**
+ * @file benchmarks.hpp
+ * @brief Micro benchmarks, run with: CGBase --bench <name>
+ *
+ */
+#pragma once
+#include <string>
+#include <iostream>
+
+class Benchmarks {
+public:
+    /**
+     * @brief Runs a benchmark by name. Called after the GL context is created
+     * so benchmarks are free to use GL
+     *
+     * @param name Benchmark name, "all" runs every benchmark
+     * @returns true - Benchmark found, false - Unknown benchmark
+     */
+    static bool Run(const std::string& name);
+
+private:
+    /**
+     * @brief Compares the single pass vertex interleaving with the old per-vertex
+     * temporary vector path on synthetic meshes of 10k to 10M vertices
+     *
+     */
+    static void interleave();
+
+    /**
+     * @brief Loads the scene models in the compact vertex layout and reports
+     * vertex memory saved and quantization error per model
+     *
+     */
+    static void compactVertices();
+
+    /**
+     * @brief Compares startup asset loading from loose files and from the mapped asset pack,
+     * each with a cold (dropped from the OS file cache) and a warm pass
+     *
+     */
+    static void startup();
+
+    /**
+     * @brief Loads each scene model cold, through Assimp bypassing the mesh cache, and warm,
+     * from the mesh cache, reporting load time of both
+     *
+     */
+    static void meshCache();
+
+    /**
+     * @brief Compares loading res/ textures from the source images and from baked
+     * containers, reporting load time and texture memory
+     *
+     */
+    static void bakedTextures();
+
+    /**
+     * @brief Renders a grid of spiders receding from the camera with and without LOD
+     * selection, reporting triangles submitted and GPU time per frame
+     *
+     */
+    static void lod();
+
+    /**
+     * @brief Renders the spider from a few viewpoints with and without meshlet culling,
+     * reporting triangles submitted and culled per frame
+     *
+     */
+    static void meshlets();
+
+    /**
+     * @brief Evaluates poses of a synthetic spider rig for up to 500 instances,
+     * reporting bone palette build time per instance
+     *
+     */
+    static void skinning();
+
+    /**
+     * @brief Imports the spider with every import profile, bypassing the mesh cache, and
+     * reports stage timings and geometry size of each
+     *
+     */
+    static void profiles();
+
+    /**
+     * @brief Renders 1k, 10k and 100k spiders with one draw per object and with one
+     * instanced draw per mesh, reporting frame time and draw calls of both
+     *
+     */
+    static void instancing();
+
+    /**
+     * @brief Imports a generated multi-million vertex grid through mapped buffers and through
+     * the regular path, reporting upload time and peak resident memory of both
+     *
+     */
+    static void directUpload();
+
+    /**
+     * @brief Sets the per draw uniforms of a 1000 draw frame by name through glGetUniformLocation,
+     * by name through the reflected table and through handles, reporting CPU time per frame
+     *
+     */
+    static void uniforms();
+
+    /**
+     * @brief Reports model bounds, transforms them for 10k instances and fits bounds
+     * to 1M vertices
+     *
+     */
+    static void bounds();
+};
@@ -0,0 +1,130 @@
+#include "bounds.hpp"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+Bounds::Bounds()
+    : Min(FLT_MAX), Max(-FLT_MAX), Center(0.0f), Radius(-1.0f) {
+}
+
+bool
+Bounds::IsEmpty() const {
+    return Radius < 0.0f;
+}
+
+void
+Bounds::Merge(const Bounds& other) {
+    if (other.IsEmpty()) {
+        return;
+    }
+    if (IsEmpty()) {
+        *this = other;
+        return;
+    }
+
+    Min = glm::min(Min, other.Min);
+    Max = glm::max(Max, other.Max);
+
+    // NOTE: Smallest sphere enclosing both spheres
+    glm::vec3 Offset = other.Center - Center;
+    float Distance = glm::length(Offset);
+    if (Distance + other.Radius <= Radius) {
+        return;
+    }
+    if (Distance + Radius <= other.Radius) {
+        Center = other.Center;
+        Radius = other.Radius;
+        return;
+    }
+    float MergedRadius = (Distance + Radius + other.Radius) * 0.5f;
+    Center += Offset * ((MergedRadius - Radius) / Distance);
+    Radius = MergedRadius;
+}
+
+Bounds
+Bounds::Transform(const glm::mat4& modelMatrix) const {
+    if (IsEmpty()) {
+        return *this;
+    }
+
+    // NOTE: Arvo's method - transform the box center, the extent grows by the absolute
+    // value of the rotation/scale part instead of transforming all 8 corners
+    glm::vec3 BoxCenter = (Min + Max) * 0.5f;
+    glm::vec3 Extent = (Max - Min) * 0.5f;
+    glm::vec3 AxisX(modelMatrix[0]), AxisY(modelMatrix[1]), AxisZ(modelMatrix[2]);
+    glm::vec3 TransformedCenter = glm::vec3(modelMatrix * glm::vec4(BoxCenter, 1.0f));
+    glm::vec3 TransformedExtent = glm::abs(AxisX) * Extent.x + glm::abs(AxisY) * Extent.y + glm::abs(AxisZ) * Extent.z;
+
+    Bounds Result;
+    Result.Min = TransformedCenter - TransformedExtent;
+    Result.Max = TransformedCenter + TransformedExtent;
+    Result.Center = glm::vec3(modelMatrix * glm::vec4(Center, 1.0f));
+    float Scale = std::max(glm::length(AxisX), std::max(glm::length(AxisY), glm::length(AxisZ)));
+    Result.Radius = Radius * Scale;
+    return Result;
+}
+
+Bounds
+Bounds::FromBox(const glm::vec3& min, const glm::vec3& max, const float* vertices, size_t vertexCount, unsigned stride) {
+    Bounds Result;
+    if (!vertexCount) {
+        return Result;
+    }
+
+    Result.Min = min;
+    Result.Max = max;
+    Result.Center = (min + max) * 0.5f;
+    float MaxDistanceSq = 0.0f;
+#if CG_SIMD_SSE2
+    // NOTE: Loads 4 floats per vertex, the 4th is masked off. Needs a stride of at least 4
+    if (stride >= 4) {
+        const __m128 Center4 = _mm_setr_ps(Result.Center.x, Result.Center.y, Result.Center.z, 0.0f);
+        const __m128 Mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        __m128 MaxDistanceSq4 = _mm_setzero_ps();
+        for (size_t VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx) {
+            __m128 Offset = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(vertices + VertexIdx * stride), Center4), Mask);
+            __m128 Squared = _mm_mul_ps(Offset, Offset);
+            Squared = _mm_add_ps(Squared, _mm_shuffle_ps(Squared, Squared, _MM_SHUFFLE(2, 3, 0, 1)));
+            Squared = _mm_add_ps(Squared, _mm_shuffle_ps(Squared, Squared, _MM_SHUFFLE(1, 0, 3, 2)));
+            MaxDistanceSq4 = _mm_max_ps(MaxDistanceSq4, Squared);
+        }
+        MaxDistanceSq = _mm_cvtss_f32(MaxDistanceSq4);
+        Result.Radius = std::sqrt(MaxDistanceSq);
+        return Result;
+    }
+#endif
+    for (size_t VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx) {
+        const float* Position = vertices + VertexIdx * stride;
+        glm::vec3 Offset = glm::vec3(Position[0], Position[1], Position[2]) - Result.Center;
+        MaxDistanceSq = std::max(MaxDistanceSq, glm::dot(Offset, Offset));
+    }
+    Result.Radius = std::sqrt(MaxDistanceSq);
+    return Result;
+}
+
+Bounds
+Bounds::FromVertices(const float* vertices, size_t vertexCount, unsigned stride) {
+    glm::vec3 Min(FLT_MAX), Max(-FLT_MAX);
+#if CG_SIMD_SSE2
+    if (stride >= 4) {
+        __m128 Min4 = _mm_set1_ps(FLT_MAX);
+        __m128 Max4 = _mm_set1_ps(-FLT_MAX);
+        for (size_t VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx) {
+            __m128 Position = _mm_loadu_ps(vertices + VertexIdx * stride);
+            Min4 = _mm_min_ps(Min4, Position);
+            Max4 = _mm_max_ps(Max4, Position);
+        }
+        float MinLanes[4], MaxLanes[4];
+        _mm_storeu_ps(MinLanes, Min4);
+        _mm_storeu_ps(MaxLanes, Max4);
+        return FromBox(glm::vec3(MinLanes[0], MinLanes[1], MinLanes[2]), glm::vec3(MaxLanes[0], MaxLanes[1], MaxLanes[2]), vertices, vertexCount, stride);
+    }
+#endif
+    for (size_t VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx) {
+        const float* Position = vertices + VertexIdx * stride;
+        glm::vec3 CurrPosition(Position[0], Position[1], Position[2]);
+        Min = glm::min(Min, CurrPosition);
+        Max = glm::max(Max, CurrPosition);
+    }
+    return FromBox(Min, Max, vertices, vertexCount, stride);
+}
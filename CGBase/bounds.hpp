@@ -0,0 +1,71 @@
+/**
+ * @file bounds.hpp
+ * @brief Axis aligned bounding box and bounding sphere of a mesh or model
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "simd.hpp"
+
+class Bounds {
+public:
+    glm::vec3 Min;
+    glm::vec3 Max;
+    glm::vec3 Center;
+    // NOTE: Negative for empty bounds
+    float Radius;
+
+    /**
+     * @brief Ctor - empty bounds, Merge grows them
+     *
+     */
+    Bounds();
+
+    /**
+     * @brief Checks whether the bounds contain anything
+     *
+     * @returns true - Empty, false - Contains at least one point
+     */
+    bool IsEmpty() const;
+
+    /**
+     * @brief Grows the box and sphere to also enclose other
+     *
+     * @param other Bounds to enclose
+     */
+    void Merge(const Bounds& other);
+
+    /**
+     * @brief Transforms the bounds, e.g. from model into world space. The box stays axis
+     * aligned and encloses the transformed box, the sphere scales by the largest axis scale.
+     * Constant time, cheap enough for thousands of instances per frame
+     *
+     * @param modelMatrix Affine transform
+     * @returns Transformed bounds
+     */
+    Bounds Transform(const glm::mat4& modelMatrix) const;
+
+    /**
+     * @brief Builds bounds from a box reduced elsewhere (e.g. while interleaving),
+     * fitting the sphere around the box center as tightly as the vertices allow
+     *
+     * @param min Box minimum
+     * @param max Box maximum
+     * @param vertices Interleaved vertices, position is expected in the first 3 floats
+     * @param vertexCount Number of vertices
+     * @param stride Floats per vertex
+     * @returns Bounds, empty if there are no vertices
+     */
+    static Bounds FromBox(const glm::vec3& min, const glm::vec3& max, const float* vertices, size_t vertexCount, unsigned stride);
+
+    /**
+     * @brief Builds bounds of interleaved vertices
+     *
+     * @param vertices Interleaved vertices, position is expected in the first 3 floats
+     * @param vertexCount Number of vertices
+     * @param stride Floats per vertex
+     * @returns Bounds, empty if there are no vertices
+     */
+    static Bounds FromVertices(const float* vertices, size_t vertexCount, unsigned stride);
+};
@@ -0,0 +1,54 @@
+#include "frameuniforms.hpp"
+#include <cstddef>
+
+static_assert(sizeof(FrameUniforms::Camera) == 144, "Camera must match the std140 block");
+static_assert(sizeof(FrameUniforms::PointLight) == 64, "PointLight must match the std140 struct");
+static_assert(sizeof(FrameUniforms::DirectionalLight) == 80, "DirectionalLight must match the std140 struct");
+static_assert(offsetof(FrameUniforms::Lights, PointLights) == 160, "Lights must match the std140 block");
+
+// NOTE: Indexed by EBlock
+static const char* BLOCK_NAMES[FrameUniforms::BLOCK_COUNT] = { "Camera", "Lights" };
+
+GLBuffer FrameUniforms::sBuffers[BLOCK_COUNT];
+
+void
+FrameUniforms::upload(EBlock block, const void* data, size_t size) {
+    GLBuffer& Buffer = sBuffers[block];
+    if (!Buffer.Get()) {
+        Buffer = GLBuffer::Create();
+        glBindBuffer(GL_UNIFORM_BUFFER, Buffer.Get());
+        glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, block, Buffer.Get());
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, Buffer.Get());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void
+FrameUniforms::SetCamera(const Camera& camera) {
+    upload(BLOCK_CAMERA, &camera, sizeof(camera));
+}
+
+void
+FrameUniforms::SetLights(const Lights& lights) {
+    upload(BLOCK_LIGHTS, &lights, sizeof(lights));
+}
+
+void
+FrameUniforms::BindBlocks(unsigned program) {
+    for (unsigned Block = 0; Block < BLOCK_COUNT; ++Block) {
+        unsigned BlockIdx = glGetUniformBlockIndex(program, BLOCK_NAMES[Block]);
+        if (BlockIdx != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, BlockIdx, Block);
+        }
+    }
+}
+
+void
+FrameUniforms::Shutdown() {
+    for (unsigned Block = 0; Block < BLOCK_COUNT; ++Block) {
+        sBuffers[Block].Reset();
+    }
+}
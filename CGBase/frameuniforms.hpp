@@ -0,0 +1,112 @@
+/**
+ * @file frameuniforms.hpp
+ * @brief Camera and light state shared by every program through std140 uniform blocks,
+ * uploaded once per frame
+ *
+ */
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "glresource.hpp"
+
+class FrameUniforms {
+public:
+    // NOTE: Fixed binding points, GLSL 330 has no layout(binding) so Shader binds the
+    // blocks by name after linking, see BindBlocks
+    enum EBlock {
+        BLOCK_CAMERA = 0,
+        BLOCK_LIGHTS = 1,
+        BLOCK_COUNT = 2,
+    };
+
+    static const unsigned POINT_LIGHT_COUNT = 2;
+
+    // NOTE: The structs below mirror the std140 blocks in the shaders member for member.
+    // Every vec3 is followed by a float so nothing is padded implicitly
+
+    /**
+     * @brief Camera block, see basic.vert
+     *
+     */
+    struct Camera {
+        glm::mat4 Projection;
+        glm::mat4 View;
+        glm::vec3 Position;
+        float Padding;
+    };
+
+    /**
+     * @brief PositionalLight, see phong_material_texture.frag
+     *
+     */
+    struct PointLight {
+        glm::vec3 Position;
+        float Kc;
+        glm::vec3 Ka;
+        float Kl;
+        glm::vec3 Kd;
+        float Kq;
+        glm::vec3 Ks;
+        float Padding;
+    };
+
+    /**
+     * @brief DirectionalLight, see phong_material_texture.frag. Also used for the spotlight,
+     * the directional light ignores Position, the cutoffs and the attenuation
+     *
+     */
+    struct DirectionalLight {
+        glm::vec3 Position;
+        float InnerCutOff;
+        glm::vec3 Direction;
+        float OuterCutOff;
+        glm::vec3 Ka;
+        float Kc;
+        glm::vec3 Kd;
+        float Kl;
+        glm::vec3 Ks;
+        float Kq;
+    };
+
+    /**
+     * @brief Lights block, see phong_material_texture.frag
+     *
+     */
+    struct Lights {
+        DirectionalLight DirLight;
+        DirectionalLight Spotlight;
+        PointLight PointLights[POINT_LIGHT_COUNT];
+    };
+
+    /**
+     * @brief Uploads the camera block with one buffer update. Creates and binds the buffer on first use
+     *
+     * @param camera Camera state for the frame
+     */
+    static void SetCamera(const Camera& camera);
+
+    /**
+     * @brief Uploads the lights block with one buffer update. Creates and binds the buffer on first use
+     *
+     * @param lights Light state for the frame
+     */
+    static void SetLights(const Lights& lights);
+
+    /**
+     * @brief Binds the blocks a linked program declares to their binding points
+     *
+     * @param program Program ID
+     */
+    static void BindBlocks(unsigned program);
+
+    /**
+     * @brief Deletes the block buffers. Call before GLResources::Shutdown
+     *
+     */
+    static void Shutdown();
+
+private:
+    static GLBuffer sBuffers[BLOCK_COUNT];
+
+    static void upload(EBlock block, const void* data, size_t size);
+};
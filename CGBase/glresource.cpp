@@ -0,0 +1,63 @@
+#include "glresource.hpp"
+#include "glstate.hpp"
+
+static const char* RESOURCE_NAMES[RESOURCE_KIND_COUNT] = { "buffers", "vertex arrays", "textures", "programs" };
+
+unsigned GLResources::sLive[RESOURCE_KIND_COUNT];
+bool GLResources::sContextDestroyed = false;
+
+unsigned
+GLResources::create(EResourceKind kind) {
+    unsigned Id = 0;
+    switch (kind) {
+    case RESOURCE_BUFFER: glGenBuffers(1, &Id); break;
+    case RESOURCE_VERTEX_ARRAY: glGenVertexArrays(1, &Id); break;
+    case RESOURCE_TEXTURE: glGenTextures(1, &Id); break;
+    case RESOURCE_PROGRAM: Id = glCreateProgram(); break;
+    default: break;
+    }
+    return Id;
+}
+
+void
+GLResources::adopt(EResourceKind kind) {
+    ++sLive[kind];
+}
+
+void
+GLResources::destroy(EResourceKind kind, unsigned id) {
+    --sLive[kind];
+    if (sContextDestroyed) {
+        return;
+    }
+
+    GLState::Forget(kind, id);
+    switch (kind) {
+    case RESOURCE_BUFFER: glDeleteBuffers(1, &id); break;
+    case RESOURCE_VERTEX_ARRAY: glDeleteVertexArrays(1, &id); break;
+    case RESOURCE_TEXTURE: glDeleteTextures(1, &id); break;
+    case RESOURCE_PROGRAM: glDeleteProgram(id); break;
+    default: break;
+    }
+}
+
+unsigned
+GLResources::GetLiveCount(EResourceKind kind) {
+    return sLive[kind];
+}
+
+unsigned
+GLResources::Shutdown() {
+    unsigned Leaked = 0;
+    for (unsigned Kind = 0; Kind < RESOURCE_KIND_COUNT; ++Kind) {
+        if (sLive[Kind]) {
+            std::cerr << "[Err] Leaked " << sLive[Kind] << " GL " << RESOURCE_NAMES[Kind] << std::endl;
+            Leaked += sLive[Kind];
+        }
+    }
+    if (!Leaked) {
+        std::cout << "No GL objects leaked" << std::endl;
+    }
+    sContextDestroyed = true;
+    return Leaked;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file glresource.hpp
+ * @brief Move-only owners of GL object names, with a live count per object kind
+ * reported at shutdown to catch leaks
+ *
+ */
+#pragma once
+#include <GL/glew.h>
+#include <iostream>
+
+enum EResourceKind {
+    RESOURCE_BUFFER = 0,
+    RESOURCE_VERTEX_ARRAY = 1,
+    RESOURCE_TEXTURE = 2,
+    RESOURCE_PROGRAM = 3,
+    RESOURCE_KIND_COUNT = 4,
+};
+
+template<EResourceKind Kind> class GLHandle;
+
+class GLResources {
+public:
+    /**
+     * @brief Gets the number of live GL objects of a kind owned by handles
+     *
+     * @param kind Object kind
+     * @returns Live object count
+     */
+    static unsigned GetLiveCount(EResourceKind kind);
+
+    /**
+     * @brief Reports objects still alive as leaks. Call once, while the context is still current,
+     * right before destroying it. Handles destroyed afterwards are only uncounted, deleting
+     * GL objects without a context is not allowed
+     *
+     * @returns Number of leaked objects
+     */
+    static unsigned Shutdown();
+
+private:
+    template<EResourceKind Kind> friend class GLHandle;
+
+    static unsigned sLive[RESOURCE_KIND_COUNT];
+    static bool sContextDestroyed;
+
+    static unsigned create(EResourceKind kind);
+    static void adopt(EResourceKind kind);
+    static void destroy(EResourceKind kind, unsigned id);
+};
+
+/**
+ * @brief Owns one GL object name and deletes it when destroyed. Moves transfer ownership,
+ * the moved-from handle is left empty. Must be destroyed on the context thread
+ *
+ */
+template<EResourceKind Kind>
+class GLHandle {
+public:
+    GLHandle() : mId(0) {}
+
+    /**
+     * @brief Takes ownership of an existing object name, 0 creates an empty handle
+     *
+     * @param id GL object name
+     */
+    explicit GLHandle(unsigned id) : mId(id) {
+        if (mId) {
+            GLResources::adopt(Kind);
+        }
+    }
+
+    GLHandle(GLHandle&& other) : mId(other.mId) {
+        other.mId = 0;
+    }
+
+    GLHandle& operator=(GLHandle&& other) {
+        if (this != &other) {
+            Reset();
+            mId = other.mId;
+            other.mId = 0;
+        }
+        return *this;
+    }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    ~GLHandle() {
+        Reset();
+    }
+
+    /**
+     * @brief Creates a new GL object of the handle's kind. Must be called on the context thread
+     *
+     * @returns Handle owning the object
+     */
+    static GLHandle Create() {
+        return GLHandle(GLResources::create(Kind));
+    }
+
+    /**
+     * @brief Gets the GL object name, 0 for empty handles
+     *
+     * @returns GL object name
+     */
+    unsigned Get() const { return mId; }
+
+    /**
+     * @brief Deletes the owned object, leaving the handle empty
+     *
+     */
+    void Reset() {
+        if (mId) {
+            GLResources::destroy(Kind, mId);
+            mId = 0;
+        }
+    }
+
+private:
+    unsigned mId;
+};
+
+typedef GLHandle<RESOURCE_BUFFER> GLBuffer;
+typedef GLHandle<RESOURCE_VERTEX_ARRAY> GLVertexArray;
+typedef GLHandle<RESOURCE_TEXTURE> GLTexture;
+typedef GLHandle<RESOURCE_PROGRAM> GLProgram;
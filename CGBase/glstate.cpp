@@ -0,0 +1,77 @@
+#include "glstate.hpp"
+#include "renderstats.hpp"
+
+// NOTE: Never a valid GL name, forces the next bind
+static const unsigned UNKNOWN = 0xFFFFFFFF;
+
+unsigned GLState::sProgram = UNKNOWN;
+unsigned GLState::sVertexArray = UNKNOWN;
+unsigned GLState::sActiveUnit = UNKNOWN;
+unsigned GLState::sTextures[MAX_TEXTURE_UNITS] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+    UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };
+
+void
+GLState::UseProgram(unsigned program) {
+    bool Changed = sProgram != program;
+    RenderStats::AddStateChange(Changed);
+    if (Changed) {
+        glUseProgram(program);
+        sProgram = program;
+    }
+}
+
+void
+GLState::BindVertexArray(unsigned vao) {
+    bool Changed = sVertexArray != vao;
+    RenderStats::AddStateChange(Changed);
+    if (Changed) {
+        glBindVertexArray(vao);
+        sVertexArray = vao;
+    }
+}
+
+void
+GLState::ActiveTexture(unsigned unit) {
+    bool Changed = sActiveUnit != unit;
+    RenderStats::AddStateChange(Changed);
+    if (Changed) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        sActiveUnit = unit;
+    }
+}
+
+void
+GLState::BindTexture(unsigned unit, unsigned texture) {
+    bool Changed = sTextures[unit] != texture;
+    RenderStats::AddStateChange(Changed);
+    if (Changed) {
+        ActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        sTextures[unit] = texture;
+    }
+}
+
+void
+GLState::Forget(EResourceKind kind, unsigned id) {
+    switch (kind) {
+    case RESOURCE_VERTEX_ARRAY:
+        if (sVertexArray == id) {
+            sVertexArray = UNKNOWN;
+        }
+        break;
+    case RESOURCE_TEXTURE:
+        for (unsigned& Texture : sTextures) {
+            if (Texture == id) {
+                Texture = UNKNOWN;
+            }
+        }
+        break;
+    case RESOURCE_PROGRAM:
+        // NOTE: A program in use is only flagged for deletion, but its name may be reused once it isn't
+        if (sProgram == id) {
+            sProgram = UNKNOWN;
+        }
+        break;
+    default: break;
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file glstate.hpp
+ * @brief Shadow of the bound program, VAO and 2D textures, skipping binds that change nothing.
+ * All code on the context thread binds these through GLState so the shadow stays exact
+ *
+ */
+#pragma once
+#include <GL/glew.h>
+#include "glresource.hpp"
+
+class GLState {
+public:
+    // NOTE: GL 3.3 guarantees 16 texture units in the fragment shader
+    static const unsigned MAX_TEXTURE_UNITS = 16;
+
+    /**
+     * @brief glUseProgram unless the program is already in use
+     *
+     * @param program Program ID, 0 for none
+     */
+    static void UseProgram(unsigned program);
+
+    /**
+     * @brief glBindVertexArray unless the VAO is already bound. Code binding
+     * GL_ELEMENT_ARRAY_BUFFER outside of its own VAO must bind 0 first, render paths
+     * leave their VAO bound
+     *
+     * @param vao VAO ID, 0 for none
+     */
+    static void BindVertexArray(unsigned vao);
+
+    /**
+     * @brief glActiveTexture unless the unit is already active
+     *
+     * @param unit Texture unit index, not the GL_TEXTURE0 based enum
+     */
+    static void ActiveTexture(unsigned unit);
+
+    /**
+     * @brief Binds a 2D texture to a unit unless it is already bound there. Activates the unit
+     * only when the bind is issued
+     *
+     * @param unit Texture unit index
+     * @param texture Texture ID, 0 for none
+     */
+    static void BindTexture(unsigned unit, unsigned texture);
+
+    /**
+     * @brief Forgets a deleted object. GL unbinds deleted VAOs and textures and may reuse their
+     * names, a stale shadow would then skip a needed bind. Called by GLResources
+     *
+     * @param kind Object kind
+     * @param id Deleted GL object name
+     */
+    static void Forget(EResourceKind kind, unsigned id);
+
+private:
+    static unsigned sProgram;
+    static unsigned sVertexArray;
+    static unsigned sActiveUnit;
+    static unsigned sTextures[MAX_TEXTURE_UNITS];
+};
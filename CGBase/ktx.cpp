@@ -0,0 +1,81 @@
+#include "ktx.hpp"
+#include <fstream>
+#include <cstring>
+
+static const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint32_t KTX_ENDIANNESS = 0x04030201;
+// NOTE: Identifier followed by 13 32-bit fields
+static const size_t KTX_HEADER_SIZE = 64;
+
+std::string
+Ktx::GetContainerPath(const std::string& imagePath) {
+    return imagePath + ".ktx";
+}
+
+bool
+Ktx::Parse(const unsigned char* data, size_t size, Header& header, std::vector<Level>& levels) {
+    if (size < KTX_HEADER_SIZE || memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0) {
+        return false;
+    }
+
+    uint32_t Fields[13];
+    memcpy(Fields, data + sizeof(KTX_IDENTIFIER), sizeof(Fields));
+    uint32_t Endianness = Fields[0];
+    uint32_t Depth = Fields[8], ArrayElements = Fields[9], Faces = Fields[10], LevelCount = Fields[11];
+    uint32_t KeyValueBytes = Fields[12];
+    if (Endianness != KTX_ENDIANNESS || Depth != 0 || ArrayElements != 0 || Faces != 1 || LevelCount == 0) {
+        return false;
+    }
+
+    header.Type = Fields[1];
+    header.Format = Fields[3];
+    header.InternalFormat = Fields[4];
+    header.BaseInternalFormat = Fields[5];
+    header.Width = Fields[6];
+    header.Height = Fields[7];
+
+    size_t Offset = KTX_HEADER_SIZE + KeyValueBytes;
+    levels.clear();
+    for (uint32_t LevelIdx = 0; LevelIdx < LevelCount; ++LevelIdx) {
+        uint32_t LevelSize = 0;
+        if (Offset + sizeof(LevelSize) > size) {
+            return false;
+        }
+        memcpy(&LevelSize, data + Offset, sizeof(LevelSize));
+        Offset += sizeof(LevelSize);
+        if (LevelSize > size - Offset) {
+            return false;
+        }
+
+        Level CurrLevel = { data + Offset, LevelSize };
+        levels.push_back(CurrLevel);
+        // NOTE: Levels are padded to 4 bytes
+        Offset += (LevelSize + 3) & ~3u;
+    }
+    return true;
+}
+
+bool
+Ktx::Write(const std::string& filePath, const Header& header, const std::vector<std::vector<unsigned char>>& levels) {
+    std::ofstream Out(filePath, std::ios::binary);
+    if (!Out) {
+        return false;
+    }
+
+    // NOTE: Type size is 1 for both byte and block compressed data
+    uint32_t Fields[13] = {
+        KTX_ENDIANNESS, header.Type, 1, header.Format, header.InternalFormat,
+        header.BaseInternalFormat, header.Width, header.Height, 0, 0, 1, (uint32_t)levels.size(), 0
+    };
+    Out.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    Out.write((const char*)Fields, sizeof(Fields));
+
+    const char Padding[4] = { 0 };
+    for (const std::vector<unsigned char>& CurrLevel : levels) {
+        uint32_t LevelSize = (uint32_t)CurrLevel.size();
+        Out.write((const char*)&LevelSize, sizeof(LevelSize));
+        Out.write((const char*)CurrLevel.data(), CurrLevel.size());
+        Out.write(Padding, ((LevelSize + 3) & ~3u) - LevelSize);
+    }
+    return (bool)Out;
+}
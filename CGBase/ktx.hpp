@@ -0,0 +1,64 @@
+/**
+ * @file ktx.hpp
+ * @brief Minimal KTX 1.1 container for 2D textures with a precomputed mip chain
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+
+class Ktx {
+public:
+    /**
+     * @brief Texture description as stored in the KTX header. Type and Format are 0 for compressed data
+     *
+     */
+    struct Header {
+        uint32_t Type;
+        uint32_t Format;
+        uint32_t InternalFormat;
+        uint32_t BaseInternalFormat;
+        uint32_t Width;
+        uint32_t Height;
+    };
+
+    /**
+     * @brief Single mip level inside a parsed container
+     *
+     */
+    struct Level {
+        const unsigned char* Data;
+        size_t Size;
+    };
+
+    /**
+     * @brief Returns the baked container path for a source image. Baked containers live next to the image
+     *
+     * @param imagePath Source image path
+     * @returns Container path
+     */
+    static std::string GetContainerPath(const std::string& imagePath);
+
+    /**
+     * @brief Parses a container in memory. Levels point into data, nothing is copied
+     *
+     * @param data Container contents
+     * @param size Container size in bytes
+     * @param header Output texture description
+     * @param levels Output mip levels, largest first
+     * @returns true - Success, false - Not a valid 2D KTX 1.1 container
+     */
+    static bool Parse(const unsigned char* data, size_t size, Header& header, std::vector<Level>& levels);
+
+    /**
+     * @brief Writes a container. Uncompressed levels must already have rows padded to 4 bytes
+     *
+     * @param filePath Output container path
+     * @param header Texture description
+     * @param levels Mip levels, largest first
+     * @returns true - Success, false - Failure
+     */
+    static bool Write(const std::string& filePath, const Header& header, const std::vector<std::vector<unsigned char>>& levels);
+};
@@ -11,6 +11,14 @@
 #include "model.hpp" 
 #include "renderable.hpp" 
 #include "camera.hpp"
+#include "benchmarks.hpp"
+#include "assetpack.hpp"
+#include "texturebaker.hpp"
+#include "assetstreamer.hpp"
+#include "renderstats.hpp"
+#include "frameuniforms.hpp"
+#include "renderqueue.hpp"
+#include "glstate.hpp"
 
 int WindowWidth = 800;
 int WindowHeight = 800;
@@ -40,6 +48,22 @@ struct EngineState {
     Camera* mCamera;
     float mDT;
 };
+
+/**
+ * @brief Frees streamed assets, reports leaked GL objects and terminates GLFW. Declared once the
+ * context is ready, so it is destroyed after every GL owner main declares below it
+ *
+ */
+struct ContextGuard {
+    ~ContextGuard() {
+        AssetStreamer::Shutdown();
+        TextureCache::Shutdown();
+        FrameUniforms::Shutdown();
+        GLResources::Shutdown();
+        AssetPack::Close();
+        glfwTerminate();
+    }
+};
  
 const float intensityMap[5][2] = {{0.7, 1.8} , {0.35, 0.44}, {0.22, 0.20}, {0.14, 0.07}, {0.09, 0.032}};
 
@@ -73,6 +97,12 @@ KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
     case GLFW_KEY_DOWN: UserInput->LookDown = IsDown; break;
 
     case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
+    case GLFW_KEY_F1:
+        if (action == GLFW_PRESS) {
+            RenderStats::PrintLastFrame();
+            MemoryStats::Print();
+        }
+        break;
     }
 }
 
@@ -117,29 +147,35 @@ void handleKeys(GLFWwindow* window)
 }
 
 static void
-DrawFloor(unsigned vao, const Shader& shader, unsigned diffuse, unsigned specular) {
-    glUseProgram(shader.GetId());
-    glBindVertexArray(vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuse);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specular);
+SubmitFloor(RenderQueue& queue, unsigned vao, const Shader& shader, unsigned diffuse, unsigned specular) {
     float Size = 4.0f;
     for (int i = -2; i < 4; ++i) {
         for (int j = -2; j < 4; ++j) {
             glm::mat4 Model(1.0f);
             Model = glm::translate(Model, glm::vec3(i * Size, 0.0f, j * Size));
             Model = glm::scale(Model, glm::vec3(Size, 0.1f, Size));
-            shader.SetModel(Model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            RenderQueue::DrawItem Tile = RenderQueue::CreateItem(shader, vao, 36, false, Model);
+            Tile.DiffuseTexture = diffuse;
+            Tile.SpecularTexture = specular;
+            queue.Submit(Tile);
         }
     }
-
-    glBindVertexArray(0);
-    glUseProgram(0);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // NOTE: CGBase --bench <name> runs a benchmark instead of the scene
+    std::string BenchmarkName = argc > 2 && std::string(argv[1]) == "--bench" ? argv[2] : "";
+    // NOTE: CGBase --pack [file] packs the asset directories instead of running the scene
+    if (argc > 1 && std::string(argv[1]) == "--pack") {
+        std::string PackPath = argc > 2 ? argv[2] : ASSET_PACK_PATH;
+        return AssetPack::Build(PackPath, { "res", "spider", "ki61", "shaders" }) ? 0 : -1;
+    }
+    // NOTE: CGBase --bake [raw] bakes res/ textures into KTX containers, block compressed unless raw is given
+    if (argc > 1 && std::string(argv[1]) == "--bake") {
+        EBakeFormat Format = argc > 2 && std::string(argv[2]) == "raw" ? BAKE_UNCOMPRESSED : BAKE_BLOCK_COMPRESSED;
+        return TextureBaker::BakeDirectories({ "res" }, Format) ? 0 : -1;
+    }
+
     GLFWwindow* Window = 0;
     if (!glfwInit()) {
         std::cerr << "Failed to init glfw" << std::endl;
@@ -179,58 +215,67 @@ int main() {
         return -1;
     }
 
+    ContextGuard Context;
+    AssetPack::Open(ASSET_PACK_PATH);
+
+    if (!BenchmarkName.empty()) {
+        return Benchmarks::Run(BenchmarkName) ? 0 : -1;
+    }
+
     Shader BasicShader("shaders/basic_old.vert", "shaders/basic.frag");
     Shader ColorShader("shaders/color.vert", "shaders/color.frag");
     Shader PhongShaderMaterialTexture("shaders/basic.vert", "shaders/phong_material_texture.frag");
 
     //Setup Phong shader
-    glUseProgram(PhongShaderMaterialTexture.GetId());
-    
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Direction", glm::vec3(20.0, 25.5, 10.0));
+    // NOTE: Uploaded once per frame through the Lights block, see FrameUniforms
+    FrameUniforms::Lights SceneLights = {};
+    SceneLights.DirLight.Direction = glm::vec3(20.0, 25.5, 10.0);
     //glm::vec3(0.75294f, 0.75294f, 0.75294f)
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ka", glm::vec3(0.75294f, 0.75294f, 0.75294f));
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Kd", glm::vec3(0.5f, 0.5f, 0.5f));
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(1.0f));
-
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[0].Ka", glm::vec3(1.0f, 0.843f, 0.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[0].Kd", glm::vec3(0.0f, 0.5f, 0.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[0].Ks", glm::vec3(1.0f));
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[0].Kc", 1.0f);
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[0].Kl", intensityMap[0][0]);
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[0].Kq", intensityMap[0][1]);
-
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[1].Ka", glm::vec3(1.0f, 0.843f, 0.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[1].Kd", glm::vec3(0.0f, 0.5f, 0.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uPointLights[1].Ks", glm::vec3(1.0f));
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[1].Kc", 1.0f);
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[1].Kl", intensityMap[4][0]);
-    PhongShaderMaterialTexture.SetUniform1f("uPointLights[1].Kq", intensityMap[4][1]);
-
-    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Position", glm::vec3(20.0, 25.5, 10.0));
-    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ka", glm::vec3(1.0f, 1.0f, 1.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Kd", glm::vec3(0.5f, 0.0f, 0.0f));
-    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ks", glm::vec3(1.0f));
-    PhongShaderMaterialTexture.SetUniform1f("uSpotlight.Kc", 1.0f);
-    PhongShaderMaterialTexture.SetUniform1f("uSpotlight.Kl", 0.022f);
-    PhongShaderMaterialTexture.SetUniform1f("uSpotlight.Kq", 0.0019f);
-    PhongShaderMaterialTexture.SetUniform1f("uSpotlight.InnerCutOff", glm::cos(glm::radians(1.0f)));
-    PhongShaderMaterialTexture.SetUniform1f("uSpotlight.OuterCutOff", glm::cos(glm::radians(1.5f)));
+    SceneLights.DirLight.Ka = glm::vec3(0.75294f, 0.75294f, 0.75294f);
+    SceneLights.DirLight.Kd = glm::vec3(0.5f, 0.5f, 0.5f);
+    SceneLights.DirLight.Ks = glm::vec3(1.0f);
+
+    SceneLights.PointLights[0].Position = glm::vec3(-3.0f, 12.0f, -3.5f);
+    SceneLights.PointLights[0].Ka = glm::vec3(1.0f, 0.843f, 0.0f);
+    SceneLights.PointLights[0].Kd = glm::vec3(0.0f, 0.5f, 0.0f);
+    SceneLights.PointLights[0].Ks = glm::vec3(1.0f);
+    SceneLights.PointLights[0].Kc = 1.0f;
+    SceneLights.PointLights[0].Kl = intensityMap[0][0];
+    SceneLights.PointLights[0].Kq = intensityMap[0][1];
+
+    SceneLights.PointLights[1].Position = glm::vec3(7.5f, 5.0f, 0.0f);
+    SceneLights.PointLights[1].Ka = glm::vec3(1.0f, 0.843f, 0.0f);
+    SceneLights.PointLights[1].Kd = glm::vec3(0.0f, 0.5f, 0.0f);
+    SceneLights.PointLights[1].Ks = glm::vec3(1.0f);
+    SceneLights.PointLights[1].Kc = 1.0f;
+    SceneLights.PointLights[1].Kl = intensityMap[4][0];
+    SceneLights.PointLights[1].Kq = intensityMap[4][1];
+
+    SceneLights.Spotlight.Position = glm::vec3(20.0, 25.5, 10.0);
+    SceneLights.Spotlight.Ka = glm::vec3(1.0f, 1.0f, 1.0f);
+    SceneLights.Spotlight.Kd = glm::vec3(0.5f, 0.0f, 0.0f);
+    SceneLights.Spotlight.Ks = glm::vec3(1.0f);
+    SceneLights.Spotlight.Kc = 1.0f;
+    SceneLights.Spotlight.Kl = 0.022f;
+    SceneLights.Spotlight.Kq = 0.0019f;
+    SceneLights.Spotlight.InnerCutOff = glm::cos(glm::radians(1.0f));
+    SceneLights.Spotlight.OuterCutOff = glm::cos(glm::radians(1.5f));
+
+    GLState::UseProgram(PhongShaderMaterialTexture.GetId());
     // Diminishes the light's diffuse component by half, tinting it slightly red
     PhongShaderMaterialTexture.SetUniform1i("uMaterial.Kd", 0);
     // Makes the object really shiny
     PhongShaderMaterialTexture.SetUniform1i("uMaterial.Ks", 1);
     PhongShaderMaterialTexture.SetUniform1f("uMaterial.Shininess", 128.0f);
-    glUseProgram(0);
+    GLState::UseProgram(0);
+
+    // NOTE: Resolved once, set for every light source cube
+    Shader::Uniform<glm::vec3> LightSourceColorUniform = ColorShader.GetUniform<glm::vec3>("uColor");
 
     
     //Model load
-    Model Entity("spider/spider.obj");
-    if (!Entity.Load())
-    {
-        std::cout << "Failed to load model!\n";
-        glfwTerminate();
-        return -1;
-    }
+    // NOTE: Streamed in the background, drawn once it is uploaded
+    StreamHandle Entity = AssetStreamer::RequestModel("spider/spider.obj", IMPORT_OPTIMIZE_MESHES | IMPORT_GENERATE_LODS | IMPORT_BUILD_MESHLETS);
 
     float cubeVertices[] = 
     {
@@ -268,11 +313,12 @@ int main() {
 
     Renderable cube(cubeVertices, sizeof(cubeVertices), cubeIndices, sizeof(cubeIndices));
 
-    unsigned CubeDiffuseTexture = Texture::LoadImageToTexture("res/sand.jpg");
-    unsigned CubeSpecularTexture = Texture::LoadImageToTexture("res/sand_spec.jpg");
-    unsigned PyramidDiffuseTexture = Texture::LoadImageToTexture("res/pyramid.png");
-    unsigned CarpetTexture = Texture::LoadImageToTexture("res/carpet.png");
-    unsigned MoonTexture = Texture::LoadImageToTexture("res/moon.jpg");
+    // NOTE: Handles resolve to the missing texture until the images are streamed in
+    StreamHandle CubeDiffuseTexture = AssetStreamer::RequestTexture("res/sand.jpg");
+    StreamHandle CubeSpecularTexture = AssetStreamer::RequestTexture("res/sand_spec.jpg");
+    StreamHandle PyramidDiffuseTexture = AssetStreamer::RequestTexture("res/pyramid.png");
+    StreamHandle CarpetTexture = AssetStreamer::RequestTexture("res/carpet.png");
+    StreamHandle MoonTexture = AssetStreamer::RequestTexture("res/moon.jpg");
 
     std::vector<float> CubeVertices = {
         // X     Y     Z     NX    NY    NZ    U     V    FRONT SIDE
@@ -319,21 +365,14 @@ int main() {
          0.5f,  0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, // L U
     };
 
-    unsigned CubeVAO;
-    glGenVertexArrays(1, &CubeVAO);
-    glBindVertexArray(CubeVAO);
-    unsigned CubeVBO;
-    glGenBuffers(1, &CubeVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, CubeVBO);
+    GLVertexArray CubeVAO = GLVertexArray::Create();
+    GLState::BindVertexArray(CubeVAO.Get());
+    GLBuffer CubeVBO = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, CubeVBO.Get());
     glBufferData(GL_ARRAY_BUFFER, CubeVertices.size() * sizeof(float), CubeVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    VertexFormat::SetupFullAttributes();
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 
     std::vector<float> PyramidVertices = {
         // X     Y     Z     NX    NY    NZ    U     V    FRONT SIDE
@@ -380,21 +419,14 @@ int main() {
          0.0f,  0.5f, -0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, // L U
     };
 
-    unsigned PyramidVAO;
-    glGenVertexArrays(1, &PyramidVAO);
-    glBindVertexArray(PyramidVAO);
-    unsigned PyramidVBO;
-    glGenBuffers(1, &PyramidVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, PyramidVBO);
+    GLVertexArray PyramidVAO = GLVertexArray::Create();
+    GLState::BindVertexArray(PyramidVAO.Get());
+    GLBuffer PyramidVBO = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, PyramidVBO.Get());
     glBufferData(GL_ARRAY_BUFFER, PyramidVertices.size() * sizeof(float), PyramidVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    VertexFormat::SetupFullAttributes();
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 
     glm::mat4 m(1.0f);
     glm::mat4 View = glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp());
@@ -425,9 +457,14 @@ int main() {
     int point2Direction = -1;
     int counter = 0;
 
+    bool FirstFrame = true;
+    // NOTE: spider.obj carries no skeleton, the pose only applies once an animated export is loaded
+    Skeleton::Pose SpiderPose;
+    RenderQueue Queue;
     while (!glfwWindowShouldClose(Window)) {
         glfwPollEvents();
         HandleInput(&State);
+        AssetStreamer::Update();
         
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -435,23 +472,15 @@ int main() {
         p = glm::perspective(glm::radians(90.0f), (float)WindowWidth / WindowHeight, 0.1f, 100.0f);
         View = glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp());
 
-        glUseProgram(PhongShaderMaterialTexture.GetId());
-        PhongShaderMaterialTexture.SetProjection(p);
-        PhongShaderMaterialTexture.SetView(View);
-        PhongShaderMaterialTexture.SetUniform3f("uViewPos", FPSCamera.GetPosition());
-
-        glm::vec3 PointLightPosition(-3.0f, 12.0f, -3.5f);
-        glm::vec3 PointLight2Position(7.5f, 5.0f, 0.0f);
-        
-        PhongShaderMaterialTexture.SetUniform3f("uPointLights[0].Position", PointLightPosition);
-        PhongShaderMaterialTexture.SetUniform3f("uPointLights[1].Position", PointLight2Position);
-
-        PhongShaderMaterialTexture.SetUniform1f("uPointLights[0].Kl", intensityMap[pointLightIntensity1][0]);
-        PhongShaderMaterialTexture.SetUniform1f("uPointLights[0].Kq", intensityMap[pointLightIntensity1][1]);
-        
-        PhongShaderMaterialTexture.SetUniform1f("uPointLights[1].Kl", intensityMap[pointLightIntensity2][0]);
-        PhongShaderMaterialTexture.SetUniform1f("uPointLights[1].Kq", intensityMap[pointLightIntensity2][1]);
-        
+        // NOTE: Camera and lights for every program, two buffer updates per frame
+        FrameUniforms::Camera FrameCamera = { p, View, FPSCamera.GetPosition(), 0.0f };
+        FrameUniforms::SetCamera(FrameCamera);
+        SceneLights.PointLights[0].Kl = intensityMap[pointLightIntensity1][0];
+        SceneLights.PointLights[0].Kq = intensityMap[pointLightIntensity1][1];
+        SceneLights.PointLights[1].Kl = intensityMap[pointLightIntensity2][0];
+        SceneLights.PointLights[1].Kq = intensityMap[pointLightIntensity2][1];
+        SceneLights.Spotlight.Direction = glm::vec3(carpetX, carpetY, carpetZ) - SceneLights.Spotlight.Position;
+        FrameUniforms::SetLights(SceneLights);
 
         if (counter == 5) {
             
@@ -473,74 +502,65 @@ int main() {
         
         counter++;
 
+        // NOTE: Items are sorted by program, texture and VAO, then front to back
+        Queue.Begin(FPSCamera.GetPosition(), glm::normalize(FPSCamera.GetTarget() - FPSCamera.GetPosition()), 100.0f);
+
         //carpet
         glm::mat4 ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, glm::vec3(carpetX, carpetY, carpetZ));
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(1.5, 0.01, 3.0));
-        PhongShaderMaterialTexture.SetModel(ModelMatrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, CarpetTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Direction", glm::vec3(carpetX, carpetY, carpetZ) - glm::vec3(20.0, 25.5, 10.0));
+        RenderQueue::DrawItem Item = RenderQueue::CreateItem(PhongShaderMaterialTexture, CubeVAO.Get(), CubeVertices.size() / 8, false, ModelMatrix);
+        Item.DiffuseTexture = AssetStreamer::GetTexture(CarpetTexture);
+        Queue.Submit(Item);
 
         //moon
         ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, glm::vec3(20.0, 25.5, 10.0));
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(4.0f));
-        PhongShaderMaterialTexture.SetModel(ModelMatrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, MoonTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        ModelMatrix = glm::rotate(ModelMatrix, glm::radians(45.0f), glm::vec3(1.0, 1.0, 1.0));
-        PhongShaderMaterialTexture.SetModel(ModelMatrix);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
+        Item.ModelMatrix = ModelMatrix;
+        Item.DiffuseTexture = AssetStreamer::GetTexture(MoonTexture);
+        Queue.Submit(Item);
+        Item.ModelMatrix = glm::rotate(ModelMatrix, glm::radians(45.0f), glm::vec3(1.0, 1.0, 1.0));
+        Queue.Submit(Item);
 
         //big pyramid
         ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, glm::vec3(-3.0f, 5.0f, -3.5f));
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(10.0f));
-        PhongShaderMaterialTexture.SetModel(ModelMatrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PyramidDiffuseTexture);
-        glBindVertexArray(PyramidVAO);
-        glDrawArrays(GL_TRIANGLES, 0, PyramidVertices.size() / 8);
+        Item = RenderQueue::CreateItem(PhongShaderMaterialTexture, PyramidVAO.Get(), PyramidVertices.size() / 8, false, ModelMatrix);
+        Item.DiffuseTexture = AssetStreamer::GetTexture(PyramidDiffuseTexture);
+        Queue.Submit(Item);
         
         //smol pyramid
         ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, glm::vec3(7.5f, 1.5f, 0.0f));
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(4.0f));
-        PhongShaderMaterialTexture.SetModel(ModelMatrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PyramidDiffuseTexture);
-        glBindVertexArray(PyramidVAO);
-        glDrawArrays(GL_TRIANGLES, 0, PyramidVertices.size() / 8);
+        Item.ModelMatrix = ModelMatrix;
+        Queue.Submit(Item);
 
         //spooder
         m = glm::translate(glm::mat4(1.0f), glm::vec3(3.0, 0.0, 7.0));
         m = glm::scale(m, glm::vec3(0.05, 0.05, 0.05)); 
-        PhongShaderMaterialTexture.SetModel(m);
-        Entity.Render();
+        Model& Spider = AssetStreamer::GetModel(Entity);
+        bool Animated = Spider.GetSkeleton().GetAnimationCount() > 0;
+        if (Animated) {
+            Spider.GetSkeleton().EvaluatePose(0, FrameStartTime, SpiderPose);
+        }
+        RenderView SpiderView = Model::CreateRenderView(p, View, FPSCamera.GetPosition(), WindowHeight);
+        Queue.Submit(RenderQueue::CreateModelItem(PhongShaderMaterialTexture, Spider, m, SpiderView, Animated ? &SpiderPose : nullptr));
 
-        DrawFloor(CubeVAO, PhongShaderMaterialTexture, CubeDiffuseTexture, CubeSpecularTexture);
-        
-        glUseProgram(ColorShader.GetId());
-        ColorShader.SetProjection(p);
-        ColorShader.SetView(View);
+        SubmitFloor(Queue, CubeVAO.Get(), PhongShaderMaterialTexture, AssetStreamer::GetTexture(CubeDiffuseTexture), AssetStreamer::GetTexture(CubeSpecularTexture));
         
         //pointlight source
-        m = glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f, 12.0f, -3.5f));
-        ColorShader.SetUniform3f("uColor", glm::vec3(1.0f, 0.843f, 0.0f));
-        ColorShader.SetModel(m);
-        cube.Render();
+        Item = RenderQueue::CreateItem(ColorShader, cube.GetVAO(), cube.GetIndexCount(), true, glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f, 12.0f, -3.5f)));
+        Item.ColorUniform = LightSourceColorUniform;
+        Item.Color = glm::vec3(1.0f, 0.843f, 0.0f);
+        Queue.Submit(Item);
+
+        Item.ModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(7.5f, 5.0f, 0.0f));
+        Queue.Submit(Item);
 
-        m = glm::translate(glm::mat4(1.0f), glm::vec3(7.5f, 5.0f, 0.0f));
-        ColorShader.SetUniform3f("uColor", glm::vec3(1.0f, 0.843f, 0.0f));
-        ColorShader.SetModel(m);
-        cube.Render();
+        Queue.Execute();
 
         carpetY += capetYOffset * offsetMultiplier;
         if (carpetY + capetYOffset > 0.55 && offsetMultiplier == 1)
@@ -550,8 +570,13 @@ int main() {
 
         handleKeys(Window);
 
-        glUseProgram(0);
         glfwSwapBuffers(Window);
+        RenderStats::EndFrame();
+        if (FirstFrame) {
+            // NOTE: glfwGetTime counts from glfwInit
+            std::cout << "First frame after " << glfwGetTime() * 1e3 << " ms" << std::endl;
+            FirstFrame = false;
+        }
 
         FrameEndTime = glfwGetTime();
         dt = FrameEndTime - FrameStartTime;
@@ -564,7 +589,6 @@ int main() {
         State.mDT = FrameEndTime - FrameStartTime;
     }
 
-    glfwTerminate();
     return 0;
 }
 
@@ -0,0 +1,96 @@
+#include "memorystats.hpp"
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+std::atomic<size_t> MemoryStats::sBytes[MEMORY_KIND_COUNT];
+
+MemoryStats::Counter::Counter(EMemoryKind kind)
+    : mKind(kind), mBytes(0) {
+}
+
+MemoryStats::Counter::Counter(Counter&& other)
+    : mKind(other.mKind), mBytes(other.mBytes) {
+    other.mBytes = 0;
+}
+
+MemoryStats::Counter&
+MemoryStats::Counter::operator=(Counter&& other) {
+    if (this != &other) {
+        Set(0);
+        mKind = other.mKind;
+        mBytes = other.mBytes;
+        other.mBytes = 0;
+    }
+    return *this;
+}
+
+MemoryStats::Counter::~Counter() {
+    Set(0);
+}
+
+void
+MemoryStats::Counter::Set(size_t bytes) {
+    // NOTE: Unsigned wrap-around makes a single add work for shrinking too
+    sBytes[mKind] += bytes - mBytes;
+    mBytes = bytes;
+}
+
+size_t
+MemoryStats::GetProcessBytes(EMemoryKind kind) {
+    return sBytes[kind];
+}
+
+size_t
+MemoryStats::GetResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS Counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters))) {
+        return Counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    // NOTE: Second field of statm is the resident page count
+    std::ifstream Statm("/proc/self/statm");
+    size_t TotalPages = 0, ResidentPages = 0;
+    if (!(Statm >> TotalPages >> ResidentPages)) {
+        return 0;
+    }
+    return ResidentPages * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+size_t
+MemoryStats::GetPeakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS Counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters))) {
+        return Counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    // NOTE: VmHWM is the resident high water mark, in kB
+    std::ifstream Status("/proc/self/status");
+    std::string Line;
+    while (std::getline(Status, Line)) {
+        if (Line.compare(0, 6, "VmHWM:") == 0) {
+            return (size_t)std::stoull(Line.substr(6)) * 1024;
+        }
+    }
+    return 0;
+#endif
+}
+
+void
+MemoryStats::Print() {
+    std::cout << "Geometry memory: " << GetProcessBytes(MEMORY_CPU_GEOMETRY) / 1024 << " KB CPU, "
+        << GetProcessBytes(MEMORY_GPU_GEOMETRY) / 1024 << " KB GPU, instance buffers " << GetProcessBytes(MEMORY_GPU_INSTANCES) / 1024
+        << " KB GPU, process resident " << GetResidentBytes() / 1024 << " KB" << std::endl;
+}
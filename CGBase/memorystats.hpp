@@ -0,0 +1,84 @@
+/**
+ * @file memorystats.hpp
+ * @brief Process-wide accounting of CPU and GPU geometry memory and GPU instance buffers
+ *
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+
+enum EMemoryKind {
+    // NOTE: Vertex and index data kept in system memory
+    MEMORY_CPU_GEOMETRY = 0,
+    // NOTE: Vertex and index buffers allocated in GL
+    MEMORY_GPU_GEOMETRY = 1,
+    // NOTE: Streaming per-instance buffers allocated in GL, see Model::RenderInstanced
+    MEMORY_GPU_INSTANCES = 2,
+    MEMORY_KIND_COUNT = 3,
+};
+
+class MemoryStats {
+public:
+    /**
+     * @brief Bytes held by one object, counted towards the process total. Moves with
+     * its owner and is uncounted when the owner is destroyed
+     *
+     */
+    class Counter {
+    public:
+        Counter(EMemoryKind kind);
+        Counter(Counter&& other);
+        Counter& operator=(Counter&& other);
+        ~Counter();
+
+        /**
+         * @brief Updates the bytes held by the owner
+         *
+         * @param bytes Bytes currently held
+         */
+        void Set(size_t bytes);
+
+        /**
+         * @brief Gets the bytes held by the owner
+         *
+         * @returns Bytes currently held
+         */
+        size_t Get() const { return mBytes; }
+
+    private:
+        EMemoryKind mKind;
+        size_t mBytes;
+    };
+
+    /**
+     * @brief Gets the bytes of a kind held by all live objects. Safe to call from any thread
+     *
+     * @param kind Memory kind
+     * @returns Bytes held process-wide
+     */
+    static size_t GetProcessBytes(EMemoryKind kind);
+
+    /**
+     * @brief Gets the resident set size of the process as reported by the OS
+     *
+     * @returns Resident bytes, 0 if the OS doesn't report it
+     */
+    static size_t GetResidentBytes();
+
+    /**
+     * @brief Gets the largest resident set size the process has reached so far, as reported by the OS
+     *
+     * @returns Peak resident bytes, 0 if the OS doesn't report it
+     */
+    static size_t GetPeakResidentBytes();
+
+    /**
+     * @brief Prints geometry memory and the resident set size of the process
+     *
+     */
+    static void Print();
+
+private:
+    static std::atomic<size_t> sBytes[MEMORY_KIND_COUNT];
+};
@@ -1,94 +1,486 @@
 #include "mesh.hpp"
+#include "glstate.hpp"
+#include "simd.hpp"
+#include <cfloat>
+#include <algorithm>
+
+// NOTE: A level has to drop at least this share of the previous level's triangles to be kept.
+// Below that the simplifier ran out of collapses that keep borders, seams and orientation intact
+static const float LOD_MIN_REDUCTION = 0.1f;
+
 Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath) {
     processMesh(mesh, material, resPath);
+    updateCpuBytes();
+}
+
+Mesh::Mesh(const aiMaterial* material, const std::string& resPath)
+    : mDiffusePath(getMeshTexturePath(material, resPath, aiTextureType_DIFFUSE)),
+      mSpecularPath(getMeshTexturePath(material, resPath, aiTextureType_SPECULAR)) {
+    updateCpuBytes();
+}
+
+Mesh::Mesh(std::vector<float>&& vertices, std::vector<unsigned>&& indices, const std::string& diffusePath, const std::string& specularPath)
+    : mIndices(std::move(indices)), mVertices(std::move(vertices)), mDiffusePath(diffusePath), mSpecularPath(specularPath) {
+    updateCpuBytes();
 }
 
 void
-Mesh::Render() const {
-    glBindVertexArray(mVAO);
+Mesh::updateCpuBytes() {
+    mCpuBytes.Set(mVertices.capacity() * sizeof(float) + mIndices.capacity() * sizeof(unsigned) + mLods.capacity() * sizeof(Lod)
+        + mMeshlets.capacity() * sizeof(Meshlets::Meshlet) + mSkin.capacity() * sizeof(VertexFormat::SkinVertex));
+}
 
-    if (mDiffuseTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mDiffuseTexture);
+void
+Mesh::ReleaseGeometry() {
+    // NOTE: clear keeps the allocation, swapping with an empty vector frees it
+    std::vector<float>().swap(mVertices);
+    std::vector<unsigned>().swap(mIndices);
+    std::vector<VertexFormat::SkinVertex>().swap(mSkin);
+    updateCpuBytes();
+}
+
+size_t
+Mesh::GetCpuBytes() const {
+    return mCpuBytes.Get();
+}
+
+size_t
+Mesh::GetGpuBytes() const {
+    size_t SkinBytes = mSkinned ? (size_t)mVertexCount * sizeof(VertexFormat::SkinVertex) : 0;
+    return GetVertexBufferBytes() + GetIndexBufferBytes() + SkinBytes;
+}
+
+size_t
+Mesh::GetIndexBufferBytes() const {
+    return (size_t)mIndexCount * (mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+void
+Mesh::SetTextures(unsigned diffuse, unsigned specular) {
+    mDiffuseTexture = TextureCache::Reference(diffuse);
+    mSpecularTexture = TextureCache::Reference(specular);
+}
+
+size_t
+Mesh::GetVertexBufferBytes() const {
+    return (size_t)mVertexCount * (mCompact ? sizeof(VertexFormat::CompactVertex) : VERTEX_STRIDE * sizeof(float));
+}
+
+void
+Mesh::bindMaterial(const Shader& shader) const {
+    if (mCompact) {
+        const Shader::MeshUniforms& Uniforms = shader.GetMeshUniforms();
+        shader.Set(Uniforms.CompactVertices, 1);
+        shader.Set(Uniforms.PositionScale, mQuantization.Scale);
+        shader.Set(Uniforms.PositionOffset, mQuantization.Offset);
+    }
+
+    if (mDiffuseTexture.Get()) {
+        GLState::BindTexture(0, mDiffuseTexture.Get());
     }
 
-    if (mSpecularTexture) {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, mSpecularTexture);
+    if (mSpecularTexture.Get()) {
+        GLState::BindTexture(1, mSpecularTexture.Get());
     }
+}
 
+void
+Mesh::Render(const Shader& shader, unsigned lod) const {
+    bindMaterial(shader);
     if (mIndexCount) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-        glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        unsigned IndexOffset = 0;
+        unsigned IndexCount = mIndexCount;
+        if (!mLods.empty()) {
+            const Lod& Level = mLods[std::min(lod, (unsigned)mLods.size() - 1)];
+            IndexOffset = Level.IndexOffset;
+            IndexCount = Level.IndexCount;
+        }
+        size_t IndexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        glDrawElementsBaseVertex(GL_TRIANGLES, IndexCount, mIndexType, (void*)((mFirstIndex + IndexOffset) * IndexSize), mBaseVertex);
+        RenderStats::AddDraw(IndexCount / 3);
         return;
     }
 
-    glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
-    glBindVertexArray(0);
+    glDrawArrays(GL_TRIANGLES, mBaseVertex, mVertexCount);
+    RenderStats::AddDraw(mVertexCount / 3);
+}
+
+void
+Mesh::Render(const Shader& shader, const Meshlets::Ranges& ranges) const {
+    if (ranges.IndexOffsets.empty()) {
+        return;
+    }
+
+    // NOTE: Scratch arrays for the multi draw, only ever used from the render thread
+    static std::vector<GLsizei> Counts;
+    static std::vector<const void*> Offsets;
+    static std::vector<GLint> BaseVertices;
+    size_t IndexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t RangeCount = ranges.IndexOffsets.size();
+    Counts.resize(RangeCount);
+    Offsets.resize(RangeCount);
+    BaseVertices.assign(RangeCount, mBaseVertex);
+    for (size_t RangeIdx = 0; RangeIdx < RangeCount; ++RangeIdx) {
+        Counts[RangeIdx] = ranges.IndexCounts[RangeIdx];
+        Offsets[RangeIdx] = (const void*)((mFirstIndex + ranges.IndexOffsets[RangeIdx]) * IndexSize);
+    }
+
+    bindMaterial(shader);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, Counts.data(), mIndexType, Offsets.data(), (GLsizei)RangeCount, BaseVertices.data());
+    RenderStats::AddDraw(ranges.VisibleIndexCount / 3);
+}
+
+void
+Mesh::RenderInstanced(const Shader& shader, unsigned instanceCount) const {
+    bindMaterial(shader);
+    if (mIndexCount) {
+        unsigned IndexCount = GetLodIndexCount(0);
+        size_t IndexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, IndexCount, mIndexType, (void*)(mFirstIndex * IndexSize), instanceCount, mBaseVertex);
+        RenderStats::AddDraw((uint64_t)IndexCount / 3 * instanceCount);
+        return;
+    }
+
+    glDrawArraysInstanced(GL_TRIANGLES, mBaseVertex, mVertexCount, instanceCount);
+    RenderStats::AddDraw((uint64_t)mVertexCount / 3 * instanceCount);
+}
+
+void
+Mesh::CullMeshlets(const glm::vec3& cameraPosition, const glm::vec4 frustumPlanes[6], bool coneCulling, Meshlets::Ranges& ranges) const {
+    Meshlets::Cull(mMeshletCullData, cameraPosition, frustumPlanes, coneCulling, ranges);
+}
+
+unsigned
+Mesh::GetLodCount() const {
+    return mLods.empty() ? 1 : (unsigned)mLods.size();
+}
+
+unsigned
+Mesh::GetLodIndexCount(unsigned lod) const {
+    if (mLods.empty()) {
+        return mIndexCount;
+    }
+    return mLods[std::min(lod, (unsigned)mLods.size() - 1)].IndexCount;
 }
 
 unsigned
-Mesh::loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type) {
+Mesh::SelectLod(float distance, float projectionScale, float maxPixelError) const {
+    // NOTE: Levels are ordered by increasing error, take the last one that still projects
+    // to less than maxPixelError. A camera inside the bounds always gets LOD 0
+    unsigned Selected = 0;
+    for (unsigned LodIdx = 1; LodIdx < mLods.size() && distance > 0.0f; ++LodIdx) {
+        if (mLods[LodIdx].Error * projectionScale / distance > maxPixelError) {
+            break;
+        }
+        Selected = LodIdx;
+    }
+    return Selected;
+}
+
+void
+Mesh::SetBounds(const Bounds& bounds) {
+    mBounds = bounds;
+}
+
+std::string
+Mesh::getMeshTexturePath(const aiMaterial* material, const std::string& resPath, aiTextureType type) {
     if (material && material->GetTextureCount(type) > 0) {
         aiString Path;
         if (material->GetTexture(type, 0, &Path, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS) {
-            std::string FullPath = resPath + "/" + Path.data;
-            unsigned TextureID = Texture::LoadImageToTexture(FullPath);
-            return TextureID;
+            return resPath + "/" + Path.data;
         }
     }
 
-    return 0;
+    return "";
 }
 
 void
-Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath) {
-    const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+Mesh::InterleaveVertices(const aiMesh* mesh, float* out, Bounds& bounds) {
+    // NOTE: Missing attributes read from a zero vector with a stride of 0, keeping the
+    // loop free of per-vertex branches and temporary allocations so it vectorizes
+    static const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+    const aiVector3D* Positions = mesh->mVertices;
+    const aiVector3D* Normals = mesh->HasNormals() ? mesh->mNormals : &Zero3D;
+    const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0] : &Zero3D;
+    const unsigned NormalStep = mesh->HasNormals() ? 1 : 0;
+    const unsigned TexCoordStep = mesh->HasTextureCoords(0) ? 1 : 0;
 
-    for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
-        std::vector<float> Position = { mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z };
-        mVertices.insert(mVertices.end(), Position.begin(), Position.end());
-        std::vector<float> Normals = { mesh->mNormals[VertexIndex].x, mesh->mNormals[VertexIndex].y, mesh->mNormals[VertexIndex].z };
-        mVertices.insert(mVertices.end(), Normals.begin(), Normals.end());
-        const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? &(mesh->mTextureCoords[0][VertexIndex]) : &Zero3D;
-        std::vector<float> UV = { TexCoords->x, TexCoords->y };
-        mVertices.insert(mVertices.end(), UV.begin(), UV.end());
+    const unsigned VertexCount = mesh->mNumVertices;
+#if CG_SIMD_SSE2
+    __m128 Min4 = _mm_set1_ps(FLT_MAX);
+    __m128 Max4 = _mm_set1_ps(-FLT_MAX);
+#else
+    glm::vec3 Min(FLT_MAX), Max(-FLT_MAX);
+#endif
+    for (unsigned VertexIndex = 0; VertexIndex < VertexCount; ++VertexIndex) {
+        const aiVector3D& Position = Positions[VertexIndex];
+        const aiVector3D& Normal = Normals[VertexIndex * NormalStep];
+        const aiVector3D& TexCoord = TexCoords[VertexIndex * TexCoordStep];
+        float* Vertex = out + VertexIndex * VERTEX_STRIDE;
+        Vertex[0] = Position.x;
+        Vertex[1] = Position.y;
+        Vertex[2] = Position.z;
+        Vertex[3] = Normal.x;
+        Vertex[4] = Normal.y;
+        Vertex[5] = Normal.z;
+        Vertex[6] = TexCoord.x;
+        Vertex[7] = TexCoord.y;
+#if CG_SIMD_SSE2
+        // NOTE: Built from the source, out may be a write-only mapping (see BufferDirect)
+        __m128 Position4 = _mm_setr_ps(Position.x, Position.y, Position.z, 0.0f);
+        Min4 = _mm_min_ps(Min4, Position4);
+        Max4 = _mm_max_ps(Max4, Position4);
+#else
+        Min = glm::min(Min, glm::vec3(Position.x, Position.y, Position.z));
+        Max = glm::max(Max, glm::vec3(Position.x, Position.y, Position.z));
+#endif
     }
 
+#if CG_SIMD_SSE2
+    float MinLanes[4], MaxLanes[4];
+    _mm_storeu_ps(MinLanes, Min4);
+    _mm_storeu_ps(MaxLanes, Max4);
+    glm::vec3 Min(MinLanes[0], MinLanes[1], MinLanes[2]);
+    glm::vec3 Max(MaxLanes[0], MaxLanes[1], MaxLanes[2]);
+#endif
+    // NOTE: The sphere is fitted to the source positions, never reading back out, which may be
+    // write-combined GL memory (see BufferDirect)
+    static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Assimp built with double precision");
+    bounds = Bounds::FromBox(Min, Max, &Positions[0].x, VertexCount, 3);
+}
+
+template<typename T> static unsigned
+copyIndices(const aiMesh* mesh, T* out) {
+    unsigned IndexCount = 0;
     for (unsigned FaceIndex = 0; FaceIndex < mesh->mNumFaces; ++FaceIndex) {
         const aiFace& Face = mesh->mFaces[FaceIndex];
-        mIndices.push_back(Face.mIndices[0]);
-        mIndices.push_back(Face.mIndices[1]);
-        mIndices.push_back(Face.mIndices[2]);
+        // NOTE: Triangulate leaves point and line primitives alone, those aren't drawn
+        if (Face.mNumIndices != 3) {
+            continue;
+        }
+        out[IndexCount++] = (T)Face.mIndices[0];
+        out[IndexCount++] = (T)Face.mIndices[1];
+        out[IndexCount++] = (T)Face.mIndices[2];
+    }
+    return IndexCount;
+}
+
+unsigned
+Mesh::CopyIndices(const aiMesh* mesh, unsigned* out) {
+    return copyIndices(mesh, out);
+}
+
+void
+Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath) {
+    mVertices.resize((size_t)mesh->mNumVertices * VERTEX_STRIDE);
+    InterleaveVertices(mesh, mVertices.data(), mBounds);
+
+    mIndices.resize((size_t)mesh->mNumFaces * 3);
+    mIndices.resize(CopyIndices(mesh, mIndices.data()));
+
+    mDiffusePath = getMeshTexturePath(material, resPath, aiTextureType_DIFFUSE);
+    mSpecularPath = getMeshTexturePath(material, resPath, aiTextureType_SPECULAR);
+}
+
+void
+Mesh::ImportSkin(const aiMesh* mesh, Skeleton& skeleton) {
+    mSkin.clear();
+    if (!mesh->mNumBones) {
+        return;
+    }
+
+    // NOTE: Sorted by decreasing weight, the smallest influence is replaced when a larger one comes in
+    const unsigned INFLUENCES = VertexFormat::MAX_BONE_INFLUENCES;
+    std::vector<float> Weights((size_t)mesh->mNumVertices * INFLUENCES, 0.0f);
+    std::vector<uint8_t> Bones((size_t)mesh->mNumVertices * INFLUENCES, 0);
+    for (unsigned BoneIdx = 0; BoneIdx < mesh->mNumBones; ++BoneIdx) {
+        const aiBone* Bone = mesh->mBones[BoneIdx];
+        int SkeletonBone = skeleton.AddBone(Bone->mName.C_Str(), Skeleton::ToMat4(Bone->mOffsetMatrix));
+        if (SkeletonBone < 0) {
+            std::cerr << "[Err] Bone " << Bone->mName.C_Str() << " missing from the node hierarchy or over "
+                << Skeleton::MAX_BONES << " bones, mesh left static" << std::endl;
+            return;
+        }
+
+        for (unsigned WeightIdx = 0; WeightIdx < Bone->mNumWeights; ++WeightIdx) {
+            const aiVertexWeight& Weight = Bone->mWeights[WeightIdx];
+            float* VertexWeights = &Weights[(size_t)Weight.mVertexId * INFLUENCES];
+            uint8_t* VertexBones = &Bones[(size_t)Weight.mVertexId * INFLUENCES];
+            if (Weight.mWeight <= VertexWeights[INFLUENCES - 1]) {
+                continue;
+            }
+            unsigned Slot = INFLUENCES - 1;
+            for (; Slot > 0 && VertexWeights[Slot - 1] < Weight.mWeight; --Slot) {
+                VertexWeights[Slot] = VertexWeights[Slot - 1];
+                VertexBones[Slot] = VertexBones[Slot - 1];
+            }
+            VertexWeights[Slot] = Weight.mWeight;
+            VertexBones[Slot] = (uint8_t)SkeletonBone;
+        }
     }
 
-    mVertexCount = mVertices.size() / 6;
+    mSkin.resize(mesh->mNumVertices);
+    for (unsigned VertexIdx = 0; VertexIdx < mesh->mNumVertices; ++VertexIdx) {
+        const float* VertexWeights = &Weights[(size_t)VertexIdx * INFLUENCES];
+        VertexFormat::SkinVertex& Skin = mSkin[VertexIdx];
+        float Sum = 0.0f;
+        for (unsigned Slot = 0; Slot < INFLUENCES; ++Slot) {
+            Sum += VertexWeights[Slot];
+        }
+        // NOTE: Renormalized after dropping influences, the rounding remainder goes to the largest weight
+        unsigned Total = 0;
+        for (unsigned Slot = 0; Slot < INFLUENCES; ++Slot) {
+            Skin.Bones[Slot] = Bones[(size_t)VertexIdx * INFLUENCES + Slot];
+            Skin.Weights[Slot] = Sum > 0.0f ? (uint8_t)(VertexWeights[Slot] / Sum * 255.0f + 0.5f) : 0;
+            Total += Skin.Weights[Slot];
+        }
+        if (Sum > 0.0f) {
+            Skin.Weights[0] = (uint8_t)(Skin.Weights[0] + 255 - Total);
+        }
+    }
+    updateCpuBytes();
+}
+
+void
+Mesh::Optimize() {
+    if (mIndices.empty()) {
+        return;
+    }
+
+    unsigned VertexCount = mVertices.size() / VERTEX_STRIDE;
+    VertexCache::Stats Before = VertexCache::Analyze(mIndices, VertexCount);
+    VertexCache::OptimizeVertexCache(mIndices, VertexCount);
+    VertexCache::OptimizeOverdraw(mIndices, mVertices, VERTEX_STRIDE);
+    std::vector<unsigned> Remap = VertexCache::OptimizeVertexFetch(mVertices, mIndices, VERTEX_STRIDE);
+    if (!mSkin.empty()) {
+        std::vector<VertexFormat::SkinVertex> Skin(mVertices.size() / VERTEX_STRIDE);
+        for (unsigned VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx) {
+            if (Remap[VertexIdx] < Skin.size()) {
+                Skin[Remap[VertexIdx]] = mSkin[VertexIdx];
+            }
+        }
+        mSkin.swap(Skin);
+    }
+    VertexCache::Stats After = VertexCache::Analyze(mIndices, mVertices.size() / VERTEX_STRIDE);
+    updateCpuBytes();
+    std::cout << "Optimized mesh (" << VertexCount << " vertices, " << mIndices.size() / 3 << " triangles): ACMR "
+        << Before.ACMR << " -> " << After.ACMR << ", ATVR " << Before.ATVR << " -> " << After.ATVR << std::endl;
+}
+
+void
+Mesh::GenerateLods() {
+    mLods.clear();
+    if (mIndices.empty()) {
+        return;
+    }
+
+    unsigned VertexCount = mVertices.size() / VERTEX_STRIDE;
+    // NOTE: Every level is simplified from LOD 0 so its error is measured against the source surface
+    std::vector<unsigned> Source(mIndices);
+    mLods.push_back({ 0, (unsigned)Source.size(), 0.0f });
+    for (unsigned LodIdx = 1; LodIdx < MAX_LOD_COUNT; ++LodIdx) {
+        size_t TargetIndexCount = (Source.size() >> LodIdx) / 3 * 3;
+        float Error = 0.0f;
+        std::vector<unsigned> LodIndices = MeshSimplifier::Simplify(Source, mVertices, VERTEX_STRIDE, TargetIndexCount, Error);
+        if (LodIndices.empty() || LodIndices.size() > mLods.back().IndexCount * (1.0f - LOD_MIN_REDUCTION)) {
+            break;
+        }
+
+        VertexCache::OptimizeVertexCache(LodIndices, VertexCount);
+        mLods.push_back({ (unsigned)mIndices.size(), (unsigned)LodIndices.size(), Error });
+        mIndices.insert(mIndices.end(), LodIndices.begin(), LodIndices.end());
+    }
+
+    updateCpuBytes();
+    std::cout << "Generated " << mLods.size() << " LODs, triangles:";
+    for (const Lod& Level : mLods) {
+        std::cout << " " << Level.IndexCount / 3 << " (error " << Level.Error << ")";
+    }
+    std::cout << std::endl;
+}
+
+void
+Mesh::BuildMeshlets() {
+    unsigned IndexCount = mLods.empty() ? (unsigned)mIndices.size() : mLods[0].IndexCount;
+    mMeshlets = Meshlets::Build(mIndices, IndexCount, mVertices, VERTEX_STRIDE);
+    updateCpuBytes();
+    unsigned ConeCount = 0;
+    for (const Meshlets::Meshlet& CurrMeshlet : mMeshlets) {
+        ConeCount += CurrMeshlet.ConeCutoff < 1.0f;
+    }
+    std::cout << "Built " << mMeshlets.size() << " meshlets (" << IndexCount / 3 << " triangles), "
+        << ConeCount << " with backface cones" << std::endl;
+}
+
+void
+Mesh::SetBufferRange(unsigned baseVertex, unsigned firstIndex, GLenum indexType) {
+    mBaseVertex = baseVertex;
+    mFirstIndex = firstIndex;
+    mIndexType = indexType;
+}
+
+void
+Mesh::PrepareBuffer(bool compact) {
+    mCompact = compact;
+    mVertexCount = mVertices.size() / VERTEX_STRIDE;
     mIndexCount = mIndices.size();
+    mMeshletCullData = Meshlets::Prepare(mMeshlets);
+    mSkinned = !mSkin.empty();
+    updateCpuBytes();
 
-    mDiffuseTexture = loadMeshTexture(material, resPath, aiTextureType_DIFFUSE);
-    mSpecularTexture = loadMeshTexture(material, resPath, aiTextureType_SPECULAR);
-
-    glGenVertexArrays(1, &mVAO);
-    glBindVertexArray(mVAO);
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), mVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mUploadRanges.clear();
+    if (mCompact) {
+        mStagedVertices = VertexFormat::Compact(mVertices.data(), mVertexCount, mQuantization, mQuantizationError);
+        mUploadRanges.push_back({ UPLOAD_VERTICES, (size_t)mBaseVertex * sizeof(VertexFormat::CompactVertex),
+            (const unsigned char*)mStagedVertices.data(), GetVertexBufferBytes() });
+    } else {
+        mUploadRanges.push_back({ UPLOAD_VERTICES, (size_t)mBaseVertex * VERTEX_STRIDE * sizeof(float),
+            (const unsigned char*)mVertices.data(), GetVertexBufferBytes() });
+    }
 
     if (mIndexCount) {
-        glGenBuffers(1, &mEBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndexCount * sizeof(float), mIndices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        if (mIndexType == GL_UNSIGNED_SHORT) {
+            mStagedIndices.assign(mIndices.begin(), mIndices.end());
+            mUploadRanges.push_back({ UPLOAD_INDICES, (size_t)mFirstIndex * sizeof(uint16_t),
+                (const unsigned char*)mStagedIndices.data(), GetIndexBufferBytes() });
+        } else {
+            mUploadRanges.push_back({ UPLOAD_INDICES, (size_t)mFirstIndex * sizeof(uint32_t),
+                (const unsigned char*)mIndices.data(), GetIndexBufferBytes() });
+        }
+    }
+
+    if (mSkinned) {
+        mUploadRanges.push_back({ UPLOAD_SKIN, (size_t)mBaseVertex * sizeof(VertexFormat::SkinVertex),
+            (const unsigned char*)mSkin.data(), mSkin.size() * sizeof(VertexFormat::SkinVertex) });
+    }
+}
+
+void
+Mesh::FinishBuffer() {
+    std::vector<VertexFormat::CompactVertex>().swap(mStagedVertices);
+    std::vector<uint16_t>().swap(mStagedIndices);
+    mUploadRanges.clear();
+}
+
+void
+Mesh::BufferDirect(const aiMesh* mesh, float* vertices, void* indices) {
+    mCompact = false;
+    mVertexCount = mesh->mNumVertices;
+    InterleaveVertices(mesh, vertices, mBounds);
+    if (mIndexType == GL_UNSIGNED_SHORT) {
+        mIndexCount = copyIndices(mesh, (uint16_t*)indices);
+    } else {
+        mIndexCount = copyIndices(mesh, (uint32_t*)indices);
+    }
+    mSkinned = !mSkin.empty();
+    updateCpuBytes();
+}
+
+void
+Mesh::BufferSkin() {
+    if (mSkinned) {
+        glBufferSubData(GL_ARRAY_BUFFER, (size_t)mBaseVertex * sizeof(VertexFormat::SkinVertex), mSkin.size() * sizeof(VertexFormat::SkinVertex), mSkin.data());
     }
-    glBindVertexArray(0);
 }
 
 //Mesh::Mesh(const aiMesh* mesh, aiMaterial* MeshMaterial, const std::string& resPath)
@@ -12,17 +12,72 @@
 
 #include <assimp/scene.h>
 #include <vector>
+#include <string>
+#include <cstdint>
 #include <GL/glew.h>
 #include <iostream>
 #include "texture.hpp"
+#include "texturecache.hpp"
+#include "vertexcache.hpp"
+#include "vertexformat.hpp"
+#include "shader.hpp"
+#include "meshsimplifier.hpp"
+#include "renderstats.hpp"
+#include "memorystats.hpp"
+#include "bounds.hpp"
+#include "meshlets.hpp"
+#include "skeleton.hpp"
 
 class Mesh {
 public:
+    // NOTE: Floats per interleaved vertex: position 3f, normal 3f, UV 2f
+    static const unsigned VERTEX_STRIDE = 8;
+    // NOTE: LOD 0 is the source mesh, each further level targets half the triangles of the one before
+    static const unsigned MAX_LOD_COUNT = 4;
+
+    /**
+     * @brief Range of mIndices drawn for one level of detail. All levels share the vertex buffer
+     *
+     */
+    struct Lod {
+        unsigned IndexOffset;
+        unsigned IndexCount;
+        // NOTE: Distance of the simplified surface from LOD 0, in model units
+        float Error;
+    };
+
+    enum EUploadTarget {
+        UPLOAD_VERTICES,
+        UPLOAD_INDICES,
+        UPLOAD_SKIN,
+    };
+
+    /**
+     * @brief Bytes to upload into one of the model's buffers
+     *
+     */
+    struct UploadRange {
+        EUploadTarget Target;
+        // NOTE: Byte offset in the target buffer
+        size_t Offset;
+        const unsigned char* Data;
+        size_t Bytes;
+    };
+
+    // NOTE: CPU copies of the geometry. Emptied by ReleaseGeometry once uploaded, unless the model keeps them
     std::vector<unsigned> mIndices;
     std::vector<float> mVertices;
+    std::string mDiffusePath;
+    std::string mSpecularPath;
+    // NOTE: Empty for meshes without generated LODs, mIndices is then drawn whole
+    std::vector<Lod> mLods;
+    // NOTE: Clusters of LOD 0, empty unless built at import. Kept after ReleaseGeometry for culling
+    std::vector<Meshlets::Meshlet> mMeshlets;
+    // NOTE: Bone influences per vertex, empty for static meshes. Released with the geometry
+    std::vector<VertexFormat::SkinVertex> mSkin;
 
     /**
-     * @brief Ctor - buffers mesh data
+     * @brief Ctor - processes mesh data. Call PrepareBuffer to upload it to GL
      *
      * @param mesh - Assimp mesh
      * @param MeshMaterial - Assimp material
@@ -32,20 +87,328 @@ public:
     Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
 
     /**
-     * @brief Renders the current mesh
+     * @brief Ctor - only reads the material. Geometry is written straight into GL by BufferDirect
+     *
+     * @param material - Assimp material
+     * @param resPath - Resource relative path. For loading textures, etc...
+     *
+     */
+    Mesh(const aiMaterial* material, const std::string& resPath);
+
+    /**
+     * @brief Ctor - takes already interleaved mesh data (e.g. read from the mesh cache).
+     * Call PrepareBuffer to upload it to GL
+     *
+     * @param vertices - Interleaved position/normal/UV vertex data
+     * @param indices - Triangle indices
+     * @param diffusePath - Diffuse texture path, empty if none
+     * @param specularPath - Specular texture path, empty if none
+     *
+     */
+    Mesh(std::vector<float>&& vertices, std::vector<unsigned>&& indices, const std::string& diffusePath, const std::string& specularPath);
+
+    // NOTE: Move-only, a mesh owns its geometry and texture references
+    Mesh(Mesh&& other) = default;
+    Mesh& operator=(Mesh&& other) = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    /**
+     * @brief Reads bone weights of an Assimp mesh, keeping the 4 largest per vertex.
+     * Call before Optimize, which reorders vertices and the skin with them
+     *
+     * @param mesh - Assimp mesh
+     * @param skeleton - Skeleton of the model, bones are added to it
+     *
+     */
+    void ImportSkin(const aiMesh* mesh, Skeleton& skeleton);
+
+    /**
+     * @brief Whether the uploaded mesh is skinned
+     *
+     * @returns true - Skinned, false - Static
+     */
+    bool IsSkinned() const { return mSkinned; }
+
+    /**
+     * @brief Reorders indices and vertices for vertex cache, overdraw and vertex fetch
+     * locality. Prints ACMR/ATVR before and after
+     *
+     */
+    void Optimize();
+
+    /**
+     * @brief Builds up to MAX_LOD_COUNT levels of detail with the quadric error simplifier
+     * and appends their indices to mIndices. Call after Optimize, which reorders vertices
+     *
+     */
+    void GenerateLods();
+
+    /**
+     * @brief Splits LOD 0 into meshlets for per-cluster culling. Call after Optimize,
+     * whose vertex cache order keeps neighbouring triangles together
+     *
+     */
+    void BuildMeshlets();
+
+    /**
+     * @brief Gets the number of levels of detail
+     *
+     * @returns LOD count, 1 for meshes without generated LODs
+     */
+    unsigned GetLodCount() const;
+
+    /**
+     * @brief Gets the level of detail to draw for a given projected error budget
+     *
+     * @param distance - Distance from the camera to the mesh, in model units
+     * @param projectionScale - Pixels per model unit at a distance of 1, see Model::GetProjectionScale
+     * @param maxPixelError - Largest error on screen allowed, in pixels
+     *
+     * @returns Coarsest LOD within the error budget
+     */
+    unsigned SelectLod(float distance, float projectionScale, float maxPixelError) const;
+
+    /**
+     * @brief Gets the number of indices drawn for a level of detail
+     *
+     * @param lod - Level of detail, clamped to the coarsest one
+     *
+     * @returns Index count, 0 before PrepareBuffer
+     */
+    unsigned GetLodIndexCount(unsigned lod) const;
+
+    /**
+     * @brief Whether LOD 0 can be drawn meshlet by meshlet, see CullMeshlets
+     *
+     * @returns true - Has meshlets, false - Drawn whole
+     */
+    bool HasMeshlets() const { return !mMeshletCullData.Radius.empty(); }
+
+    /**
+     * @brief Culls the meshlets of LOD 0 against the frustum and, if enabled, by their normal cones
+     *
+     * @param cameraPosition - Camera position, in model space
+     * @param frustumPlanes - Frustum planes, in model space, see Meshlets::Cull
+     * @param coneCulling - Whether to reject meshlets facing away from the camera
+     * @param ranges - Output visible index ranges, relative to the mesh's indices
+     *
+     */
+    void CullMeshlets(const glm::vec3& cameraPosition, const glm::vec4 frustumPlanes[6], bool coneCulling, Meshlets::Ranges& ranges) const;
+
+    /**
+     * @brief Bounding box and sphere, computed at import
+     *
+     * @returns Bounds in model space
+     */
+    const Bounds& GetBounds() const { return mBounds; }
+
+    /**
+     * @brief Sets bounds computed elsewhere (e.g. read from the mesh cache)
+     *
+     * @param bounds - Bounds in model space
+     *
+     */
+    void SetBounds(const Bounds& bounds);
+
+    /**
+     * @brief Places the mesh in the vertex and index buffers shared by its model. Call before PrepareBuffer
+     *
+     * @param baseVertex - First vertex of the mesh in the shared vertex buffer
+     * @param firstIndex - First index of the mesh in the shared index buffer
+     * @param indexType - Index type of the shared index buffer, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     *
+     */
+    void SetBufferRange(unsigned baseVertex, unsigned firstIndex, GLenum indexType);
+
+    /**
+     * @brief Converts mesh data to its buffer layout and lists where it goes in the ranges
+     * given by SetBufferRange. The model uploads the ranges, in parts when streaming
+     *
+     * @param compact - Upload in the compact quantized layout (VertexFormat::CompactVertex)
+     *
+     */
+    void PrepareBuffer(bool compact = false);
+
+    /**
+     * @brief Gets the ranges listed by PrepareBuffer
+     *
+     * @returns Ranges to upload, valid until FinishBuffer
+     */
+    const std::vector<UploadRange>& GetUploadRanges() const { return mUploadRanges; }
+
+    /**
+     * @brief Frees the converted data of PrepareBuffer once its ranges are uploaded
+     *
+     */
+    void FinishBuffer();
+
+    /**
+     * @brief Uploads the skin into the model's skin buffer, at the mesh's base vertex.
+     * The skin buffer must be bound to GL_ARRAY_BUFFER
+     *
+     */
+    void BufferSkin();
+
+    /**
+     * @brief Interleaves an Assimp mesh straight into mapped GL buffers, without a copy in system
+     * memory. Call SetBufferRange first. Leaves the mesh without CPU geometry, as after ReleaseGeometry
+     *
+     * @param mesh - Assimp mesh
+     * @param vertices - Mapped vertex buffer at the mesh's base vertex, full vertex layout
+     * @param indices - Mapped index buffer at the mesh's first index, in the mesh's index type
+     *
+     */
+    void BufferDirect(const aiMesh* mesh, float* vertices, void* indices);
+
+    /**
+     * @brief Frees the CPU copies of vertices and indices. Rendering only needs the uploaded buffers
+     *
+     */
+    void ReleaseGeometry();
+
+    /**
+     * @brief Gets the number of uploaded vertices
+     *
+     * @returns Vertex count, 0 before PrepareBuffer
+     */
+    unsigned GetVertexCount() const { return mVertexCount; }
+
+    /**
+     * @brief Gets the number of uploaded indices, all LODs included
+     *
+     * @returns Index count, 0 before PrepareBuffer
+     */
+    unsigned GetIndexCount() const { return mIndexCount; }
+
+    /**
+     * @brief System memory held by the mesh's geometry
+     *
+     * @returns CPU bytes
+     */
+    size_t GetCpuBytes() const;
+
+    /**
+     * @brief GL memory used by the mesh, its ranges of the shared buffers
+     *
+     * @returns GPU bytes
+     */
+    size_t GetGpuBytes() const;
+
+    /**
+     * @brief Size of the mesh's range in the shared vertex buffer
+     *
+     * @returns Vertex buffer size in bytes
+     */
+    size_t GetVertexBufferBytes() const;
+
+    /**
+     * @brief Largest error introduced by the compact vertex layout, zero for full float meshes
+     *
+     * @returns Quantization error
+     */
+    const VertexFormat::Error& GetQuantizationError() const { return mQuantizationError; }
+
+    /**
+     * @brief Whether the mesh uses the compact quantized layout
+     *
+     * @returns true - Compact layout, false - Full float layout
+     */
+    bool IsCompact() const { return mCompact; }
+
+    /**
+     * @brief Size of the mesh's range in the shared index buffer. Indices are relative
+     * to the base vertex, so they are 16-bit unless a mesh of the model has more than 65536 vertices
+     *
+     * @returns Index buffer size in bytes
+     */
+    size_t GetIndexBufferBytes() const;
+
+    /**
+     * @brief Sets the textures used when rendering. Textures are loaded by the owning
+     * Model in one batch, since meshes often share them. Takes over one texture cache
+     * reference of each, released with the mesh
+     *
+     * @param diffuse - Diffuse TextureID from TextureCache, 0 if none
+     * @param specular - Specular TextureID from TextureCache, 0 if none
+     *
+     */
+    void SetTextures(unsigned diffuse, unsigned specular);
+
+    /**
+     * @brief Renders the current mesh with a base vertex draw. The model's VAO must be bound.
+     * Compact meshes set their dequantization uniforms on shader
+     *
+     * @param shader - Shader the mesh is rendered with, must be in use
+     * @param lod - Level of detail to draw, clamped to the coarsest one
+     *
+     */
+    void Render(const Shader& shader, unsigned lod = 0) const;
+
+    /**
+     * @brief Renders index ranges of the mesh with a single multi draw. The model's VAO must be bound
+     *
+     * @param shader - Shader the mesh is rendered with, must be in use
+     * @param ranges - Index ranges, e.g. visible meshlets from CullMeshlets
+     *
+     */
+    void Render(const Shader& shader, const Meshlets::Ranges& ranges) const;
+
+    /**
+     * @brief Renders LOD 0 of the mesh instanceCount times with one instanced base vertex draw.
+     * The model's VAO, with its per-instance attributes, must be bound
+     *
+     * @param shader - Shader the mesh is rendered with, must be in use
+     * @param instanceCount - Number of instances
+     *
+     */
+    void RenderInstanced(const Shader& shader, unsigned instanceCount) const;
+
+    /**
+     * @brief Interleaves position/normal/UV of an Assimp mesh in a single pass, reducing
+     * the bounding box on the way. Missing normals and UVs are written as zeros
+     *
+     * @param mesh - Assimp mesh
+     * @param out - Output, must have room for mNumVertices * VERTEX_STRIDE floats. Only written,
+     * so it may point into a mapped GL buffer
+     * @param bounds - Output bounds of the positions
+     *
+     */
+    static void InterleaveVertices(const aiMesh* mesh, float* out, Bounds& bounds);
+
+    /**
+     * @brief Copies triangle indices of an Assimp mesh, skipping non-triangle faces
+     *
+     * @param mesh - Assimp mesh
+     * @param out - Output, must have room for mNumFaces * 3 indices
      *
+     * @returns Number of indices written
      */
-    void Render() const;
+    static unsigned CopyIndices(const aiMesh* mesh, unsigned* out);
 
 private:
-    unsigned mVAO;
-    unsigned mVBO;
-    unsigned mEBO;
-    unsigned mVertexCount;
-    unsigned mIndexCount;
-    unsigned mDiffuseTexture;
-    unsigned mSpecularTexture;
-    unsigned loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type);
+    unsigned mBaseVertex = 0;
+    unsigned mFirstIndex = 0;
+    unsigned mVertexCount = 0;
+    unsigned mIndexCount = 0;
+    GLenum mIndexType = GL_UNSIGNED_INT;
+    bool mCompact = false;
+    bool mSkinned = false;
+    VertexFormat::Quantization mQuantization;
+    VertexFormat::Error mQuantizationError = { 0.0f, 0.0f, 0.0f };
+    Bounds mBounds;
+    Meshlets::CullData mMeshletCullData;
+    TextureCache::Reference mDiffuseTexture;
+    TextureCache::Reference mSpecularTexture;
+    MemoryStats::Counter mCpuBytes{ MEMORY_CPU_GEOMETRY };
+    // NOTE: Converted geometry between PrepareBuffer and FinishBuffer, empty when the
+    // buffer layout matches mVertices and mIndices
+    std::vector<VertexFormat::CompactVertex> mStagedVertices;
+    std::vector<uint16_t> mStagedIndices;
+    std::vector<UploadRange> mUploadRanges;
+    void updateCpuBytes();
+    void bindMaterial(const Shader& shader) const;
+    std::string getMeshTexturePath(const aiMaterial* material, const std::string& resPath, aiTextureType type);
     void processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
 };
 
@@ -0,0 +1,339 @@
+#include "meshcache.hpp"
+#include <sys/stat.h>
+#include <cstdio>
+
+std::string
+MeshCache::GetCachePath(const std::string& modelPath) {
+    return modelPath + ".meshcache";
+}
+
+bool
+MeshCache::getSourceKey(const std::string& modelPath, SourceKey& key) {
+    struct stat Info;
+    if (stat(modelPath.c_str(), &Info) != 0) {
+        return false;
+    }
+
+    key.Size = (uint64_t)Info.st_size;
+    key.ModifiedTime = (int64_t)Info.st_mtime;
+    return true;
+}
+
+bool
+MeshCache::readString(std::ifstream& in, std::string& str) {
+    uint32_t Length = 0;
+    in.read((char*)&Length, sizeof(Length));
+    if (!in || Length > 4096) {
+        return false;
+    }
+
+    str.resize(Length);
+    in.read(&str[0], Length);
+    return (bool)in;
+}
+
+void
+MeshCache::writeString(std::ofstream& out, const std::string& str) {
+    uint32_t Length = (uint32_t)str.size();
+    out.write((const char*)&Length, sizeof(Length));
+    out.write(str.data(), Length);
+}
+
+/**
+ * @brief Bytes between the read position and the end of the file. Counts read from a
+ * corrupt cache are checked against it before anything is allocated
+ *
+ */
+static uint64_t
+bytesLeft(std::ifstream& in) {
+    std::streampos Position = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos End = in.tellg();
+    in.seekg(Position);
+    if (!in || Position < 0 || End < Position) {
+        return 0;
+    }
+    return (uint64_t)(End - Position);
+}
+
+template<typename T> static bool
+readVector(std::ifstream& in, std::vector<T>& data) {
+    uint32_t Count = 0;
+    in.read((char*)&Count, sizeof(Count));
+    if (!in || (uint64_t)Count * sizeof(T) > bytesLeft(in)) {
+        return false;
+    }
+    data.resize(Count);
+    in.read((char*)data.data(), Count * sizeof(T));
+    return (bool)in;
+}
+
+template<typename T> static void
+writeVector(std::ofstream& out, const std::vector<T>& data) {
+    uint32_t Count = (uint32_t)data.size();
+    out.write((const char*)&Count, sizeof(Count));
+    out.write((const char*)data.data(), Count * sizeof(T));
+}
+
+bool
+MeshCache::readSkeleton(std::ifstream& in, Skeleton& skeleton) {
+    uint32_t AnimationCount = 0;
+    if (!readVector(in, skeleton.mParents) || !readVector(in, skeleton.mBindLocals) || !readVector(in, skeleton.mBoneNodes)
+        || !readVector(in, skeleton.mInverseBinds)) {
+        return false;
+    }
+    in.read((char*)&skeleton.mGlobalInverse, sizeof(skeleton.mGlobalInverse));
+    in.read((char*)&AnimationCount, sizeof(AnimationCount));
+    if (!in) {
+        return false;
+    }
+    // NOTE: Each animation stores at least its duration and three vector counts
+    if ((uint64_t)AnimationCount * (sizeof(float) + 3 * sizeof(uint32_t)) > bytesLeft(in)) {
+        return false;
+    }
+
+    // NOTE: Indices are checked so a corrupt cache can't make EvaluatePose read out of bounds
+    size_t NodeCount = skeleton.mParents.size();
+    if (skeleton.mBindLocals.size() != NodeCount || skeleton.mInverseBinds.size() != skeleton.mBoneNodes.size()
+        || skeleton.mBoneNodes.size() > Skeleton::MAX_BONES) {
+        return false;
+    }
+    for (size_t NodeIdx = 0; NodeIdx < NodeCount; ++NodeIdx) {
+        if (skeleton.mParents[NodeIdx] >= (int)NodeIdx) {
+            return false;
+        }
+    }
+    for (unsigned Node : skeleton.mBoneNodes) {
+        if (Node >= NodeCount) {
+            return false;
+        }
+    }
+
+    skeleton.mAnimations.resize(AnimationCount);
+    for (Skeleton::Animation& CurrAnimation : skeleton.mAnimations) {
+        in.read((char*)&CurrAnimation.Duration, sizeof(CurrAnimation.Duration));
+        if (!in || !readVector(in, CurrAnimation.Tracks) || !readVector(in, CurrAnimation.Times) || !readVector(in, CurrAnimation.Keys)
+            || CurrAnimation.Times.size() != CurrAnimation.Keys.size()) {
+            return false;
+        }
+        for (const Skeleton::Track& CurrTrack : CurrAnimation.Tracks) {
+            if (CurrTrack.Node >= NodeCount) {
+                return false;
+            }
+            for (unsigned KeyType = 0; KeyType < Skeleton::KEY_TYPE_COUNT; ++KeyType) {
+                if ((size_t)CurrTrack.KeyOffset[KeyType] + CurrTrack.KeyCount[KeyType] > CurrAnimation.Times.size()) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void
+MeshCache::writeSkeleton(std::ofstream& out, const Skeleton& skeleton) {
+    writeVector(out, skeleton.mParents);
+    writeVector(out, skeleton.mBindLocals);
+    writeVector(out, skeleton.mBoneNodes);
+    writeVector(out, skeleton.mInverseBinds);
+    out.write((const char*)&skeleton.mGlobalInverse, sizeof(skeleton.mGlobalInverse));
+    uint32_t AnimationCount = (uint32_t)skeleton.mAnimations.size();
+    out.write((const char*)&AnimationCount, sizeof(AnimationCount));
+    for (const Skeleton::Animation& CurrAnimation : skeleton.mAnimations) {
+        out.write((const char*)&CurrAnimation.Duration, sizeof(CurrAnimation.Duration));
+        writeVector(out, CurrAnimation.Tracks);
+        writeVector(out, CurrAnimation.Times);
+        writeVector(out, CurrAnimation.Keys);
+    }
+}
+
+bool
+MeshCache::Read(const std::string& modelPath, unsigned postprocessFlags, unsigned importOptions, std::vector<Entry>& entries, Skeleton& skeleton) {
+    SourceKey Key;
+    if (!getSourceKey(modelPath, Key)) {
+        return false;
+    }
+
+    std::ifstream In(GetCachePath(modelPath), std::ios::binary);
+    if (!In) {
+        return false;
+    }
+
+    uint32_t Magic = 0, Version = 0, Flags = 0, Options = 0;
+    SourceKey CachedKey;
+    std::string CachedPath;
+    In.read((char*)&Magic, sizeof(Magic));
+    In.read((char*)&Version, sizeof(Version));
+    In.read((char*)&Flags, sizeof(Flags));
+    In.read((char*)&Options, sizeof(Options));
+    In.read((char*)&CachedKey.Size, sizeof(CachedKey.Size));
+    In.read((char*)&CachedKey.ModifiedTime, sizeof(CachedKey.ModifiedTime));
+    if (!In || !readString(In, CachedPath)) {
+        return false;
+    }
+
+    if (Magic != MAGIC || Version != VERSION || Flags != postprocessFlags || Options != importOptions || CachedPath != modelPath
+        || CachedKey.Size != Key.Size || CachedKey.ModifiedTime != Key.ModifiedTime) {
+        std::cout << "Mesh cache for " << modelPath << " is stale" << std::endl;
+        return false;
+    }
+
+    uint32_t MeshCount = 0;
+    In.read((char*)&MeshCount, sizeof(MeshCount));
+    if (!In) {
+        return false;
+    }
+    // NOTE: Each mesh stores at least five counts and its bounds
+    const uint64_t MinEntryBytes = 5 * sizeof(uint32_t) + sizeof(Bounds);
+    if ((uint64_t)MeshCount * MinEntryBytes > bytesLeft(In)) {
+        std::cerr << "[Err] Mesh cache for " << modelPath << " is truncated" << std::endl;
+        return false;
+    }
+
+    entries.resize(MeshCount);
+    // NOTE: Headers and mesh data are laid out in file order so the whole cache
+    // is consumed front to back, straight into the destination vectors
+    for (Entry& CurrEntry : entries) {
+        uint32_t VertexFloats = 0, IndexCount = 0, LodCount = 0, MeshletCount = 0, SkinCount = 0;
+        In.read((char*)&VertexFloats, sizeof(VertexFloats));
+        In.read((char*)&IndexCount, sizeof(IndexCount));
+        In.read((char*)&LodCount, sizeof(LodCount));
+        In.read((char*)&MeshletCount, sizeof(MeshletCount));
+        In.read((char*)&SkinCount, sizeof(SkinCount));
+        In.read((char*)&CurrEntry.MeshBounds, sizeof(CurrEntry.MeshBounds));
+        if (VertexFloats % Mesh::VERTEX_STRIDE || LodCount > Mesh::MAX_LOD_COUNT || MeshletCount > IndexCount / 3
+            || (SkinCount && SkinCount * Mesh::VERTEX_STRIDE != VertexFloats)) {
+            entries.clear();
+            return false;
+        }
+        if (!In || !readString(In, CurrEntry.DiffusePath) || !readString(In, CurrEntry.SpecularPath)) {
+            entries.clear();
+            return false;
+        }
+        uint64_t DataBytes = (uint64_t)VertexFloats * sizeof(float) + (uint64_t)IndexCount * sizeof(unsigned)
+            + (uint64_t)LodCount * sizeof(Mesh::Lod) + (uint64_t)MeshletCount * sizeof(Meshlets::Meshlet)
+            + (uint64_t)SkinCount * sizeof(VertexFormat::SkinVertex);
+        if (DataBytes > bytesLeft(In)) {
+            std::cerr << "[Err] Mesh cache for " << modelPath << " is truncated" << std::endl;
+            entries.clear();
+            return false;
+        }
+
+        CurrEntry.Vertices.resize(VertexFloats);
+        CurrEntry.Indices.resize(IndexCount);
+        CurrEntry.Lods.resize(LodCount);
+        CurrEntry.MeshletList.resize(MeshletCount);
+        CurrEntry.Skin.resize(SkinCount);
+        In.read((char*)CurrEntry.Vertices.data(), VertexFloats * sizeof(float));
+        In.read((char*)CurrEntry.Indices.data(), IndexCount * sizeof(unsigned));
+        In.read((char*)CurrEntry.Lods.data(), LodCount * sizeof(Mesh::Lod));
+        In.read((char*)CurrEntry.MeshletList.data(), MeshletCount * sizeof(Meshlets::Meshlet));
+        In.read((char*)CurrEntry.Skin.data(), SkinCount * sizeof(VertexFormat::SkinVertex));
+        if (!In) {
+            entries.clear();
+            return false;
+        }
+    }
+
+    if (!readSkeleton(In, skeleton)) {
+        entries.clear();
+        return false;
+    }
+    for (const Entry& CurrEntry : entries) {
+        if (!checkEntry(CurrEntry, skeleton.mBoneNodes.size())) {
+            std::cerr << "[Err] Mesh cache for " << modelPath << " is corrupt" << std::endl;
+            entries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+MeshCache::checkEntry(const Entry& entry, size_t boneCount) {
+    // NOTE: Ranges and indices are checked so a corrupt cache can't make the draws or
+    // the skinning shader read out of bounds
+    size_t VertexCount = entry.Vertices.size() / Mesh::VERTEX_STRIDE;
+    size_t IndexCount = entry.Indices.size();
+    for (unsigned Index : entry.Indices) {
+        if (Index >= VertexCount) {
+            return false;
+        }
+    }
+    for (const Mesh::Lod& CurrLod : entry.Lods) {
+        if ((size_t)CurrLod.IndexOffset + CurrLod.IndexCount > IndexCount) {
+            return false;
+        }
+    }
+    for (const Meshlets::Meshlet& CurrMeshlet : entry.MeshletList) {
+        if ((size_t)CurrMeshlet.IndexOffset + CurrMeshlet.IndexCount > IndexCount) {
+            return false;
+        }
+    }
+    for (const VertexFormat::SkinVertex& CurrSkin : entry.Skin) {
+        for (uint8_t Bone : CurrSkin.Bones) {
+            if (Bone >= boneCount) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+MeshCache::Write(const std::string& modelPath, unsigned postprocessFlags, unsigned importOptions, const std::vector<Mesh>& meshes, const Skeleton& skeleton) {
+    SourceKey Key;
+    if (!getSourceKey(modelPath, Key)) {
+        return false;
+    }
+
+    std::string CachePath = GetCachePath(modelPath);
+    std::ofstream Out(CachePath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        std::cerr << "[Err] Failed to open mesh cache for writing: " << CachePath << std::endl;
+        return false;
+    }
+
+    uint32_t Magic = MAGIC, Version = VERSION, Flags = postprocessFlags, Options = importOptions;
+    Out.write((const char*)&Magic, sizeof(Magic));
+    Out.write((const char*)&Version, sizeof(Version));
+    Out.write((const char*)&Flags, sizeof(Flags));
+    Out.write((const char*)&Options, sizeof(Options));
+    Out.write((const char*)&Key.Size, sizeof(Key.Size));
+    Out.write((const char*)&Key.ModifiedTime, sizeof(Key.ModifiedTime));
+    writeString(Out, modelPath);
+
+    uint32_t MeshCount = (uint32_t)meshes.size();
+    Out.write((const char*)&MeshCount, sizeof(MeshCount));
+    for (const Mesh& CurrMesh : meshes) {
+        uint32_t VertexFloats = (uint32_t)CurrMesh.mVertices.size();
+        uint32_t IndexCount = (uint32_t)CurrMesh.mIndices.size();
+        uint32_t LodCount = (uint32_t)CurrMesh.mLods.size();
+        uint32_t MeshletCount = (uint32_t)CurrMesh.mMeshlets.size();
+        uint32_t SkinCount = (uint32_t)CurrMesh.mSkin.size();
+        Out.write((const char*)&VertexFloats, sizeof(VertexFloats));
+        Out.write((const char*)&IndexCount, sizeof(IndexCount));
+        Out.write((const char*)&LodCount, sizeof(LodCount));
+        Out.write((const char*)&MeshletCount, sizeof(MeshletCount));
+        Out.write((const char*)&SkinCount, sizeof(SkinCount));
+        Out.write((const char*)&CurrMesh.GetBounds(), sizeof(Bounds));
+        writeString(Out, CurrMesh.mDiffusePath);
+        writeString(Out, CurrMesh.mSpecularPath);
+        Out.write((const char*)CurrMesh.mVertices.data(), VertexFloats * sizeof(float));
+        Out.write((const char*)CurrMesh.mIndices.data(), IndexCount * sizeof(unsigned));
+        Out.write((const char*)CurrMesh.mLods.data(), LodCount * sizeof(Mesh::Lod));
+        Out.write((const char*)CurrMesh.mMeshlets.data(), MeshletCount * sizeof(Meshlets::Meshlet));
+        Out.write((const char*)CurrMesh.mSkin.data(), SkinCount * sizeof(VertexFormat::SkinVertex));
+    }
+    writeSkeleton(Out, skeleton);
+
+    if (!Out) {
+        std::cerr << "[Err] Failed to write mesh cache: " << CachePath << std::endl;
+        Out.close();
+        std::remove(CachePath.c_str());
+        return false;
+    }
+
+    std::cout << "Wrote mesh cache " << CachePath << std::endl;
+    return true;
+}
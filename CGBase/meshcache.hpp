@@ -0,0 +1,81 @@
+/**
+ * @file meshcache.hpp
+ * @brief Versioned binary cache of imported, interleaved mesh data
+ *
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <iostream>
+#include "mesh.hpp"
+
+class MeshCache {
+public:
+    // NOTE: Bump whenever the on-disk layout or the interleaved vertex layout changes
+    static const uint32_t VERSION = 6;
+    static const uint32_t MAGIC = 0x434D4743; // "CGMC"
+
+    /**
+     * @brief Mesh data as stored in the cache, laid out exactly like Mesh::mVertices/mIndices/mLods/mMeshlets
+     *
+     */
+    struct Entry {
+        std::vector<float> Vertices;
+        std::vector<unsigned> Indices;
+        std::vector<Mesh::Lod> Lods;
+        std::vector<Meshlets::Meshlet> MeshletList;
+        std::vector<VertexFormat::SkinVertex> Skin;
+        Bounds MeshBounds;
+        std::string DiffusePath;
+        std::string SpecularPath;
+    };
+
+    /**
+     * @brief Returns the cache file path for a model. Cache lives next to the source model
+     *
+     * @param modelPath Source model path
+     * @returns Cache file path
+     */
+    static std::string GetCachePath(const std::string& modelPath);
+
+    /**
+     * @brief Reads cached meshes in one sequential pass. Fails if the cache is missing
+     * or stale (different version, source path, source size/mtime, postprocess flags or import options)
+     *
+     * @param modelPath Source model path
+     * @param postprocessFlags Assimp postprocess flags the cache was built with
+     * @param importOptions Model import options the cache was built with
+     * @param entries Output mesh data
+     * @param skeleton Output skeleton and animations, empty for static models
+     * @returns true - Cache hit, false - Cache miss
+     */
+    static bool Read(const std::string& modelPath, unsigned postprocessFlags, unsigned importOptions, std::vector<Entry>& entries, Skeleton& skeleton);
+
+    /**
+     * @brief Writes meshes to the cache file, keyed by the current state of the source model
+     *
+     * @param modelPath Source model path
+     * @param postprocessFlags Assimp postprocess flags used for import
+     * @param importOptions Model import options used for import
+     * @param meshes Imported meshes
+     * @param skeleton Imported skeleton and animations
+     * @returns true - Success, false - Failure
+     */
+    static bool Write(const std::string& modelPath, unsigned postprocessFlags, unsigned importOptions, const std::vector<Mesh>& meshes, const Skeleton& skeleton);
+
+private:
+    struct SourceKey {
+        uint64_t Size;
+        int64_t ModifiedTime;
+    };
+
+    static bool getSourceKey(const std::string& modelPath, SourceKey& key);
+    static bool readString(std::ifstream& in, std::string& str);
+    static void writeString(std::ofstream& out, const std::string& str);
+    static bool readSkeleton(std::ifstream& in, Skeleton& skeleton);
+    static bool checkEntry(const Entry& entry, size_t boneCount);
+    static void writeSkeleton(std::ofstream& out, const Skeleton& skeleton);
+};
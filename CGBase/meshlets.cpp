@@ -0,0 +1,201 @@
+#include "meshlets.hpp"
+#include "simd.hpp"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+static const unsigned INVALID_MESHLET = 0xFFFFFFFF;
+
+static void
+finishMeshlet(const std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride, Meshlets::Meshlet& meshlet) {
+    glm::vec3 Min(FLT_MAX), Max(-FLT_MAX);
+    for (unsigned IndexIdx = meshlet.IndexOffset; IndexIdx < meshlet.IndexOffset + meshlet.IndexCount; ++IndexIdx) {
+        const float* Position = &vertices[(size_t)indices[IndexIdx] * stride];
+        glm::vec3 CurrPosition(Position[0], Position[1], Position[2]);
+        Min = glm::min(Min, CurrPosition);
+        Max = glm::max(Max, CurrPosition);
+    }
+    meshlet.Center = (Min + Max) * 0.5f;
+    meshlet.Radius = 0.0f;
+
+    glm::vec3 NormalSum(0.0f);
+    std::vector<glm::vec3> Normals;
+    Normals.reserve(meshlet.IndexCount / 3);
+    for (unsigned IndexIdx = meshlet.IndexOffset; IndexIdx < meshlet.IndexOffset + meshlet.IndexCount; IndexIdx += 3) {
+        glm::vec3 Corners[3];
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            const float* Position = &vertices[(size_t)indices[IndexIdx + Corner] * stride];
+            Corners[Corner] = glm::vec3(Position[0], Position[1], Position[2]);
+            meshlet.Radius = std::max(meshlet.Radius, glm::length(Corners[Corner] - meshlet.Center));
+        }
+        glm::vec3 Normal = glm::cross(Corners[1] - Corners[0], Corners[2] - Corners[0]);
+        float Length = glm::length(Normal);
+        if (Length > 0.0f) {
+            Normals.push_back(Normal / Length);
+            NormalSum += Normals.back();
+        }
+    }
+
+    // NOTE: Apex-less cone: the cluster is backfacing for every camera for which the
+    // view direction to the bounding sphere is within acos(ConeCutoff) of the cone axis
+    meshlet.ConeAxis = glm::vec3(0.0f);
+    meshlet.ConeCutoff = 1.0f;
+    float AxisLength = glm::length(NormalSum);
+    if (AxisLength == 0.0f) {
+        return;
+    }
+    meshlet.ConeAxis = NormalSum / AxisLength;
+    float MinDot = 1.0f;
+    for (const glm::vec3& Normal : Normals) {
+        MinDot = std::min(MinDot, glm::dot(Normal, meshlet.ConeAxis));
+    }
+    // NOTE: Normals spread over more than a hemisphere, some triangle always faces the camera
+    if (MinDot > 0.0f) {
+        meshlet.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot);
+    }
+}
+
+std::vector<Meshlets::Meshlet>
+Meshlets::Build(const std::vector<unsigned>& indices, size_t indexCount, const std::vector<float>& vertices, unsigned stride) {
+    std::vector<Meshlet> Result;
+    unsigned VertexCount = vertices.size() / stride;
+    std::vector<unsigned> VertexMeshlet(VertexCount, INVALID_MESHLET);
+    Meshlet Current = { 0, 0 };
+    unsigned CurrentVertices = 0;
+    for (size_t IndexIdx = 0; IndexIdx + 2 < indexCount; IndexIdx += 3) {
+        unsigned MeshletIdx = (unsigned)Result.size();
+        unsigned NewVertices = 0;
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            NewVertices += VertexMeshlet[indices[IndexIdx + Corner]] != MeshletIdx;
+        }
+        // NOTE: Corners repeated within the triangle were counted twice, harmless for a limit check
+        if (Current.IndexCount && (CurrentVertices + NewVertices > MAX_VERTICES || Current.IndexCount / 3 + 1 > MAX_TRIANGLES)) {
+            finishMeshlet(indices, vertices, stride, Current);
+            Result.push_back(Current);
+            Current = { (unsigned)IndexIdx, 0 };
+            CurrentVertices = 0;
+            ++MeshletIdx;
+        }
+
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned& Owner = VertexMeshlet[indices[IndexIdx + Corner]];
+            if (Owner != MeshletIdx) {
+                Owner = MeshletIdx;
+                ++CurrentVertices;
+            }
+        }
+        Current.IndexCount += 3;
+    }
+
+    if (Current.IndexCount) {
+        finishMeshlet(indices, vertices, stride, Current);
+        Result.push_back(Current);
+    }
+    return Result;
+}
+
+Meshlets::CullData
+Meshlets::Prepare(const std::vector<Meshlet>& meshlets) {
+    CullData Data;
+    size_t PaddedCount = (meshlets.size() + 3) / 4 * 4;
+    // NOTE: Padding sits at the origin with a negative radius, which fails every plane test
+    Data.CenterX.assign(PaddedCount, 0.0f);
+    Data.CenterY.assign(PaddedCount, 0.0f);
+    Data.CenterZ.assign(PaddedCount, 0.0f);
+    Data.Radius.assign(PaddedCount, -FLT_MAX);
+    Data.AxisX.assign(PaddedCount, 0.0f);
+    Data.AxisY.assign(PaddedCount, 0.0f);
+    Data.AxisZ.assign(PaddedCount, 0.0f);
+    Data.Cutoff.assign(PaddedCount, 1.0f);
+    Data.IndexOffset.assign(PaddedCount, 0);
+    Data.IndexCount.assign(PaddedCount, 0);
+    for (size_t MeshletIdx = 0; MeshletIdx < meshlets.size(); ++MeshletIdx) {
+        const Meshlet& CurrMeshlet = meshlets[MeshletIdx];
+        Data.CenterX[MeshletIdx] = CurrMeshlet.Center.x;
+        Data.CenterY[MeshletIdx] = CurrMeshlet.Center.y;
+        Data.CenterZ[MeshletIdx] = CurrMeshlet.Center.z;
+        Data.Radius[MeshletIdx] = CurrMeshlet.Radius;
+        Data.AxisX[MeshletIdx] = CurrMeshlet.ConeAxis.x;
+        Data.AxisY[MeshletIdx] = CurrMeshlet.ConeAxis.y;
+        Data.AxisZ[MeshletIdx] = CurrMeshlet.ConeAxis.z;
+        Data.Cutoff[MeshletIdx] = CurrMeshlet.ConeCutoff;
+        Data.IndexOffset[MeshletIdx] = CurrMeshlet.IndexOffset;
+        Data.IndexCount[MeshletIdx] = CurrMeshlet.IndexCount;
+    }
+    return Data;
+}
+
+static void
+appendRange(Meshlets::Ranges& ranges, unsigned indexOffset, unsigned indexCount) {
+    ranges.VisibleIndexCount += indexCount;
+    if (!ranges.IndexOffsets.empty() && ranges.IndexOffsets.back() + ranges.IndexCounts.back() == indexOffset) {
+        ranges.IndexCounts.back() += indexCount;
+        return;
+    }
+    ranges.IndexOffsets.push_back(indexOffset);
+    ranges.IndexCounts.push_back(indexCount);
+}
+
+void
+Meshlets::Cull(const CullData& data, const glm::vec3& cameraPosition, const glm::vec4 frustumPlanes[6], bool coneCulling, Ranges& ranges) {
+    ranges.IndexOffsets.clear();
+    ranges.IndexCounts.clear();
+    ranges.VisibleIndexCount = 0;
+    size_t PaddedCount = data.Radius.size();
+#if CG_SIMD_SSE2
+    const __m128 CameraX = _mm_set1_ps(cameraPosition.x);
+    const __m128 CameraY = _mm_set1_ps(cameraPosition.y);
+    const __m128 CameraZ = _mm_set1_ps(cameraPosition.z);
+    // NOTE: Without cone culling the cutoff test is made impossible to pass
+    const __m128 ConeEnabled = coneCulling ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+    for (size_t First = 0; First < PaddedCount; First += 4) {
+        __m128 CenterX = _mm_loadu_ps(&data.CenterX[First]);
+        __m128 CenterY = _mm_loadu_ps(&data.CenterY[First]);
+        __m128 CenterZ = _mm_loadu_ps(&data.CenterZ[First]);
+        __m128 Radius = _mm_loadu_ps(&data.Radius[First]);
+        __m128 NegativeRadius = _mm_sub_ps(_mm_setzero_ps(), Radius);
+
+        __m128 Visible = _mm_cmpge_ps(Radius, _mm_setzero_ps());
+        for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+            const glm::vec4& Plane = frustumPlanes[PlaneIdx];
+            __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(CenterX, _mm_set1_ps(Plane.x)), _mm_mul_ps(CenterY, _mm_set1_ps(Plane.y))),
+                _mm_add_ps(_mm_mul_ps(CenterZ, _mm_set1_ps(Plane.z)), _mm_set1_ps(Plane.w)));
+            Visible = _mm_and_ps(Visible, _mm_cmpge_ps(Distance, NegativeRadius));
+        }
+
+        __m128 ViewX = _mm_sub_ps(CenterX, CameraX);
+        __m128 ViewY = _mm_sub_ps(CenterY, CameraY);
+        __m128 ViewZ = _mm_sub_ps(CenterZ, CameraZ);
+        __m128 ViewLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ViewX, ViewX), _mm_mul_ps(ViewY, ViewY)), _mm_mul_ps(ViewZ, ViewZ)));
+        __m128 AxisDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ViewX, _mm_loadu_ps(&data.AxisX[First])), _mm_mul_ps(ViewY, _mm_loadu_ps(&data.AxisY[First]))),
+            _mm_mul_ps(ViewZ, _mm_loadu_ps(&data.AxisZ[First])));
+        __m128 Backfacing = _mm_cmpge_ps(AxisDot, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data.Cutoff[First]), ViewLength), Radius));
+        Visible = _mm_andnot_ps(_mm_and_ps(Backfacing, ConeEnabled), Visible);
+
+        int Mask = _mm_movemask_ps(Visible);
+        for (unsigned Lane = 0; Lane < 4; ++Lane) {
+            if (Mask & (1 << Lane)) {
+                appendRange(ranges, data.IndexOffset[First + Lane], data.IndexCount[First + Lane]);
+            }
+        }
+    }
+#else
+    for (size_t MeshletIdx = 0; MeshletIdx < PaddedCount; ++MeshletIdx) {
+        glm::vec3 Center(data.CenterX[MeshletIdx], data.CenterY[MeshletIdx], data.CenterZ[MeshletIdx]);
+        float Radius = data.Radius[MeshletIdx];
+        bool Visible = Radius >= 0.0f;
+        for (unsigned PlaneIdx = 0; PlaneIdx < 6 && Visible; ++PlaneIdx) {
+            Visible = glm::dot(glm::vec3(frustumPlanes[PlaneIdx]), Center) + frustumPlanes[PlaneIdx].w >= -Radius;
+        }
+
+        glm::vec3 View = Center - cameraPosition;
+        glm::vec3 Axis(data.AxisX[MeshletIdx], data.AxisY[MeshletIdx], data.AxisZ[MeshletIdx]);
+        if (Visible && coneCulling && glm::dot(View, Axis) >= data.Cutoff[MeshletIdx] * glm::length(View) + Radius) {
+            Visible = false;
+        }
+        if (Visible) {
+            appendRange(ranges, data.IndexOffset[MeshletIdx], data.IndexCount[MeshletIdx]);
+        }
+    }
+#endif
+}
@@ -0,0 +1,85 @@
+/**
+ * @file meshlets.hpp
+ * @brief Splitting of index buffers into small triangle clusters with bounds and normal
+ * cones, and SIMD culling of those clusters against the camera
+ *
+ */
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+class Meshlets {
+public:
+    // NOTE: Cluster limits, the sizes mesh shader pipelines are tuned for
+    static const unsigned MAX_VERTICES = 64;
+    static const unsigned MAX_TRIANGLES = 124;
+
+    /**
+     * @brief Contiguous range of triangles of the index buffer
+     *
+     */
+    struct Meshlet {
+        unsigned IndexOffset;
+        unsigned IndexCount;
+        glm::vec3 Center;
+        float Radius;
+        // NOTE: Normalized average triangle normal. The cluster faces away from every camera
+        // inside the cone around -ConeAxis, see Cull. ConeCutoff is 1 for clusters that can't be backface culled
+        glm::vec3 ConeAxis;
+        float ConeCutoff;
+    };
+
+    /**
+     * @brief Meshlet culling data laid out by field, padded to a multiple of 4 meshlets
+     * so 4 are tested per SIMD step. Padding meshlets are never visible
+     *
+     */
+    struct CullData {
+        std::vector<float> CenterX, CenterY, CenterZ, Radius;
+        std::vector<float> AxisX, AxisY, AxisZ, Cutoff;
+        std::vector<unsigned> IndexOffset, IndexCount;
+    };
+
+    /**
+     * @brief Visible index ranges, adjacent visible meshlets are merged into one range
+     *
+     */
+    struct Ranges {
+        std::vector<unsigned> IndexOffsets;
+        std::vector<unsigned> IndexCounts;
+        unsigned VisibleIndexCount;
+    };
+
+    /**
+     * @brief Splits triangles into meshlets, in order, without reordering the index buffer
+     *
+     * @param indices Triangle indices, cache optimized for tight meshlets
+     * @param indexCount Number of indices to split, starting at the first
+     * @param vertices Interleaved vertices, position is expected in the first 3 floats
+     * @param stride Floats per vertex
+     * @returns Meshlets covering indices[0, indexCount)
+     */
+    static std::vector<Meshlet> Build(const std::vector<unsigned>& indices, size_t indexCount, const std::vector<float>& vertices, unsigned stride);
+
+    /**
+     * @brief Lays meshlets out for Cull
+     *
+     * @param meshlets Meshlets
+     * @returns Culling data
+     */
+    static CullData Prepare(const std::vector<Meshlet>& meshlets);
+
+    /**
+     * @brief Rejects meshlets outside the frustum or facing away from the camera, 4 at a time.
+     * Camera and planes are in the model space of the meshlets
+     *
+     * @param data Culling data
+     * @param cameraPosition Camera position
+     * @param frustumPlanes Normalized planes, normals pointing inwards
+     * @param coneCulling Whether to backface cull, only valid for transforms without non-uniform scale
+     * @param ranges Output visible index ranges
+     */
+    static void Cull(const CullData& data, const glm::vec3& cameraPosition, const glm::vec4 frustumPlanes[6], bool coneCulling, Ranges& ranges);
+};
@@ -0,0 +1,314 @@
+#include "meshsimplifier.hpp"
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <unordered_set>
+#include <glm/glm.hpp>
+
+// NOTE: Border edges get a plane perpendicular to the surface, weighted so collapses
+// pulling the border inwards are among the last ones taken
+static const double BORDER_WEIGHT = 10.0;
+// NOTE: Collapses turning a triangle normal by more than ~75 degrees are rejected
+static const double MIN_NORMAL_COS = 0.25;
+// NOTE: Positions shared by more vertex copies than this (corners where several
+// UV islands meet) are never moved
+static const unsigned MAX_SEAM_COPIES = 2;
+
+struct Quadric {
+    double A00, A01, A02, A11, A12, A22;
+    double B0, B1, B2;
+    double C;
+    double Weight;
+};
+
+struct Edge {
+    unsigned From;
+    unsigned To;
+};
+
+struct Collapse {
+    unsigned From;
+    unsigned To;
+    double Cost;
+    size_t EdgeBegin;
+    size_t EdgeEnd;
+};
+
+static void
+addPlane(Quadric& q, const glm::dvec3& normal, double distance, double weight) {
+    q.A00 += weight * normal.x * normal.x;
+    q.A01 += weight * normal.x * normal.y;
+    q.A02 += weight * normal.x * normal.z;
+    q.A11 += weight * normal.y * normal.y;
+    q.A12 += weight * normal.y * normal.z;
+    q.A22 += weight * normal.z * normal.z;
+    q.B0 += weight * normal.x * distance;
+    q.B1 += weight * normal.y * distance;
+    q.B2 += weight * normal.z * distance;
+    q.C += weight * distance * distance;
+    q.Weight += weight;
+}
+
+static void
+addQuadric(Quadric& q, const Quadric& other) {
+    q.A00 += other.A00;
+    q.A01 += other.A01;
+    q.A02 += other.A02;
+    q.A11 += other.A11;
+    q.A12 += other.A12;
+    q.A22 += other.A22;
+    q.B0 += other.B0;
+    q.B1 += other.B1;
+    q.B2 += other.B2;
+    q.C += other.C;
+    q.Weight += other.Weight;
+}
+
+static double
+evaluateQuadric(const Quadric& q, const glm::dvec3& p) {
+    double Error = q.A00 * p.x * p.x + q.A11 * p.y * p.y + q.A22 * p.z * p.z
+        + 2.0 * (q.A01 * p.x * p.y + q.A02 * p.x * p.z + q.A12 * p.y * p.z)
+        + 2.0 * (q.B0 * p.x + q.B1 * p.y + q.B2 * p.z) + q.C;
+    // NOTE: Rounding can push the error of a point on all planes slightly below zero
+    return std::max(Error, 0.0);
+}
+
+std::vector<unsigned>
+MeshSimplifier::Simplify(const std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride, size_t targetIndexCount, float& error) {
+    error = 0.0f;
+    std::vector<unsigned> Result(indices);
+    unsigned VertexCount = vertices.size() / stride;
+    if (Result.size() <= targetIndexCount || VertexCount == 0) {
+        return Result;
+    }
+
+    std::vector<glm::dvec3> Positions(VertexCount);
+    for (unsigned VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx) {
+        const float* Position = &vertices[(size_t)VertexIdx * stride];
+        Positions[VertexIdx] = glm::dvec3(Position[0], Position[1], Position[2]);
+    }
+
+    // NOTE: Copies of a vertex split along UV or normal seams share a position. Topology,
+    // quadrics and collapses work on position groups, each named by its first vertex, so
+    // seams aren't mistaken for open borders and all copies move together
+    std::vector<unsigned> Group(VertexCount);
+    {
+        std::vector<unsigned> Order(VertexCount);
+        std::iota(Order.begin(), Order.end(), 0);
+        auto Less = [&](unsigned a, unsigned b) {
+            const glm::dvec3& PosA = Positions[a];
+            const glm::dvec3& PosB = Positions[b];
+            if (PosA.x != PosB.x) return PosA.x < PosB.x;
+            if (PosA.y != PosB.y) return PosA.y < PosB.y;
+            if (PosA.z != PosB.z) return PosA.z < PosB.z;
+            return a < b;
+        };
+        std::sort(Order.begin(), Order.end(), Less);
+        for (size_t OrderIdx = 0; OrderIdx < Order.size(); ++OrderIdx) {
+            unsigned VertexIdx = Order[OrderIdx];
+            bool SameAsPrevious = OrderIdx > 0 && Positions[Order[OrderIdx - 1]] == Positions[VertexIdx];
+            Group[VertexIdx] = SameAsPrevious ? Group[Order[OrderIdx - 1]] : VertexIdx;
+        }
+    }
+
+    std::vector<Quadric> Quadrics(VertexCount, Quadric());
+    std::unordered_set<uint64_t> DirectedEdges;
+    for (size_t TriIdx = 0; TriIdx < Result.size(); TriIdx += 3) {
+        unsigned Corners[3] = { Group[Result[TriIdx]], Group[Result[TriIdx + 1]], Group[Result[TriIdx + 2]] };
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            DirectedEdges.insert((uint64_t)Corners[Corner] << 32 | Corners[(Corner + 1) % 3]);
+        }
+    }
+
+    for (size_t TriIdx = 0; TriIdx < Result.size(); TriIdx += 3) {
+        unsigned Corners[3] = { Group[Result[TriIdx]], Group[Result[TriIdx + 1]], Group[Result[TriIdx + 2]] };
+        glm::dvec3 Normal = glm::cross(Positions[Corners[1]] - Positions[Corners[0]], Positions[Corners[2]] - Positions[Corners[0]]);
+        double Length = glm::length(Normal);
+        if (Length == 0.0) {
+            continue;
+        }
+
+        Normal /= Length;
+        double Distance = -glm::dot(Normal, Positions[Corners[0]]);
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            addPlane(Quadrics[Corners[Corner]], Normal, Distance, 0.5 * Length);
+        }
+
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned From = Corners[Corner];
+            unsigned To = Corners[(Corner + 1) % 3];
+            if (DirectedEdges.count((uint64_t)To << 32 | From)) {
+                continue;
+            }
+
+            // NOTE: No triangle on the other side, this is an open border edge
+            glm::dvec3 EdgeVector = Positions[To] - Positions[From];
+            glm::dvec3 BorderNormal = glm::cross(EdgeVector, Normal);
+            double BorderLength = glm::length(BorderNormal);
+            if (BorderLength == 0.0) {
+                continue;
+            }
+            BorderNormal /= BorderLength;
+            double BorderDistance = -glm::dot(BorderNormal, Positions[From]);
+            double Weight = BORDER_WEIGHT * glm::dot(EdgeVector, EdgeVector);
+            addPlane(Quadrics[From], BorderNormal, BorderDistance, Weight);
+            addPlane(Quadrics[To], BorderNormal, BorderDistance, Weight);
+        }
+    }
+
+    std::vector<unsigned> Remap(VertexCount);
+    std::vector<unsigned> LiveCopies(VertexCount);
+    std::vector<unsigned char> Live(VertexCount);
+    std::vector<unsigned char> Touched(VertexCount);
+    std::vector<unsigned> GroupTriangleStart(VertexCount + 1);
+    std::vector<unsigned> GroupTriangles;
+    std::vector<Edge> Edges;
+    std::vector<Collapse> Collapses;
+    // NOTE: Each pass collapses an independent set of edges, cheapest first, then rebuilds
+    // the index buffer. Nothing around a collapse changes until the next pass
+    while (Result.size() > targetIndexCount) {
+        std::fill(LiveCopies.begin(), LiveCopies.end(), 0);
+        std::fill(Live.begin(), Live.end(), 0);
+        std::fill(GroupTriangleStart.begin(), GroupTriangleStart.end(), 0);
+        for (unsigned Index : Result) {
+            if (!Live[Index]) {
+                Live[Index] = 1;
+                ++LiveCopies[Group[Index]];
+            }
+            ++GroupTriangleStart[Group[Index] + 1];
+        }
+        for (unsigned VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx) {
+            GroupTriangleStart[VertexIdx + 1] += GroupTriangleStart[VertexIdx];
+        }
+        GroupTriangles.resize(Result.size());
+        {
+            std::vector<unsigned> Cursor(GroupTriangleStart.begin(), GroupTriangleStart.end() - 1);
+            for (size_t IndexIdx = 0; IndexIdx < Result.size(); ++IndexIdx) {
+                GroupTriangles[Cursor[Group[Result[IndexIdx]]]++] = (unsigned)(IndexIdx / 3);
+            }
+        }
+
+        Edges.clear();
+        for (size_t TriIdx = 0; TriIdx < Result.size(); TriIdx += 3) {
+            for (unsigned Corner = 0; Corner < 3; ++Corner) {
+                unsigned From = Result[TriIdx + Corner];
+                unsigned To = Result[TriIdx + (Corner + 1) % 3];
+                Edges.push_back({ From, To });
+                Edges.push_back({ To, From });
+            }
+        }
+        std::sort(Edges.begin(), Edges.end(), [&](const Edge& a, const Edge& b) {
+            if (Group[a.From] != Group[b.From]) return Group[a.From] < Group[b.From];
+            if (Group[a.To] != Group[b.To]) return Group[a.To] < Group[b.To];
+            if (a.From != b.From) return a.From < b.From;
+            return a.To < b.To;
+        });
+
+        // NOTE: A group can collapse onto a neighbouring group only if every live copy has an
+        // edge to a copy of the neighbour, so both sides of a seam slide along the seam
+        Collapses.clear();
+        for (size_t Begin = 0; Begin < Edges.size();) {
+            unsigned From = Group[Edges[Begin].From];
+            unsigned To = Group[Edges[Begin].To];
+            size_t End = Begin;
+            unsigned Copies = 0;
+            for (; End < Edges.size() && Group[Edges[End].From] == From && Group[Edges[End].To] == To; ++End) {
+                Copies += End == Begin || Edges[End].From != Edges[End - 1].From;
+            }
+
+            if (From != To && Copies == LiveCopies[From] && Copies <= MAX_SEAM_COPIES) {
+                Quadric Combined = Quadrics[From];
+                addQuadric(Combined, Quadrics[To]);
+                double Cost = evaluateQuadric(Combined, Positions[To]);
+                if (Collapses.empty() || Collapses.back().From != From) {
+                    Collapses.push_back({ From, To, Cost, Begin, End });
+                } else if (Cost < Collapses.back().Cost) {
+                    Collapses.back() = { From, To, Cost, Begin, End };
+                }
+            }
+            Begin = End;
+        }
+        std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+        // NOTE: A collapse removes about 2 triangles
+        size_t Budget = (Result.size() - targetIndexCount) / 6 + 1;
+        size_t Applied = 0;
+        std::iota(Remap.begin(), Remap.end(), 0);
+        std::fill(Touched.begin(), Touched.end(), 0);
+        for (const Collapse& Candidate : Collapses) {
+            if (Applied >= Budget) {
+                break;
+            }
+            if (Touched[Candidate.From] || Touched[Candidate.To]) {
+                continue;
+            }
+
+            bool Flips = false;
+            const glm::dvec3& Target = Positions[Candidate.To];
+            for (unsigned Slot = GroupTriangleStart[Candidate.From]; Slot < GroupTriangleStart[Candidate.From + 1] && !Flips; ++Slot) {
+                const unsigned* Triangle = &Result[(size_t)GroupTriangles[Slot] * 3];
+                glm::dvec3 Before[3], After[3];
+                bool Degenerates = false;
+                for (unsigned Corner = 0; Corner < 3; ++Corner) {
+                    unsigned CornerGroup = Group[Triangle[Corner]];
+                    Degenerates |= CornerGroup == Candidate.To;
+                    Before[Corner] = Positions[CornerGroup];
+                    After[Corner] = CornerGroup == Candidate.From ? Target : Before[Corner];
+                }
+                if (Degenerates) {
+                    continue;
+                }
+
+                glm::dvec3 NormalBefore = glm::cross(Before[1] - Before[0], Before[2] - Before[0]);
+                glm::dvec3 NormalAfter = glm::cross(After[1] - After[0], After[2] - After[0]);
+                double LengthBefore = glm::length(NormalBefore);
+                Flips = LengthBefore > 0.0
+                    && glm::dot(NormalBefore, NormalAfter) <= MIN_NORMAL_COS * LengthBefore * glm::length(NormalAfter);
+            }
+            if (Flips) {
+                continue;
+            }
+
+            for (size_t EdgeIdx = Candidate.EdgeBegin; EdgeIdx < Candidate.EdgeEnd; ++EdgeIdx) {
+                const Edge& CurrEdge = Edges[EdgeIdx];
+                if (Remap[CurrEdge.From] == CurrEdge.From) {
+                    Remap[CurrEdge.From] = CurrEdge.To;
+                }
+            }
+            for (unsigned Slot = GroupTriangleStart[Candidate.From]; Slot < GroupTriangleStart[Candidate.From + 1]; ++Slot) {
+                const unsigned* Triangle = &Result[(size_t)GroupTriangles[Slot] * 3];
+                Touched[Group[Triangle[0]]] = Touched[Group[Triangle[1]]] = Touched[Group[Triangle[2]]] = 1;
+            }
+
+            const Quadric& FromQuadric = Quadrics[Candidate.From];
+            Quadric& ToQuadric = Quadrics[Candidate.To];
+            double Weight = FromQuadric.Weight + ToQuadric.Weight;
+            if (Weight > 0.0) {
+                error = std::max(error, (float)std::sqrt(Candidate.Cost / Weight));
+            }
+            addQuadric(ToQuadric, FromQuadric);
+            ++Applied;
+        }
+
+        if (!Applied) {
+            break;
+        }
+
+        size_t Written = 0;
+        for (size_t TriIdx = 0; TriIdx < Result.size(); TriIdx += 3) {
+            unsigned A = Remap[Result[TriIdx]];
+            unsigned B = Remap[Result[TriIdx + 1]];
+            unsigned C = Remap[Result[TriIdx + 2]];
+            if (Group[A] == Group[B] || Group[B] == Group[C] || Group[A] == Group[C]) {
+                continue;
+            }
+            Result[Written++] = A;
+            Result[Written++] = B;
+            Result[Written++] = C;
+        }
+        Result.resize(Written);
+    }
+
+    return Result;
+}
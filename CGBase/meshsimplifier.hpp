@@ -0,0 +1,26 @@
+/**
+ * @file meshsimplifier.hpp
+ * @brief Quadric error edge collapse simplification, used to build mesh LODs
+ *
+ */
+#pragma once
+#include <vector>
+#include <cstddef>
+
+class MeshSimplifier {
+public:
+    /**
+     * @brief Simplifies a triangle list by collapsing edges in order of quadric error
+     * (Garland-Heckbert). Vertices only ever collapse onto other existing vertices, so the
+     * result indexes the same vertex buffer. Open borders and UV/normal seams are preserved
+     *
+     * @param indices Triangle indices
+     * @param vertices Interleaved vertices, position is expected in the first 3 floats
+     * @param stride Floats per vertex
+     * @param targetIndexCount Index count to simplify down to. Not reached if every
+     * remaining collapse would break a border or seam or flip a triangle
+     * @param error Output error of the worst collapse taken, as a distance from the source surface in model units
+     * @returns Simplified triangle indices
+     */
+    static std::vector<unsigned> Simplify(const std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride, size_t targetIndexCount, float& error);
+};
@@ -1,33 +1,660 @@
 #include "model.hpp"
+#include "glstate.hpp"
 
-Model::Model(std::string filename) {
+typedef std::chrono::high_resolution_clock Clock;
+
+static const unsigned PROFILE_FLAGS[IMPORT_PROFILE_COUNT] = {
+    0,
+    aiProcess_JoinIdenticalVertices,
+    aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals | aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes
+        | aiProcess_RemoveRedundantMaterials | aiProcess_FindDegenerates | aiProcess_SortByPType,
+};
+
+static const char* PROFILE_NAMES[IMPORT_PROFILE_COUNT] = { "minimal", "fast", "quality" };
+
+static double
+millisecondsSince(Clock::time_point start) {
+    std::chrono::duration<double, std::milli> Elapsed = Clock::now() - start;
+    return Elapsed.count();
+}
+
+Model::Model(std::string filename, unsigned importOptions, EImportProfile importProfile) {
     mFilename = filename;
+    mImportOptions = importOptions;
+    mImportProfile = importProfile;
+    mImportedFromCache = false;
+    mImportStats = {};
     mDirectory = filename.substr(0, filename.find_last_of('/'));
 }
 
 bool
 Model::Load() {
-    Assimp::Importer Importer;
-    const aiScene *Scene = Importer.ReadFile(mFilename, POSTPROCESS_FLAGS);
+    auto Start = Clock::now();
+    bool Direct = (mImportOptions & IMPORT_DIRECT_UPLOAD) != 0;
+    if (Direct && (mImportOptions & IMPORT_CPU_GEOMETRY_OPTIONS)) {
+        std::cerr << "[Err] " << mFilename << ": direct upload needs no CPU side mesh processing, importing normally" << std::endl;
+        Direct = false;
+    }
+    if (Direct) {
+        if (!importDirect()) {
+            return false;
+        }
+    } else {
+        if (!Import()) {
+            return false;
+        }
+        for (size_t MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+            UploadMesh(MeshIdx);
+        }
+    }
+    PrintMemoryReport();
+    auto TextureStart = Clock::now();
+    loadTextures();
+    mImportStats.TextureMs += millisecondsSince(TextureStart);
+    PrintImportReport();
+
+    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes ("
+        << (mImportedFromCache ? "warm, mesh cache" : "cold, Assimp") << ") in " << millisecondsSince(Start) << " ms" << std::endl;
+    return true;
+}
+
+bool
+Model::Import() {
+    mImportedFromCache = !(mImportOptions & IMPORT_SKIP_CACHE) && loadFromCache();
+    if (!mImportedFromCache && !importModel()) {
+        return false;
+    }
+
+    mBounds = Bounds();
+    mImportStats.Vertices = 0;
+    mImportStats.Indices = 0;
+    for (const Mesh& CurrMesh : mMeshes) {
+        mBounds.Merge(CurrMesh.GetBounds());
+        mImportStats.Vertices += CurrMesh.mVertices.size() / Mesh::VERTEX_STRIDE;
+        mImportStats.Indices += CurrMesh.mLods.empty() ? CurrMesh.mIndices.size() : CurrMesh.mLods[0].IndexCount;
+    }
+    return true;
+}
+
+const Bounds&
+Model::GetBounds() const {
+    return mBounds;
+}
+
+const Skeleton&
+Model::GetSkeleton() const {
+    return mSkeleton;
+}
+
+size_t
+Model::GetMeshCount() const {
+    return mMeshes.size();
+}
+
+GLenum
+Model::allocateBuffers(size_t vertexCount, size_t indexCount, size_t maxMeshVertexCount, bool skinned) {
+    bool Compact = (mImportOptions & IMPORT_COMPACT_VERTICES) != 0;
+    // NOTE: Indices are relative to each mesh's base vertex, so they only need 32 bits
+    // once a single mesh has more vertices than 16 bits can address
+    GLenum IndexType = maxMeshVertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    size_t IndexSize = IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t VertexSize = Compact ? sizeof(VertexFormat::CompactVertex) : Mesh::VERTEX_STRIDE * sizeof(float);
+
+    mVAO = GLVertexArray::Create();
+    GLState::BindVertexArray(mVAO.Get());
+    mVBO = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO.Get());
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * VertexSize, 0, GL_STATIC_DRAW);
+    if (Compact) {
+        VertexFormat::SetupCompactAttributes();
+    } else {
+        VertexFormat::SetupFullAttributes();
+    }
+    size_t SkinBytes = 0;
+    if (skinned) {
+        // NOTE: Sized for every vertex so base vertex draws address it like the main stream,
+        // static meshes of a skinned model leave their range unused
+        SkinBytes = vertexCount * sizeof(VertexFormat::SkinVertex);
+        mSkinVBO = GLBuffer::Create();
+        glBindBuffer(GL_ARRAY_BUFFER, mSkinVBO.Get());
+        glBufferData(GL_ARRAY_BUFFER, SkinBytes, 0, GL_STATIC_DRAW);
+        VertexFormat::SetupSkinAttributes();
+    }
+    mEBO = GLBuffer::Create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO.Get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * IndexSize, 0, GL_STATIC_DRAW);
+    GLState::BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mGpuBytes.Set(vertexCount * VertexSize + indexCount * IndexSize + SkinBytes);
+    return IndexType;
+}
+
+void
+Model::createBuffers() {
+    size_t VertexCount = 0;
+    size_t IndexCount = 0;
+    size_t MaxMeshVertexCount = 0;
+    bool Skinned = false;
+    for (const Mesh& CurrMesh : mMeshes) {
+        Skinned = Skinned || !CurrMesh.mSkin.empty();
+        size_t MeshVertexCount = CurrMesh.mVertices.size() / Mesh::VERTEX_STRIDE;
+        VertexCount += MeshVertexCount;
+        IndexCount += CurrMesh.mIndices.size();
+        MaxMeshVertexCount = std::max(MaxMeshVertexCount, MeshVertexCount);
+    }
+    GLenum IndexType = allocateBuffers(VertexCount, IndexCount, MaxMeshVertexCount, Skinned);
+
+    unsigned BaseVertex = 0;
+    unsigned FirstIndex = 0;
+    for (Mesh& CurrMesh : mMeshes) {
+        CurrMesh.SetBufferRange(BaseVertex, FirstIndex, IndexType);
+        BaseVertex += CurrMesh.mVertices.size() / Mesh::VERTEX_STRIDE;
+        FirstIndex += CurrMesh.mIndices.size();
+    }
+}
+
+void
+Model::UploadMesh(size_t meshIdx) {
+    size_t Offset = 0;
+    UploadMeshPart(meshIdx, Offset, SIZE_MAX);
+}
+
+bool
+Model::UploadMeshPart(size_t meshIdx, size_t& offset, size_t maxBytes) {
+    auto Start = Clock::now();
+    if (!mVAO.Get()) {
+        createBuffers();
+    }
+
+    Mesh& CurrMesh = mMeshes[meshIdx];
+    if (offset == 0) {
+        CurrMesh.PrepareBuffer((mImportOptions & IMPORT_COMPACT_VERTICES) != 0);
+    }
+
+    // NOTE: The element array binding is VAO state, render paths leave their VAO bound
+    GLState::BindVertexArray(0);
+    // NOTE: The mesh's ranges are uploaded back to back, offset counts across all of them
+    size_t RangeStart = 0;
+    size_t Uploaded = 0;
+    for (const Mesh::UploadRange& Range : CurrMesh.GetUploadRanges()) {
+        size_t RangeEnd = RangeStart + Range.Bytes;
+        if (offset < RangeEnd && Uploaded < maxBytes) {
+            size_t Skip = offset - RangeStart;
+            size_t Bytes = std::min(Range.Bytes - Skip, maxBytes - Uploaded);
+            GLenum Target = Range.Target == Mesh::UPLOAD_INDICES ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+            const GLBuffer& Buffer = Range.Target == Mesh::UPLOAD_VERTICES ? mVBO : Range.Target == Mesh::UPLOAD_INDICES ? mEBO : mSkinVBO;
+            glBindBuffer(Target, Buffer.Get());
+            glBufferSubData(Target, Range.Offset + Skip, Bytes, Range.Data + Skip);
+            glBindBuffer(Target, 0);
+            offset += Bytes;
+            Uploaded += Bytes;
+        }
+        RangeStart = RangeEnd;
+    }
+
+    bool Done = offset >= RangeStart;
+    if (Done) {
+        CurrMesh.FinishBuffer();
+        if (!(mImportOptions & IMPORT_KEEP_GEOMETRY)) {
+            CurrMesh.ReleaseGeometry();
+        }
+    }
+    mImportStats.UploadMs += millisecondsSince(Start);
+    return Done;
+}
+
+size_t
+Model::GetCpuBytes() const {
+    size_t Bytes = 0;
+    for (const Mesh& CurrMesh : mMeshes) {
+        Bytes += CurrMesh.GetCpuBytes();
+    }
+    return Bytes;
+}
+
+size_t
+Model::GetGpuBytes() const {
+    return mGpuBytes.Get();
+}
+
+void
+Model::PrintMemoryReport() const {
+    size_t IndexBytes = 0;
+    size_t IndexBytes32 = 0;
+    size_t VertexBytes = 0;
+    size_t FullVertexBytes = 0;
+    VertexFormat::Error QuantizationError = { 0.0f, 0.0f, 0.0f };
+    for (const Mesh& CurrMesh : mMeshes) {
+        IndexBytes += CurrMesh.GetIndexBufferBytes();
+        IndexBytes32 += CurrMesh.GetIndexCount() * sizeof(uint32_t);
+        VertexBytes += CurrMesh.GetVertexBufferBytes();
+        FullVertexBytes += CurrMesh.GetVertexCount() * Mesh::VERTEX_STRIDE * sizeof(float);
+        const VertexFormat::Error& MeshError = CurrMesh.GetQuantizationError();
+        QuantizationError.Position = std::max(QuantizationError.Position, MeshError.Position);
+        QuantizationError.NormalDegrees = std::max(QuantizationError.NormalDegrees, MeshError.NormalDegrees);
+        QuantizationError.UV = std::max(QuantizationError.UV, MeshError.UV);
+    }
+    // NOTE: Skin and instance buffers only exist for skinned models and after RenderInstanced
+    size_t VertexArrays = mVAO.Get() ? 1 : 0;
+    size_t Buffers = 0;
+    for (const GLBuffer* CurrBuffer : { &mVBO, &mEBO, &mSkinVBO, &mInstanceVBO }) {
+        Buffers += CurrBuffer->Get() ? 1 : 0;
+    }
+    std::cout << mFilename << " shared buffers: " << mMeshes.size() << " meshes, " << VertexArrays << " VAO, " << Buffers
+        << " buffer objects (" << (VertexArrays + Buffers) * mMeshes.size() << " with per-mesh buffers)" << std::endl;
+    std::cout << mFilename << " geometry: " << GetCpuBytes() / 1024 << " KB CPU ("
+        << (mImportOptions & IMPORT_KEEP_GEOMETRY ? "kept" : "released after upload") << "), " << GetGpuBytes() / 1024 << " KB GPU" << std::endl;
+    if (mInstanceVBO.Get()) {
+        std::cout << mFilename << " instance buffer: " << mInstanceBytes.Get() / 1024 << " KB GPU" << std::endl;
+    }
+    std::cout << mFilename << " index buffers: " << IndexBytes / 1024 << " KB, "
+        << (IndexBytes32 - IndexBytes) / 1024 << " KB saved by 16-bit indices" << std::endl;
+    if (mImportOptions & IMPORT_COMPACT_VERTICES) {
+        std::cout << mFilename << " compact vertices: " << FullVertexBytes / 1024 << " KB -> " << VertexBytes / 1024
+            << " KB, max error: position " << QuantizationError.Position << ", normal " << QuantizationError.NormalDegrees
+            << " deg, UV " << QuantizationError.UV << std::endl;
+    }
+    if (mSkeleton.HasBones()) {
+        std::cout << mFilename << " skeleton: " << mSkeleton.mParents.size() << " nodes, " << mSkeleton.mBoneNodes.size()
+            << " bones, " << mSkeleton.GetAnimationCount() << " animations" << std::endl;
+    }
+}
+
+void
+Model::PrintImportReport() const {
+    std::cout << mFilename << " import (" << GetProfileName(mImportProfile) << " profile, "
+        << (mImportedFromCache ? "mesh cache" : "Assimp") << "): parse " << mImportStats.ParseMs << " ms, post-process "
+        << mImportStats.PostprocessMs << " ms, interleave " << mImportStats.InterleaveMs << " ms, mesh processing "
+        << mImportStats.MeshProcessMs << " ms, textures " << mImportStats.TextureMs << " ms, upload " << mImportStats.UploadMs << " ms" << std::endl;
+    std::cout << mFilename << " imported " << mMeshes.size() << " meshes, ";
+    if (mImportedFromCache) {
+        std::cout << mImportStats.Vertices << " vertices, " << mImportStats.Indices << " indices (cached)" << std::endl;
+    } else {
+        std::cout << "vertices " << mImportStats.SourceVertices << " -> " << mImportStats.Vertices << ", indices "
+            << mImportStats.SourceIndices << " -> " << mImportStats.Indices << std::endl;
+    }
+}
+
+unsigned
+Model::GetPostprocessFlags(EImportProfile profile) {
+    return POSTPROCESS_FLAGS | PROFILE_FLAGS[profile];
+}
+
+const char*
+Model::GetProfileName(EImportProfile profile) {
+    return PROFILE_NAMES[profile];
+}
+
+bool
+Model::loadFromCache() {
+    auto Start = Clock::now();
+    std::vector<MeshCache::Entry> Entries;
+    if (!MeshCache::Read(mFilename, GetPostprocessFlags(mImportProfile), mImportOptions & ~IMPORT_RUNTIME_OPTIONS, Entries, mSkeleton)) {
+        return false;
+    }
+
+    mMeshes.reserve(Entries.size());
+    for (MeshCache::Entry& CurrEntry : Entries) {
+        mMeshes.emplace_back(std::move(CurrEntry.Vertices), std::move(CurrEntry.Indices), CurrEntry.DiffusePath, CurrEntry.SpecularPath);
+        mMeshes.back().mLods = std::move(CurrEntry.Lods);
+        mMeshes.back().mMeshlets = std::move(CurrEntry.MeshletList);
+        mMeshes.back().mSkin = std::move(CurrEntry.Skin);
+        mMeshes.back().SetBounds(CurrEntry.MeshBounds);
+    }
+    mImportStats.ParseMs = millisecondsSince(Start);
+    return true;
+}
+
+const aiScene*
+Model::readScene(Assimp::Importer& importer) {
+    AssetPack::View Packed;
+    if (AssetPack::Find(mFilename, Packed)) {
+        // NOTE: Importer takes ownership of the IOSystem. The model and its material files are read from the pack
+        importer.SetIOHandler(new AssetPack::IOSystem());
+    }
+    // NOTE: Parsed without post-processing first, so the two are timed apart and the
+    // geometry can be measured as the file stores it
+    auto Start = Clock::now();
+    const aiScene *Scene = importer.ReadFile(mFilename, 0);
+    mImportStats.ParseMs = millisecondsSince(Start);
+    if (Scene) {
+        mImportStats.SourceVertices = 0;
+        mImportStats.SourceIndices = 0;
+        for (unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes; ++MeshIdx) {
+            const aiMesh* SourceMesh = Scene->mMeshes[MeshIdx];
+            mImportStats.SourceVertices += SourceMesh->mNumVertices;
+            for (unsigned FaceIdx = 0; FaceIdx < SourceMesh->mNumFaces; ++FaceIdx) {
+                mImportStats.SourceIndices += SourceMesh->mFaces[FaceIdx].mNumIndices;
+            }
+        }
+        Start = Clock::now();
+        Scene = importer.ApplyPostProcessing(GetPostprocessFlags(mImportProfile));
+        mImportStats.PostprocessMs = millisecondsSince(Start);
+    }
 
     if (!Scene || Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !Scene->mRootNode) {
-        std::cerr << "[Err] Failed to load model:" << std::endl << Importer.GetErrorString() << std::endl;
+        std::cerr << "[Err] Failed to load model:" << std::endl << importer.GetErrorString() << std::endl;
+        return nullptr;
+    }
+    return Scene;
+}
+
+bool
+Model::importModel() {
+    Assimp::Importer Importer;
+    const aiScene* Scene = readScene(Importer);
+    if (!Scene) {
         return false;
     }
+    mSkeleton.Import(Scene);
     mMeshes.reserve(Scene->mNumMeshes);
+    mImportStats.InterleaveMs = 0.0;
+    mImportStats.MeshProcessMs = 0.0;
     for(unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes; ++MeshIdx) {
         aiMaterial* MeshMaterial = Scene->mMaterials[Scene->mMeshes[MeshIdx]->mMaterialIndex];
+        auto Start = Clock::now();
         Mesh CurrMesh(Scene->mMeshes[MeshIdx], MeshMaterial, mDirectory);
-        mMeshes.push_back(CurrMesh);
+        CurrMesh.ImportSkin(Scene->mMeshes[MeshIdx], mSkeleton);
+        mImportStats.InterleaveMs += millisecondsSince(Start);
+        Start = Clock::now();
+        if (mImportOptions & IMPORT_OPTIMIZE_MESHES) {
+            CurrMesh.Optimize();
+        }
+        if (mImportOptions & IMPORT_GENERATE_LODS) {
+            CurrMesh.GenerateLods();
+        }
+        if (mImportOptions & IMPORT_BUILD_MESHLETS) {
+            CurrMesh.BuildMeshlets();
+        }
+        mImportStats.MeshProcessMs += millisecondsSince(Start);
+        mMeshes.push_back(std::move(CurrMesh));
+
+    }
+    if (!(mImportOptions & IMPORT_SKIP_CACHE)) {
+        MeshCache::Write(mFilename, GetPostprocessFlags(mImportProfile), mImportOptions & ~IMPORT_RUNTIME_OPTIONS, mMeshes, mSkeleton);
+    }
+    return true;
+}
+
+bool
+Model::importDirect() {
+    Assimp::Importer Importer;
+    const aiScene* Scene = readScene(Importer);
+    if (!Scene) {
+        return false;
+    }
+    mImportedFromCache = false;
+    mSkeleton.Import(Scene);
+
+    // NOTE: Sized from the scene, so the buffers exist before the first vertex is interleaved
+    auto Start = Clock::now();
+    std::vector<unsigned> MeshIndexCounts(Scene->mNumMeshes, 0);
+    size_t VertexCount = 0;
+    size_t IndexCount = 0;
+    size_t MaxMeshVertexCount = 0;
+    bool Skinned = false;
+    for (unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes; ++MeshIdx) {
+        const aiMesh* SourceMesh = Scene->mMeshes[MeshIdx];
+        for (unsigned FaceIdx = 0; FaceIdx < SourceMesh->mNumFaces; ++FaceIdx) {
+            MeshIndexCounts[MeshIdx] += SourceMesh->mFaces[FaceIdx].mNumIndices == 3 ? 3 : 0;
+        }
+        VertexCount += SourceMesh->mNumVertices;
+        IndexCount += MeshIndexCounts[MeshIdx];
+        MaxMeshVertexCount = std::max(MaxMeshVertexCount, (size_t)SourceMesh->mNumVertices);
+        Skinned = Skinned || SourceMesh->HasBones();
+    }
+    if (!VertexCount) {
+        std::cerr << "[Err] " << mFilename << " has no vertices" << std::endl;
+        return false;
+    }
 
+    GLenum IndexType = allocateBuffers(VertexCount, IndexCount, MaxMeshVertexCount, Skinned);
+    size_t IndexSize = IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    // NOTE: Invalidated write-only mappings, the driver hands out fresh storage and nothing is read back
+    GLState::BindVertexArray(mVAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO.Get());
+    float* MappedVertices = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, VertexCount * Mesh::VERTEX_STRIDE * sizeof(float),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    unsigned char* MappedIndices = IndexCount ? (unsigned char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, IndexCount * IndexSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT) : 0;
+    mImportStats.UploadMs = millisecondsSince(Start);
+
+    Start = Clock::now();
+    mMeshes.reserve(Scene->mNumMeshes);
+    unsigned BaseVertex = 0;
+    unsigned FirstIndex = 0;
+    for (unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes && MappedVertices; ++MeshIdx) {
+        const aiMesh* SourceMesh = Scene->mMeshes[MeshIdx];
+        Mesh CurrMesh(Scene->mMaterials[SourceMesh->mMaterialIndex], mDirectory);
+        CurrMesh.ImportSkin(SourceMesh, mSkeleton);
+        CurrMesh.SetBufferRange(BaseVertex, FirstIndex, IndexType);
+        CurrMesh.BufferDirect(SourceMesh, MappedVertices + (size_t)BaseVertex * Mesh::VERTEX_STRIDE,
+            MappedIndices ? MappedIndices + (size_t)FirstIndex * IndexSize : 0);
+        BaseVertex += SourceMesh->mNumVertices;
+        FirstIndex += MeshIndexCounts[MeshIdx];
+        mMeshes.push_back(std::move(CurrMesh));
+    }
+    mImportStats.InterleaveMs = millisecondsSince(Start);
+    mImportStats.MeshProcessMs = 0.0;
+
+    Start = Clock::now();
+    // NOTE: Unmapping fails if the storage was lost meanwhile (e.g. a display mode change)
+    bool Intact = MappedVertices && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    if (MappedIndices) {
+        Intact = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && Intact;
+    } else if (IndexCount) {
+        Intact = false;
+    }
+    GLState::BindVertexArray(0);
+    if (Intact && mSkinVBO.Get()) {
+        glBindBuffer(GL_ARRAY_BUFFER, mSkinVBO.Get());
+        for (Mesh& CurrMesh : mMeshes) {
+            CurrMesh.BufferSkin();
+            CurrMesh.ReleaseGeometry();
+        }
     }
-    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes" << std::endl;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mImportStats.UploadMs += millisecondsSince(Start);
+    if (!Intact) {
+        std::cerr << "[Err] Failed to map or write the buffers of " << mFilename << std::endl;
+        mMeshes.clear();
+        // NOTE: The buffers hold nothing usable, free them instead of keeping them until the model dies
+        mVAO.Reset();
+        mVBO.Reset();
+        mEBO.Reset();
+        mSkinVBO.Reset();
+        mGpuBytes.Set(0);
+        return false;
+    }
+
+    mBounds = Bounds();
+    for (const Mesh& CurrMesh : mMeshes) {
+        mBounds.Merge(CurrMesh.GetBounds());
+    }
+    mImportStats.Vertices = VertexCount;
+    mImportStats.Indices = IndexCount;
     return true;
 }
 
+std::vector<std::string>
+Model::GetTexturePaths() const {
+    std::vector<std::string> Paths;
+    Paths.reserve(2 * mMeshes.size());
+    for (const Mesh& CurrMesh : mMeshes) {
+        Paths.push_back(CurrMesh.mDiffusePath);
+        Paths.push_back(CurrMesh.mSpecularPath);
+    }
+    return Paths;
+}
+
+void
+Model::SetTextures(const std::vector<unsigned>& textures) {
+    for (size_t MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mMeshes[MeshIdx].SetTextures(textures[2 * MeshIdx], textures[2 * MeshIdx + 1]);
+    }
+}
+
 void
-Model::Render() {
+Model::loadTextures() {
+    std::vector<std::string> Paths = GetTexturePaths();
+
+    // NOTE: Meshes of a model usually share a handful of material textures,
+    // the texture cache makes sure each of them is decoded and uploaded once
+    std::vector<std::string> Requested;
+    for (const std::string& Path : Paths) {
+        if (!Path.empty()) {
+            Requested.push_back(Path);
+        }
+    }
+    std::vector<unsigned> Acquired = TextureCache::AcquireBatch(Requested);
+
+    std::vector<unsigned> Textures(Paths.size(), 0);
+    size_t AcquiredIdx = 0;
+    for (size_t PathIdx = 0; PathIdx < Paths.size(); ++PathIdx) {
+        if (!Paths[PathIdx].empty()) {
+            Textures[PathIdx] = Acquired[AcquiredIdx++];
+        }
+    }
+    SetTextures(Textures);
+}
+
+void
+Model::Render(const Shader& shader) {
+    GLState::BindVertexArray(mVAO.Get());
+    for (const Mesh& mesh : mMeshes) {
+        mesh.Render(shader);
+    }
+
+    // NOTE: Other draws with the same shader use the full float layout
+    if (mImportOptions & IMPORT_COMPACT_VERTICES) {
+        shader.Set(shader.GetMeshUniforms().CompactVertices, 0);
+    }
+}
+
+void
+Model::Render(const Shader& shader, const glm::mat4& modelMatrix, const RenderView& view, const Skeleton::Pose* pose) {
+    const Shader::MeshUniforms& Uniforms = shader.GetMeshUniforms();
+    shader.Set(Uniforms.Model, modelMatrix);
+    bool Skinned = pose && mSkinVBO.Get() && !pose->Palette.empty();
+    if (Skinned) {
+        shader.SetArray(Uniforms.Bones, pose->Palette.data(), (unsigned)pose->Palette.size());
+    }
+    glm::vec3 AxisScale(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])));
+    // NOTE: Errors are in model units, the largest axis scale keeps the projected error conservative
+    float Scale = std::max(AxisScale.x, std::max(AxisScale.y, AxisScale.z));
+    // NOTE: Non-uniform scale bends normals, normal cones are only valid without it
+    float MinScale = std::min(AxisScale.x, std::min(AxisScale.y, AxisScale.z));
+    bool ConeCulling = MinScale >= Scale * 0.99f;
+
+    // NOTE: Culling runs in model space. Planes transform by the transposed model matrix,
+    // which keeps the sphere tests exact under any affine transform
+    glm::mat4 Transposed = glm::transpose(modelMatrix);
+    glm::vec4 ModelPlanes[6];
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        ModelPlanes[PlaneIdx] = Transposed * view.FrustumPlanes[PlaneIdx];
+        ModelPlanes[PlaneIdx] /= glm::length(glm::vec3(ModelPlanes[PlaneIdx]));
+    }
+    glm::vec3 ModelCamera(glm::inverse(modelMatrix) * glm::vec4(view.CameraPosition, 1.0f));
+
+    // NOTE: Reused every frame, only ever used from the render thread
+    static Meshlets::Ranges VisibleRanges;
+    GLState::BindVertexArray(mVAO.Get());
     for (const Mesh& mesh : mMeshes) {
-        mesh.Render();
+        Bounds WorldBounds = mesh.GetBounds().Transform(modelMatrix);
+        // NOTE: Distance to the closest point of the bounds, so no part of the mesh is under-detailed
+        float Distance = glm::length(WorldBounds.Center - view.CameraPosition) - WorldBounds.Radius;
+        unsigned Lod = mesh.SelectLod(Distance, view.ProjectionScale * Scale, LOD_PIXEL_ERROR);
+        if (mesh.IsSkinned()) {
+            shader.Set(Uniforms.Skinned, Skinned);
+            mesh.Render(shader, Lod);
+            shader.Set(Uniforms.Skinned, 0);
+            continue;
+        }
+
+        const Bounds& MeshBounds = mesh.GetBounds();
+        bool Visible = true;
+        for (unsigned PlaneIdx = 0; PlaneIdx < 6 && Visible && !MeshBounds.IsEmpty(); ++PlaneIdx) {
+            Visible = glm::dot(glm::vec3(ModelPlanes[PlaneIdx]), MeshBounds.Center) + ModelPlanes[PlaneIdx].w >= -MeshBounds.Radius;
+        }
+        if (!Visible) {
+            RenderStats::AddCulled(mesh.GetLodIndexCount(Lod) / 3);
+            continue;
+        }
+
+        if (Lod != 0 || !mesh.HasMeshlets()) {
+            mesh.Render(shader, Lod);
+            continue;
+        }
+        mesh.CullMeshlets(ModelCamera, ModelPlanes, ConeCulling, VisibleRanges);
+        RenderStats::AddCulled((mesh.GetLodIndexCount(0) - VisibleRanges.VisibleIndexCount) / 3);
+        mesh.Render(shader, VisibleRanges);
+    }
+
+    if (mImportOptions & IMPORT_COMPACT_VERTICES) {
+        shader.Set(Uniforms.CompactVertices, 0);
     }
 }
+
+void
+Model::RenderInstanced(const Shader& shader, const glm::mat4* modelMatrices, size_t count) {
+    if (!count || !mVAO.Get()) {
+        return;
+    }
+
+    GLState::BindVertexArray(mVAO.Get());
+    if (!mInstanceVBO.Get()) {
+        mInstanceVBO = GLBuffer::Create();
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.Get());
+        VertexFormat::SetupInstanceAttributes();
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.Get());
+    }
+
+    // NOTE: Orphaned before every update so the driver hands out fresh storage instead
+    // of waiting for draws still reading last frame's matrices
+    size_t Bytes = count * sizeof(glm::mat4);
+    if (Bytes > mInstanceBytes.Get()) {
+        mInstanceBytes.Set(std::max(Bytes, 2 * mInstanceBytes.Get()));
+    }
+    glBufferData(GL_ARRAY_BUFFER, mInstanceBytes.Get(), 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, Bytes, modelMatrices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader.Set(shader.GetMeshUniforms().Instanced, 1);
+    for (const Mesh& mesh : mMeshes) {
+        mesh.RenderInstanced(shader, (unsigned)count);
+    }
+    shader.Set(shader.GetMeshUniforms().Instanced, 0);
+
+    if (mImportOptions & IMPORT_COMPACT_VERTICES) {
+        shader.Set(shader.GetMeshUniforms().CompactVertices, 0);
+    }
+}
+
+RenderView
+Model::CreateRenderView(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& cameraPosition, float viewportHeight) {
+    RenderView Result;
+    Result.CameraPosition = cameraPosition;
+    Result.ProjectionScale = GetProjectionScale(projection, viewportHeight);
+
+    // NOTE: Gribb-Hartmann, the planes are sums and differences of the rows of the view projection matrix
+    glm::mat4 ViewProjection = projection * view;
+    glm::vec4 Rows[4];
+    for (unsigned Row = 0; Row < 4; ++Row) {
+        Rows[Row] = glm::vec4(ViewProjection[0][Row], ViewProjection[1][Row], ViewProjection[2][Row], ViewProjection[3][Row]);
+    }
+    for (unsigned Axis = 0; Axis < 3; ++Axis) {
+        Result.FrustumPlanes[2 * Axis] = Rows[3] + Rows[Axis];
+        Result.FrustumPlanes[2 * Axis + 1] = Rows[3] - Rows[Axis];
+    }
+    for (glm::vec4& Plane : Result.FrustumPlanes) {
+        Plane /= glm::length(glm::vec3(Plane));
+    }
+    return Result;
+}
+
+float
+Model::GetProjectionScale(const glm::mat4& projection, float viewportHeight) {
+    // NOTE: projection[1][1] is cot(fovy / 2), half the viewport spans tan(fovy / 2) at a distance of 1
+    return projection[1][1] * viewportHeight * 0.5f;
+}
@@ -9,7 +9,7 @@
  *
  */
 
-#ifndef MESH_H
+#pragma once
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -17,17 +17,103 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "meshcache.hpp"
+#include "texturecache.hpp"
+#include "assetpack.hpp"
+#include "memorystats.hpp"
+#include "glresource.hpp"
 
 
 #define POSITION_LOCATION 0
 
+// NOTE: Post-processing every import profile applies, the mesh code expects triangles and GL UVs
 #define POSTPROCESS_FLAGS (aiProcess_Triangulate | aiProcess_FlipUVs)
 #define INVALID_MATERIAL 0xFFFFFFFF
 
+enum EImportOptions {
+    // NOTE: Reorder indices/vertices for vertex cache, overdraw and fetch locality
+    IMPORT_OPTIMIZE_MESHES = 1 << 0,
+    // NOTE: Upload in the compact 16 byte vertex layout, dequantized in basic.vert
+    IMPORT_COMPACT_VERTICES = 1 << 1,
+    // NOTE: Build simplified levels of detail, picked per mesh by projected error when rendering
+    IMPORT_GENERATE_LODS = 1 << 2,
+    // NOTE: Keep CPU copies of vertices and indices after upload, for picking or physics.
+    // Without it they are freed as soon as each mesh is uploaded
+    IMPORT_KEEP_GEOMETRY = 1 << 3,
+    // NOTE: Split LOD 0 into meshlets, culled on the CPU against the frustum and by normal cone when rendering
+    IMPORT_BUILD_MESHLETS = 1 << 4,
+    // NOTE: Always import through Assimp and leave the mesh cache alone, for profiling imports
+    IMPORT_SKIP_CACHE = 1 << 5,
+    // NOTE: Model::Load interleaves straight from Assimp into mapped GL buffers, no copy of the
+    // geometry is made in system memory. Skips the mesh cache. Ignored with the CPU side options
+    // below, which need that copy, and by the AssetStreamer, which imports off the context thread
+    IMPORT_DIRECT_UPLOAD = 1 << 6,
+};
+
+// NOTE: Options which don't change imported data, left out of the mesh cache key
+static const unsigned IMPORT_RUNTIME_OPTIONS = IMPORT_KEEP_GEOMETRY | IMPORT_SKIP_CACHE | IMPORT_DIRECT_UPLOAD;
+
+// NOTE: Options processing geometry in system memory, these rule out IMPORT_DIRECT_UPLOAD
+static const unsigned IMPORT_CPU_GEOMETRY_OPTIONS = IMPORT_OPTIMIZE_MESHES | IMPORT_COMPACT_VERTICES | IMPORT_GENERATE_LODS
+    | IMPORT_KEEP_GEOMETRY | IMPORT_BUILD_MESHLETS;
+
+/**
+ * @brief Named sets of Assimp post-process steps on top of POSTPROCESS_FLAGS, trading
+ * import time against runtime quality. The profile's flags are part of the mesh cache key
+ *
+ */
+enum EImportProfile {
+    // NOTE: Only POSTPROCESS_FLAGS. OBJ faces keep their own vertices, nothing is shared
+    IMPORT_PROFILE_MINIMAL = 0,
+    // NOTE: Welds identical vertices, the cheapest step that makes indexing pay off
+    IMPORT_PROFILE_FAST = 1,
+    // NOTE: Also smooth normals where missing, Assimp's cache locality pass, merged meshes and
+    // no degenerate or redundant data. Slowest import, fewest vertices and draw calls
+    IMPORT_PROFILE_QUALITY = 2,
+    IMPORT_PROFILE_COUNT = 3,
+};
+
+/**
+ * @brief Time spent in each import stage and geometry size before and after post-processing
+ *
+ */
+struct ImportStats {
+    // NOTE: Mesh cache read time on warm imports, which skip post-processing, interleaving and mesh processing
+    double ParseMs;
+    double PostprocessMs;
+    double InterleaveMs;
+    // NOTE: Optimize, LOD generation and meshlet building
+    double MeshProcessMs;
+    double TextureMs;
+    double UploadMs;
+    // NOTE: As parsed, 0 on warm imports
+    size_t SourceVertices;
+    size_t SourceIndices;
+    // NOTE: After post-processing, LOD 0 only
+    size_t Vertices;
+    size_t Indices;
+};
+
+// NOTE: Largest simplification error on screen, in pixels, before a finer LOD is drawn
+static const float LOD_PIXEL_ERROR = 1.0f;
+
+/**
+ * @brief Camera data shared by all models rendered in a frame, see Model::CreateRenderView
+ *
+ */
+struct RenderView {
+    glm::vec3 CameraPosition;
+    // NOTE: World space, normalized, normals pointing into the frustum
+    glm::vec4 FrustumPlanes[6];
+    // NOTE: Pixels per world unit at a distance of 1, see Model::GetProjectionScale
+    float ProjectionScale;
+};
+
 enum EBufferType {
     INDEX_BUFFER = 0,
     POS_VB = 1,
@@ -39,33 +125,268 @@ enum EBufferType {
 class Model {
 private:
     std::vector<Mesh> mMeshes;
+    // NOTE: One VAO, vertex and index buffer for all meshes, drawn with base vertex draws
+    GLVertexArray mVAO;
+    GLBuffer mVBO;
+    GLBuffer mEBO;
+    // NOTE: Bone influences of skinned meshes, a second vertex stream of the same VAO. Empty for static models
+    GLBuffer mSkinVBO;
+    // NOTE: Streaming buffer of per-instance model matrices, created by the first RenderInstanced
+    GLBuffer mInstanceVBO;
+    MemoryStats::Counter mInstanceBytes{ MEMORY_GPU_INSTANCES };
+    MemoryStats::Counter mGpuBytes{ MEMORY_GPU_GEOMETRY };
+    Bounds mBounds;
+    Skeleton mSkeleton;
 
 public:
     std::string mFilename;
     std::string mDirectory;
+    unsigned mImportOptions;
+    EImportProfile mImportProfile;
+    bool mImportedFromCache;
+    ImportStats mImportStats;
 
     /**
      * @brief Ctor - sets up data for model loading in Assimp
      *
      * @param filename - Model path
+     * @param importOptions - EImportOptions bit mask, applied at import time (and baked into the mesh cache)
+     * @param importProfile - Assimp post-processing profile
      *
      */
-    Model(std::string filename);
+    Model(std::string filename, unsigned importOptions = 0, EImportProfile importProfile = IMPORT_PROFILE_MINIMAL);
+
+    // NOTE: Move-only, GL buffers and mesh textures are freed with the model
+    Model(Model&& other) = default;
+    Model& operator=(Model&& other) = default;
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
 
     /**
-     * @brief Loads all the meshes and model data
+     * @brief Loads all the meshes and model data. Uses the binary mesh cache
+     * when it is up to date, otherwise imports through Assimp and rebuilds the cache
      *
      * @returns true - Success, false - Failure
      */
     bool Load();
 
+    /**
+     * @brief CPU side of Load: reads the mesh cache or imports through Assimp. Doesn't touch GL,
+     * safe to call from a worker thread
+     *
+     * @returns true - Success, false - Failure
+     */
+    bool Import();
+
+    /**
+     * @brief Bounds of all meshes, valid after Import
+     *
+     * @returns Bounds in model space, see Bounds::Transform for world space
+     */
+    const Bounds& GetBounds() const;
+
+    /**
+     * @brief Skeleton and animations, valid after Import. Pass poses evaluated with it to Render
+     *
+     * @returns Skeleton, without bones for static models
+     */
+    const Skeleton& GetSkeleton() const;
+
+    /**
+     * @brief Gets the number of imported meshes
+     *
+     * @returns Mesh count
+     */
+    size_t GetMeshCount() const;
+
+    /**
+     * @brief Uploads one imported mesh to GL, into the model's shared buffers. The first call
+     * creates the buffers, sized for all meshes. Must be called on the context thread
+     *
+     * @param meshIdx Mesh index
+     */
+    void UploadMesh(size_t meshIdx);
+
+    /**
+     * @brief Uploads part of one imported mesh, so a large mesh can be spread over several
+     * frames. Same as UploadMesh once the last part is uploaded
+     *
+     * @param meshIdx Mesh index
+     * @param offset Bytes of the mesh uploaded so far, 0 for a new mesh. Advanced by the bytes uploaded
+     * @param maxBytes Most bytes uploaded by this call
+     * @returns true once the whole mesh is uploaded
+     */
+    bool UploadMeshPart(size_t meshIdx, size_t& offset, size_t maxBytes);
+
+    /**
+     * @brief Prints index and vertex buffer memory of the uploaded meshes
+     *
+     */
+    void PrintMemoryReport() const;
+
+    /**
+     * @brief Prints the time spent in each import stage and vertex/index counts before and after post-processing
+     *
+     */
+    void PrintImportReport() const;
+
+    /**
+     * @brief System memory held by the geometry of all meshes
+     *
+     * @returns CPU bytes
+     */
+    size_t GetCpuBytes() const;
+
+    /**
+     * @brief GL memory of the model's shared vertex and index buffers
+     *
+     * @returns GPU bytes
+     */
+    size_t GetGpuBytes() const;
+
+    /**
+     * @brief Gets the texture paths of all meshes, diffuse and specular per mesh. Empty for missing textures
+     *
+     * @returns Texture paths, 2 per mesh
+     */
+    std::vector<std::string> GetTexturePaths() const;
+
+    /**
+     * @brief Sets mesh textures, laid out like GetTexturePaths
+     *
+     * @param textures TextureIDs, 2 per mesh, 0 for missing textures. Takes over one
+     * texture cache reference per non-zero TextureID
+     */
+    void SetTextures(const std::vector<unsigned>& textures);
+
     /**
      * @brief Renderable Render implementation
      *
+     * @param shader - Shader the model is rendered with, must be in use
+     *
+     */
+    void Render(const Shader& shader);
+
+    /**
+     * @brief Renders the model, each mesh at the coarsest LOD whose simplification error
+     * projects to at most LOD_PIXEL_ERROR pixels. Meshes outside the frustum are skipped and
+     * meshes drawn at LOD 0 only draw their visible meshlets. Sets the model matrix on shader.
+     * Skinned meshes are deformed by pose and skip culling, their bounds are those of the bind pose
+     *
+     * @param shader - Shader the model is rendered with, must be in use
+     * @param modelMatrix - Model matrix
+     * @param view - Camera of the frame, see CreateRenderView
+     * @param pose - Pose from GetSkeleton().EvaluatePose, nullptr draws skinned meshes in the bind pose
+     *
+     */
+    void Render(const Shader& shader, const glm::mat4& modelMatrix, const RenderView& view, const Skeleton::Pose* pose = nullptr);
+
+    /**
+     * @brief Renders count copies of the model with one instanced draw per mesh. Matrices are
+     * streamed into a per-instance vertex buffer every call. Meshes are drawn at LOD 0 without
+     * culling and skinned meshes in the bind pose
+     *
+     * @param shader - Shader the model is rendered with, must be in use
+     * @param modelMatrices - Model matrix of every instance
+     * @param count - Number of instances
+     *
+     */
+    void RenderInstanced(const Shader& shader, const glm::mat4* modelMatrices, size_t count);
+
+    /**
+     * @brief Builds the camera data for Render
+     *
+     * @param projection - Perspective projection matrix
+     * @param view - View matrix
+     * @param cameraPosition - Camera position, in world space
+     * @param viewportHeight - Viewport height in pixels
+     *
+     * @returns Render view
+     */
+    static RenderView CreateRenderView(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& cameraPosition, float viewportHeight);
+
+    /**
+     * @brief Gets the on-screen size of one world unit at a distance of 1 for a perspective projection
+     *
+     * @param projection - Perspective projection matrix
+     * @param viewportHeight - Viewport height in pixels
+     *
+     * @returns Pixels per world unit at a distance of 1
+     */
+    static float GetProjectionScale(const glm::mat4& projection, float viewportHeight);
+
+    /**
+     * @brief Gets the Assimp post-process flags of a profile
+     *
+     * @param profile - Import profile
+     *
+     * @returns aiPostProcessSteps bit mask, POSTPROCESS_FLAGS included
+     */
+    static unsigned GetPostprocessFlags(EImportProfile profile);
+
+    /**
+     * @brief Gets the name of a profile, for reports
+     *
+     * @param profile - Import profile
+     *
+     * @returns Profile name
+     */
+    static const char* GetProfileName(EImportProfile profile);
+
+private:
+    /**
+     * @brief Reads and post-processes the model file through Assimp, recording parse stats
+     *
+     * @param importer - Importer owning the returned scene
+     *
+     * @returns Scene, nullptr on failure
+     */
+    const aiScene* readScene(Assimp::Importer& importer);
+
+    /**
+     * @brief Imports the model through Assimp
+     *
+     * @returns true - Success, false - Failure
+     */
+    bool importModel();
+
+    /**
+     * @brief Imports and uploads the model through mapped buffers, see IMPORT_DIRECT_UPLOAD.
+     * Must be called on the context thread
+     *
+     * @returns true - Success, false - Failure
      */
-    void Render();
+    bool importDirect();
 
+    /**
+     * @brief Loads meshes from the binary mesh cache
+     *
+     * @returns true - Cache hit, false - Cache miss
+     */
+    bool loadFromCache();
+
+    /**
+     * @brief Creates the shared VAO, vertex and index buffers and assigns each mesh its range
+     *
+     */
+    void createBuffers();
+
+    /**
+     * @brief Creates the shared VAO and allocates the vertex, skin and index buffers
+     *
+     * @param vertexCount - Vertices of all meshes
+     * @param indexCount - Indices of all meshes
+     * @param maxMeshVertexCount - Vertices of the largest mesh, picks the index type
+     * @param skinned - Whether to allocate the skin buffer
+     *
+     * @returns Index type
+     */
+    GLenum allocateBuffers(size_t vertexCount, size_t indexCount, size_t maxMeshVertexCount, bool skinned);
+
+    /**
+     * @brief Acquires all mesh textures from the texture cache in one parallel batch
+     *
+     */
+    void loadTextures();
 };
 
-#define MESH_HP
-#endif
@@ -1,17 +1,18 @@
 #include "renderable.hpp"
+#include "glstate.hpp"
 int Renderable::rCount;
 
 Renderable::Renderable(const float* vertices, const unsigned int verticesSize, const  unsigned int* indices, const int indicesSize) {
 	vCount = verticesSize / (6 * sizeof(float));
-	iCount = indicesSize / 3;
+	iCount = indicesSize / sizeof(unsigned int);
 
 	
-	glGenVertexArrays(1, &VAO);
+	VAO = GLVertexArray::Create();
 	std::cout << "-Made an array-" << std::endl;
-	glBindVertexArray(VAO);
+	GLState::BindVertexArray(VAO.Get());
 
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	VBO = GLBuffer::Create();
+	glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
 	std::cout << "-Made a buffer-" << std::endl;
 	glBufferData(GL_ARRAY_BUFFER, verticesSize, vertices, GL_STATIC_DRAW);
 
@@ -23,30 +24,24 @@ Renderable::Renderable(const float* vertices, const unsigned int verticesSize, c
 	if (iCount > 0)
 	{
 		std::cout << "-Made a buffer for indexing-" << std::endl;
-		glGenBuffers(1, &EBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		EBO = GLBuffer::Create();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, indices, GL_STATIC_DRAW);
 	}
 
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 
 	Renderable:rCount++;
 }
 Renderable::~Renderable() {
-
-	glDeleteBuffers(1, &VBO);
-	std::cout << "-Deleted a buffer-" << std::endl;
-	if (iCount > 0){
-		glDeleteBuffers(1, &EBO);
-		std::cout << "-Deleted a buffer for indexing-" << std::endl;
+	//Moved-from objekti nemaju bafere i nisu brojani
+	if (VAO.Get()) {
+		std::cout << "-Deleted an array-" << std::endl;
+		Renderable::rCount--;
 	}
-	std::cout << "-Deleted an array-" << std::endl;
-	glDeleteVertexArrays(1, &VAO);
-
-	Renderable::rCount--;
 }
 void Renderable::Render() {
-	glBindVertexArray(VAO);
+	GLState::BindVertexArray(VAO.Get()); //Ostaje vezan, GLState preskace ponovno vezivanje
 	if (iCount > 0)
 	{
 		std::cout << "-Drawing with indices-" << std::endl;
@@ -57,5 +52,4 @@ void Renderable::Render() {
 		std::cout << "-Drawing with vertices-" << std::endl;
 		glDrawArrays(GL_TRIANGLES, 0, vCount);
 	}
-	glBindVertexArray(0);
 }
\ No newline at end of file
@@ -1,14 +1,21 @@
 //Za olaksano crtanje objekata. Generise potrebne bafere pri konstrukciji objekta, brise ih pri destrukciji.
 #include <iostream>
 #include <GL/glew.h> //Da bi koristili OpenGL funkcije za bafere
+#include "glresource.hpp"
 
 class Renderable { 
-	unsigned int VAO, VBO, EBO; //Baferi
+	GLVertexArray VAO; //Baferi
+	GLBuffer VBO, EBO;
 	unsigned int vCount; //Broj tjemena
 	unsigned int iCount; //Broj indeksa za EBO
 public:
 	static int rCount;
 	Renderable(const float* vertices, const unsigned int verticesSize, const  unsigned int* indices, const int indicesSize);
+	// NOTE: Move-only, the buffers are deleted by their handles
+	Renderable(Renderable&& other) = default;
 	~Renderable();
 	void Render(); //Nacrtaj objekat
+	unsigned GetVAO() const { return VAO.Get(); } //Za RenderQueue stavke
+	unsigned GetIndexCount() const { return iCount; }
+	unsigned GetVertexCount() const { return vCount; }
 };
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "renderqueue.hpp"
+#include <algorithm>
+#include "renderstats.hpp"
+#include "glstate.hpp"
+#include "vertexformat.hpp"
+
+static_assert(RenderQueue::PASS_BITS + RenderQueue::PROGRAM_BITS + RenderQueue::MATERIAL_BITS
+    + RenderQueue::VAO_BITS + RenderQueue::DEPTH_BITS == 64, "Sort key fields must fill 64 bits");
+
+/**
+ * @brief Stable LSD radix sort on 8-bit digits. Digits equal in every key are skipped,
+ * which with few distinct programs and VAOs skips most of the passes
+ *
+ */
+template<typename T> static void
+radixSort(std::vector<T>& entries, std::vector<T>& scratch) {
+    scratch.resize(entries.size());
+    for (unsigned Shift = 0; Shift < 64; Shift += 8) {
+        size_t Counts[256] = { 0 };
+        for (const T& Entry : entries) {
+            ++Counts[(Entry.Key >> Shift) & 0xFF];
+        }
+        if (Counts[(entries[0].Key >> Shift) & 0xFF] == entries.size()) {
+            continue;
+        }
+
+        size_t Offset = 0;
+        for (size_t& Count : Counts) {
+            size_t Digit = Count;
+            Count = Offset;
+            Offset += Digit;
+        }
+        for (const T& Entry : entries) {
+            scratch[Counts[(Entry.Key >> Shift) & 0xFF]++] = Entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
+RenderQueue::DrawItem
+RenderQueue::CreateItem(const Shader& program, unsigned vao, unsigned count, bool indexed, const glm::mat4& modelMatrix) {
+    DrawItem Item = {};
+    Item.Program = &program;
+    Item.ModelMatrix = modelMatrix;
+    Item.VAO = vao;
+    Item.Count = count;
+    Item.Indexed = indexed;
+    return Item;
+}
+
+RenderQueue::DrawItem
+RenderQueue::CreateModelItem(const Shader& program, Model& model, const glm::mat4& modelMatrix, const RenderView& view, const Skeleton::Pose* pose) {
+    DrawItem Item = {};
+    Item.Program = &program;
+    Item.ModelMatrix = modelMatrix;
+    Item.Source = &model;
+    Item.View = &view;
+    Item.Pose = pose;
+    return Item;
+}
+
+uint64_t
+RenderQueue::MakeKey(EPass pass, unsigned program, unsigned material, unsigned vao, float depth) {
+    uint64_t Depth = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * ((1u << DEPTH_BITS) - 1));
+    uint64_t State = program & ((1u << PROGRAM_BITS) - 1);
+    State = (State << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+    State = (State << VAO_BITS) | (vao & ((1u << VAO_BITS) - 1));
+    uint64_t Key = (uint64_t)pass << (64 - PASS_BITS);
+    if (pass == PASS_TRANSPARENT) {
+        // NOTE: Blending needs strict back to front order, state only breaks depth ties
+        return Key | (Depth << (64 - PASS_BITS - DEPTH_BITS)) | State;
+    }
+    return Key | (State << DEPTH_BITS) | Depth;
+}
+
+void
+RenderQueue::Begin(const glm::vec3& cameraPosition, const glm::vec3& cameraForward, float farPlane) {
+    mCameraPosition = cameraPosition;
+    mCameraForward = cameraForward;
+    mFarPlane = farPlane;
+    mItems.clear();
+    mEntries.clear();
+}
+
+void
+RenderQueue::Submit(const DrawItem& item, EPass pass) {
+    glm::vec3 Center(item.ModelMatrix[3]);
+    if (item.Source) {
+        Center = item.Source->GetBounds().Transform(item.ModelMatrix).Center;
+    }
+    float Depth = glm::dot(Center - mCameraPosition, mCameraForward) / mFarPlane;
+    if (pass == PASS_TRANSPARENT) {
+        Depth = 1.0f - Depth;
+    }
+
+    SortEntry Entry;
+    Entry.Key = MakeKey(pass, item.Program->GetId(), item.DiffuseTexture, item.VAO, Depth);
+    Entry.Item = (unsigned)mItems.size();
+    mEntries.push_back(Entry);
+    mItems.push_back(item);
+}
+
+bool
+RenderQueue::canMerge(const DrawItem& a, const DrawItem& b) {
+    return !a.Source && !b.Source && a.Program == b.Program && a.VAO == b.VAO && a.DiffuseTexture == b.DiffuseTexture
+        && a.SpecularTexture == b.SpecularTexture && a.Count == b.Count && a.Indexed == b.Indexed
+        && a.ColorUniform.Location == b.ColorUniform.Location && (!a.ColorUniform.IsValid() || a.Color == b.Color);
+}
+
+void
+RenderQueue::Execute() {
+    if (mEntries.empty()) {
+        return;
+    }
+    radixSort(mEntries, mScratch);
+
+    // NOTE: Equal state sorts together, so mergeable items are adjacent
+    mBatches.clear();
+    mInstanceMatrices.clear();
+    for (size_t First = 0; First < mEntries.size();) {
+        const DrawItem& Item = mItems[mEntries[First].Item];
+        size_t Last = First + 1;
+        // NOTE: Transparent items are never merged, an instanced draw would blend its
+        // instances in submission order instead of back to front
+        bool Transparent = (mEntries[First].Key >> (64 - PASS_BITS)) == PASS_TRANSPARENT;
+        if (!Transparent && Item.Program->GetMeshUniforms().Instanced.IsValid()) {
+            while (Last < mEntries.size() && canMerge(Item, mItems[mEntries[Last].Item])) {
+                ++Last;
+            }
+        }
+
+        Batch Current = { First, (unsigned)(Last - First), Last - First >= MIN_INSTANCES, 0 };
+        if (Current.Instanced) {
+            Current.InstanceOffset = mInstanceMatrices.size() * sizeof(glm::mat4);
+            for (size_t EntryIdx = First; EntryIdx < Last; ++EntryIdx) {
+                mInstanceMatrices.push_back(mItems[mEntries[EntryIdx].Item].ModelMatrix);
+            }
+        } else {
+            Last = First + 1;
+            Current.EntryCount = 1;
+        }
+        mBatches.push_back(Current);
+        First = Last;
+    }
+
+    if (!mInstanceMatrices.empty()) {
+        if (!mInstanceVBO.Get()) {
+            mInstanceVBO = GLBuffer::Create();
+        }
+        // NOTE: Orphaned so the driver doesn't wait for last frame's draws, like Model::RenderInstanced
+        size_t Bytes = mInstanceMatrices.size() * sizeof(glm::mat4);
+        mInstanceCapacity = std::max(mInstanceCapacity, Bytes);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.Get());
+        glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity, 0, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, Bytes, mInstanceMatrices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    for (const Batch& CurrBatch : mBatches) {
+        drawBatch(CurrBatch);
+    }
+    mItems.clear();
+    mEntries.clear();
+}
+
+void
+RenderQueue::drawBatch(const Batch& batch) {
+    // NOTE: Binds go through GLState, which skips the ones matching the previous batch
+    const DrawItem& Item = mItems[mEntries[batch.FirstEntry].Item];
+    GLState::UseProgram(Item.Program->GetId());
+    if (Item.Source) {
+        Item.Source->Render(*Item.Program, Item.ModelMatrix, *Item.View, Item.Pose);
+        return;
+    }
+
+    if (Item.DiffuseTexture) {
+        GLState::BindTexture(0, Item.DiffuseTexture);
+    }
+    if (Item.SpecularTexture) {
+        GLState::BindTexture(1, Item.SpecularTexture);
+    }
+    GLState::BindVertexArray(Item.VAO);
+    if (Item.ColorUniform.IsValid()) {
+        Item.Program->Set(Item.ColorUniform, Item.Color);
+    }
+
+    if (!batch.Instanced) {
+        Item.Program->SetModel(Item.ModelMatrix);
+        if (Item.Indexed) {
+            glDrawElements(GL_TRIANGLES, Item.Count, GL_UNSIGNED_INT, 0);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, Item.Count);
+        }
+        RenderStats::AddDraw(Item.Count / 3);
+        return;
+    }
+
+    // NOTE: The instance attributes are VAO state, pointed at this batch's matrices. A VAO
+    // keeps them enabled afterwards, which non-instanced draws ignore as uInstanced is off
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.Get());
+    VertexFormat::SetupInstanceAttributes(batch.InstanceOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    const Shader::MeshUniforms& Uniforms = Item.Program->GetMeshUniforms();
+    Item.Program->Set(Uniforms.Instanced, 1);
+    if (Item.Indexed) {
+        glDrawElementsInstanced(GL_TRIANGLES, Item.Count, GL_UNSIGNED_INT, 0, batch.EntryCount);
+    } else {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, Item.Count, batch.EntryCount);
+    }
+    Item.Program->Set(Uniforms.Instanced, 0);
+    RenderStats::AddDraw((uint64_t)Item.Count / 3 * batch.EntryCount);
+}
@@ -0,0 +1,160 @@
+/**
+ * @file renderqueue.hpp
+ * @brief Per-frame list of draws, sorted by a 64-bit state key so consecutive draws
+ * share program, textures and VAO, which GLState then doesn't rebind
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "model.hpp"
+#include "glresource.hpp"
+
+class RenderQueue {
+public:
+    enum EPass {
+        // NOTE: Front to back within equal state, so the depth test rejects hidden fragments early
+        PASS_OPAQUE = 0,
+        // NOTE: Back to front, drawn after every opaque item
+        PASS_TRANSPARENT = 1,
+        PASS_COUNT = 2,
+    };
+
+    // NOTE: Key layout from the most significant bit, the transparent pass moves depth right
+    // after the pass. Programs, textures and VAOs are keyed by the low bits of their GL names,
+    // a collision only costs a state change
+    static const unsigned PASS_BITS = 2;
+    static const unsigned PROGRAM_BITS = 8;
+    static const unsigned MATERIAL_BITS = 16;
+    static const unsigned VAO_BITS = 14;
+    static const unsigned DEPTH_BITS = 24;
+
+    // NOTE: Runs of at least this many matching items are merged into one instanced draw
+    static const unsigned MIN_INSTANCES = 2;
+
+    /**
+     * @brief One draw. Either a VAO range drawn with glDrawArrays/glDrawElements, or a Model
+     * drawn through Model::Render when Source is set
+     *
+     */
+    struct DrawItem {
+        const Shader* Program;
+        glm::mat4 ModelMatrix;
+        // NOTE: Bound to units 0 and 1. 0 leaves the unit as it is
+        unsigned DiffuseTexture;
+        unsigned SpecularTexture;
+        // NOTE: Set through ColorUniform when the handle is valid, for unlit programs
+        Shader::Uniform<glm::vec3> ColorUniform;
+        glm::vec3 Color;
+
+        unsigned VAO;
+        // NOTE: Vertices, or GL_UNSIGNED_INT indices when Indexed
+        unsigned Count;
+        bool Indexed;
+
+        // NOTE: Model items bind their own VAO and textures, View and Pose are forwarded
+        // to Model::Render and must outlive Execute
+        Model* Source;
+        const RenderView* View;
+        const Skeleton::Pose* Pose;
+    };
+
+    /**
+     * @brief Creates a VAO range item
+     *
+     * @param program Shader the item is drawn with
+     * @param vao Vertex array
+     * @param count Vertex or index count
+     * @param indexed true - glDrawElements with GL_UNSIGNED_INT indices, false - glDrawArrays
+     * @param modelMatrix Model matrix
+     * @returns Item without textures or color
+     */
+    static DrawItem CreateItem(const Shader& program, unsigned vao, unsigned count, bool indexed, const glm::mat4& modelMatrix);
+
+    /**
+     * @brief Creates a Model item
+     *
+     * @param program Shader the model is drawn with
+     * @param model Model, drawn with Model::Render
+     * @param modelMatrix Model matrix
+     * @param view Camera of the frame, see Model::CreateRenderView
+     * @param pose Pose of skinned meshes, nullptr for the bind pose
+     * @returns Model item
+     */
+    static DrawItem CreateModelItem(const Shader& program, Model& model, const glm::mat4& modelMatrix, const RenderView& view, const Skeleton::Pose* pose = nullptr);
+
+    /**
+     * @brief Starts a frame, dropping items not executed. Depth in sort keys is the distance
+     * along the view direction, clamped to farPlane
+     *
+     * @param cameraPosition Camera position
+     * @param cameraForward Normalized view direction
+     * @param farPlane Far plane distance
+     */
+    void Begin(const glm::vec3& cameraPosition, const glm::vec3& cameraForward, float farPlane);
+
+    /**
+     * @brief Adds an item to the frame
+     *
+     * @param item Draw item
+     * @param pass Pass the item is drawn in
+     */
+    void Submit(const DrawItem& item, EPass pass = PASS_OPAQUE);
+
+    /**
+     * @brief Sorts the submitted items by key and draws them. Consecutive opaque VAO items
+     * sharing program, VAO, textures, color and count are drawn with one instanced draw, their
+     * model matrices streamed through a per-instance buffer. Needs uInstanced in the program
+     *
+     */
+    void Execute();
+
+    /**
+     * @brief Packs a sort key
+     *
+     * @param pass Pass
+     * @param program Program ID
+     * @param material Material key, the diffuse texture ID
+     * @param vao VAO ID
+     * @param depth Depth normalized to [0, 1], already inverted for the transparent pass
+     * @returns Sort key
+     */
+    static uint64_t MakeKey(EPass pass, unsigned program, unsigned material, unsigned vao, float depth);
+
+private:
+    struct SortEntry {
+        uint64_t Key;
+        unsigned Item;
+    };
+
+    /**
+     * @brief Run of sorted entries drawn together
+     *
+     */
+    struct Batch {
+        size_t FirstEntry;
+        unsigned EntryCount;
+        bool Instanced;
+        // NOTE: Byte offset of the first matrix in mInstanceVBO, when Instanced
+        size_t InstanceOffset;
+    };
+
+    static bool canMerge(const DrawItem& a, const DrawItem& b);
+    void drawBatch(const Batch& batch);
+
+    glm::vec3 mCameraPosition;
+    glm::vec3 mCameraForward;
+    float mFarPlane;
+    std::vector<DrawItem> mItems;
+    // NOTE: Reused every frame, the radix sort ping-pongs between the two
+    std::vector<SortEntry> mEntries;
+    std::vector<SortEntry> mScratch;
+    std::vector<Batch> mBatches;
+    std::vector<glm::mat4> mInstanceMatrices;
+    // NOTE: Orphaned and refilled once per Execute, grows but never shrinks
+    GLBuffer mInstanceVBO;
+    size_t mInstanceCapacity = 0;
+};
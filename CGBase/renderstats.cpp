@@ -0,0 +1,44 @@
+#include "renderstats.hpp"
+
+RenderStats::Frame RenderStats::sCurrent = { 0, 0, 0, 0, 0 };
+RenderStats::Frame RenderStats::sLast = { 0, 0, 0, 0, 0 };
+
+void
+RenderStats::AddDraw(uint64_t triangles) {
+    ++sCurrent.DrawCalls;
+    sCurrent.Triangles += triangles;
+}
+
+void
+RenderStats::AddCulled(uint64_t triangles) {
+    sCurrent.TrianglesCulled += triangles;
+}
+
+void
+RenderStats::AddStateChange(bool issued) {
+    ++sCurrent.StateChanges;
+    sCurrent.StateChangesElided += !issued;
+}
+
+void
+RenderStats::EndFrame() {
+    sLast = sCurrent;
+    sCurrent = { 0, 0, 0, 0, 0 };
+}
+
+const RenderStats::Frame&
+RenderStats::GetCurrentFrame() {
+    return sCurrent;
+}
+
+const RenderStats::Frame&
+RenderStats::GetLastFrame() {
+    return sLast;
+}
+
+void
+RenderStats::PrintLastFrame() {
+    std::cout << "Frame: " << sLast.DrawCalls << " draw calls, " << sLast.Triangles << " triangles, "
+        << sLast.TrianglesCulled << " triangles culled, " << sLast.StateChanges - sLast.StateChangesElided << " of "
+        << sLast.StateChanges << " state changes issued" << std::endl;
+}
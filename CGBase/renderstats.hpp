@@ -0,0 +1,72 @@
+/**
+ * @file renderstats.hpp
+ * @brief Per-frame counters of submitted draw calls and triangles
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+class RenderStats {
+public:
+    struct Frame {
+        unsigned DrawCalls;
+        uint64_t Triangles;
+        // NOTE: Triangles rejected on the CPU by mesh and meshlet culling
+        uint64_t TrianglesCulled;
+        // NOTE: Binds requested through GLState, and those skipped as redundant
+        unsigned StateChanges;
+        unsigned StateChangesElided;
+    };
+
+    /**
+     * @brief Counts a draw call towards the current frame
+     *
+     * @param triangles Triangles submitted by the draw call
+     */
+    static void AddDraw(uint64_t triangles);
+
+    /**
+     * @brief Counts triangles rejected before submission towards the current frame
+     *
+     * @param triangles Rejected triangles
+     */
+    static void AddCulled(uint64_t triangles);
+
+    /**
+     * @brief Counts a program, VAO or texture bind requested through GLState
+     *
+     * @param issued true - Passed on to GL, false - Elided as redundant
+     */
+    static void AddStateChange(bool issued);
+
+    /**
+     * @brief Closes the current frame. Call once per frame after the buffer swap
+     *
+     */
+    static void EndFrame();
+
+    /**
+     * @brief Gets the counters of the frame being recorded
+     *
+     * @returns Current frame counters
+     */
+    static const Frame& GetCurrentFrame();
+
+    /**
+     * @brief Gets the counters of the last finished frame
+     *
+     * @returns Last frame counters
+     */
+    static const Frame& GetLastFrame();
+
+    /**
+     * @brief Prints the counters of the last finished frame
+     *
+     */
+    static void PrintLastFrame();
+
+private:
+    static Frame sCurrent;
+    static Frame sLast;
+};
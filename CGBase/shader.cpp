@@ -1,71 +1,158 @@
 #include "shader.hpp"
+#include "assetpack.hpp"
+#include "frameuniforms.hpp"
+#include <algorithm>
 
 
 Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath) {
     unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER);
     unsigned fs = loadAndCompileShader(fShaderPath, GL_FRAGMENT_SHADER);
-    mId = createBasicProgram(vs, fs);
+    mProgram = GLProgram(createBasicProgram(vs, fs));
+    reflectUniforms();
+}
+
+void
+Shader::reflectUniforms() {
+    mUniforms.clear();
+    if (!mProgram.Get()) {
+        return;
+    }
+    FrameUniforms::BindBlocks(mProgram.Get());
+
+    int UniformCount = 0;
+    int MaxNameLength = 0;
+    glGetProgramiv(mProgram.Get(), GL_ACTIVE_UNIFORMS, &UniformCount);
+    glGetProgramiv(mProgram.Get(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &MaxNameLength);
+    std::vector<char> NameBuffer(std::max(MaxNameLength, 1));
+    for (int UniformIdx = 0; UniformIdx < UniformCount; ++UniformIdx) {
+        int NameLength = 0;
+        int Size = 0;
+        GLenum Type = 0;
+        glGetActiveUniform(mProgram.Get(), (GLuint)UniformIdx, (GLsizei)NameBuffer.size(), &NameLength, &Size, &Type, NameBuffer.data());
+        std::string Name(NameBuffer.data(), NameLength);
+        int Location = glGetUniformLocation(mProgram.Get(), Name.c_str());
+        // NOTE: Uniforms in blocks have no location, they are set through FrameUniforms
+        if (Location < 0) {
+            continue;
+        }
+
+        // NOTE: Arrays are reported once as "name[0]". Elements are contiguous only within
+        // an array of basic types, so each one is queried
+        size_t Bracket = Name.size() > 3 && Name.compare(Name.size() - 3, 3, "[0]") == 0 ? Name.size() - 3 : std::string::npos;
+        if (Bracket == std::string::npos) {
+            mUniforms[Name] = { Location, Type };
+            continue;
+        }
+
+        std::string BaseName = Name.substr(0, Bracket);
+        mUniforms[BaseName] = { Location, Type };
+        mUniforms[Name] = { Location, Type };
+        for (int ElementIdx = 1; ElementIdx < Size; ++ElementIdx) {
+            std::string ElementName = BaseName + "[" + std::to_string(ElementIdx) + "]";
+            mUniforms[ElementName] = { glGetUniformLocation(mProgram.Get(), ElementName.c_str()), Type };
+        }
+    }
+
+    mMeshUniforms.Model = GetUniform<glm::mat4>("uModel");
+    mMeshUniforms.View = GetUniform<glm::mat4>("uView");
+    mMeshUniforms.Projection = GetUniform<glm::mat4>("uProjection");
+    mMeshUniforms.Instanced = GetUniform<int>("uInstanced");
+    mMeshUniforms.CompactVertices = GetUniform<int>("uCompactVertices");
+    mMeshUniforms.PositionScale = GetUniform<glm::vec3>("uPositionScale");
+    mMeshUniforms.PositionOffset = GetUniform<glm::vec3>("uPositionOffset");
+    mMeshUniforms.Skinned = GetUniform<int>("uSkinned");
+    mMeshUniforms.Bones = GetUniform<glm::mat4>("uBones");
+}
+
+int
+Shader::findUniform(const std::string& uniform, unsigned type) const {
+    auto Found = mUniforms.find(uniform);
+    if (Found == mUniforms.end()) {
+        return -1;
+    }
+
+    unsigned Type = Found->second.Type;
+    bool IntLike = Type == GL_INT || Type == GL_BOOL || Type == GL_SAMPLER_2D || Type == GL_SAMPLER_CUBE;
+    if (type && Type != type && !(type == GL_INT && IntLike)) {
+        std::cerr << "[Err] Uniform " << uniform << " is set with the wrong type" << std::endl;
+        return -1;
+    }
+    return Found->second.Location;
 }
 
 void
 Shader::SetUniform1i(const std::string& uniform, int v) const {
-    glUniform1i(glGetUniformLocation(mId, uniform.c_str()), v);
+    glUniform1i(findUniform(uniform, 0), v);
 }
 
 void
 Shader::SetUniform1f(const std::string& uniform, float v) const {
-    glUniform1f(glGetUniformLocation(mId, uniform.c_str()), v);
+    glUniform1f(findUniform(uniform, 0), v);
 }
 
 void
 Shader::SetUniform3f(const std::string& uniform, const glm::vec3& v) const {
-    glUniform3f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y, v.z);
+    glUniform3f(findUniform(uniform, 0), v.x, v.y, v.z);
 }
 
 void
 Shader::SetUniform4m(const std::string& uniform, const glm::mat4& m) const {
-    glUniformMatrix4fv(glGetUniformLocation(mId, uniform.c_str()), 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix4fv(findUniform(uniform, 0), 1, GL_FALSE, &m[0][0]);
+}
+
+void
+Shader::SetUniform4mArray(const std::string& uniform, const glm::mat4* m, unsigned count) const {
+    glUniformMatrix4fv(findUniform(uniform, 0), count, GL_FALSE, &m[0][0][0]);
 }
 
 void
 Shader::SetModel(const glm::mat4& m) const {
-    SetUniform4m("uModel", m);
+    Set(mMeshUniforms.Model, m);
 }
 
 void
 Shader::SetView(const glm::mat4& m) const {
-    SetUniform4m("uView", m);
+    Set(mMeshUniforms.View, m);
 }
 
 void Shader::SetProjection(const glm::mat4& m) const {
-    SetUniform4m("uProjection", m);
+    Set(mMeshUniforms.Projection, m);
 }
 
 void Shader::SetColor(const float r, const float g, const float b) {
-    glUniform3f(glGetUniformLocation(mId, "uCol"), r,g,b);
+    glUniform3f(findUniform("uCol", 0), r,g,b);
 }
 
 
 unsigned
 Shader::GetId() const {
-    return mId;
+    return mProgram.Get();
 }
 
 unsigned
 Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
     unsigned ShaderID = 0;
-    std::ifstream In(filename);
     std::string Str;
-
-    In.seekg(0, std::ios::end);
-    Str.reserve(In.tellg());
-    In.seekg(0, std::ios::beg);
-
-    Str.assign((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
-    const char* CharContent = Str.c_str();
+    const char* CharContent = 0;
+    GLint Length = 0;
+    AssetPack::View Packed;
+    if (AssetPack::Find(filename, Packed)) {
+        // NOTE: Sources in the pack aren't null terminated, the length is passed explicitly
+        CharContent = (const char*)Packed.Data;
+        Length = (GLint)Packed.Size;
+    } else {
+        std::ifstream In(filename);
+        In.seekg(0, std::ios::end);
+        Str.reserve(In.tellg());
+        In.seekg(0, std::ios::beg);
+
+        Str.assign((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+        CharContent = Str.c_str();
+        Length = (GLint)Str.size();
+    }
 
     ShaderID = glCreateShader(shaderType);
-    glShaderSource(ShaderID, 1, &CharContent, NULL);
+    glShaderSource(ShaderID, 1, &CharContent, &Length);
     glCompileShader(ShaderID);
 
     int Success;
@@ -97,6 +184,7 @@ Shader::createBasicProgram(unsigned vShader, unsigned fShader) {
     if (!Success) {
         glGetProgramInfoLog(ProgramID, 512, NULL, InfoLog);
         std::cerr << "[Err] Failed to link shader program:" << std::endl << InfoLog << std::endl;
+        glDeleteProgram(ProgramID);
         return 0;
     }
 
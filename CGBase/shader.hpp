@@ -2,14 +2,48 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <string>
+#include <unordered_map>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include "glresource.hpp"
 
 class Shader {
 public:
     static const unsigned POSITION_LOCATION = 0;
     static const unsigned COLOR_LOCATION = 1;
 
+    /**
+     * @brief Uniform location resolved once, set without a name lookup. The type picks the
+     * matching Set overload. Invalid handles (location -1) are ignored by GL like unknown names
+     *
+     */
+    template<typename T>
+    struct Uniform {
+        int Location;
+
+        Uniform() : Location(-1) {}
+        explicit Uniform(int location) : Location(location) {}
+        bool IsValid() const { return Location >= 0; }
+    };
+
+    /**
+     * @brief Handles of the basic.vert uniforms Model and Mesh set on every draw, resolved
+     * after linking. Programs without some of them get invalid handles for those
+     *
+     */
+    struct MeshUniforms {
+        Uniform<glm::mat4> Model;
+        Uniform<glm::mat4> View;
+        Uniform<glm::mat4> Projection;
+        Uniform<int> Instanced;
+        Uniform<int> CompactVertices;
+        Uniform<glm::vec3> PositionScale;
+        Uniform<glm::vec3> PositionOffset;
+        Uniform<int> Skinned;
+        Uniform<glm::mat4> Bones;
+    };
+
     /**
      * @brief Ctor
      *
@@ -18,6 +52,10 @@ public:
      */
     Shader(const std::string& vShaderPath, const std::string& fShaderPath);
 
+    // NOTE: Move-only, the program is deleted with the shader
+    Shader(Shader&& other) = default;
+    Shader& operator=(Shader&& other) = default;
+
     /**
      * @brief Gets shader ID
      *
@@ -25,6 +63,48 @@ public:
      */
     unsigned GetId() const;
 
+    /**
+     * @brief Resolves a uniform handle from the uniforms reflected after linking. Meant for
+     * setup, hot paths keep the handle instead of the name
+     *
+     * @param uniform Name of uniform, array elements and struct fields as in GLSL ("uLights[1].Kd")
+     * @returns Handle, invalid if the uniform isn't active or its GLSL type doesn't match T
+     */
+    template<typename T>
+    Uniform<T> GetUniform(const std::string& uniform) const {
+        return Uniform<T>(findUniform(uniform, glType((const T*)0)));
+    }
+
+    /**
+     * @brief Gets the handles of the per draw basic.vert uniforms
+     *
+     * @returns Mesh uniform handles
+     */
+    const MeshUniforms& GetMeshUniforms() const { return mMeshUniforms; }
+
+    /**
+     * @brief Sets uniform values through handles. bool and sampler uniforms are Uniform<int>
+     *
+     * @param uniform Uniform handle
+     * @param v Value
+     */
+    void Set(Uniform<int> uniform, int v) const { glUniform1i(uniform.Location, v); }
+    void Set(Uniform<float> uniform, float v) const { glUniform1f(uniform.Location, v); }
+    void Set(Uniform<glm::vec3> uniform, const glm::vec3& v) const { glUniform3f(uniform.Location, v.x, v.y, v.z); }
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4& m) const { glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, &m[0][0]); }
+
+    /**
+     * @brief Sets a 4x4 matrix array uniform through its handle
+     *
+     * @param uniform Handle of the array
+     * @param m First GLM matrix
+     * @param count Number of matrices
+     */
+    void SetArray(Uniform<glm::mat4> uniform, const glm::mat4* m, unsigned count) const { glUniformMatrix4fv(uniform.Location, count, GL_FALSE, &m[0][0][0]); }
+
+    // NOTE: The by-name setters below look the location up in the reflected uniform table,
+    // fine for setup but use handles for anything set every frame
+
     /**
      * @brief Sets int uniform value
      *
@@ -57,6 +137,15 @@ public:
      */
     void SetUniform4m(const std::string& uniform, const glm::mat4& m) const;
 
+    /**
+     * @brief Sets 4x4 matrix array uniform value
+     *
+     * @param uniform Name of uniform
+     * @param m First GLM matrix
+     * @param count Number of matrices
+     */
+    void SetUniform4mArray(const std::string& uniform, const glm::mat4* m, unsigned count) const;
+
     /**
      * @brief Sets the Model matrix
      *
@@ -65,14 +154,16 @@ public:
     void SetModel(const glm::mat4& m) const;
 
     /**
-     * @brief Sets the View matrix
+     * @brief Sets the View matrix of programs declaring it as a plain uniform. Programs with
+     * the Camera block get it from FrameUniforms::SetCamera
      *
      * @param m View matrix
      */
     void SetView(const glm::mat4& m) const;
 
     /**
-     * @brief Sets the Projection matrix
+     * @brief Sets the Projection matrix of programs declaring it as a plain uniform. Programs with
+     * the Camera block get it from FrameUniforms::SetCamera
      *
      * @param m Projection matrix
      */
@@ -81,7 +172,40 @@ public:
     //Postavlja uCol;
     void SetColor(const float, const float, const float);
 private:
-    unsigned mId;
+    /**
+     * @brief Reflected active uniform
+     *
+     */
+    struct UniformInfo {
+        int Location;
+        unsigned Type;
+    };
+
+    GLProgram mProgram;
+    // NOTE: Every active uniform by GLSL name. Arrays are stored by their bare name and
+    // per element, struct fields by their full path
+    std::unordered_map<std::string, UniformInfo> mUniforms;
+    MeshUniforms mMeshUniforms;
+
+    static unsigned glType(const int*) { return GL_INT; }
+    static unsigned glType(const float*) { return GL_FLOAT; }
+    static unsigned glType(const glm::vec3*) { return GL_FLOAT_VEC3; }
+    static unsigned glType(const glm::mat4*) { return GL_FLOAT_MAT4; }
+
+    /**
+     * @brief Fills mUniforms from the active uniforms of the linked program and resolves mMeshUniforms
+     *
+     */
+    void reflectUniforms();
+
+    /**
+     * @brief Looks a uniform up in the reflected table
+     *
+     * @param uniform Name of uniform
+     * @param type Expected GL type, GL_INT also accepts bool and sampler uniforms. 0 accepts any type
+     * @returns Location, -1 if the uniform isn't active or the type doesn't match
+     */
+    int findUniform(const std::string& uniform, unsigned type) const;
 
     /**
      * @brief Loads shader from file and returns the compiled shader's ID
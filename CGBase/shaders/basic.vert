@@ -3,19 +3,63 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+// NOTE: See VertexFormat::SkinVertex, only read when uSkinned is set
+layout (location = 3) in uvec4 aBoneIds;
+layout (location = 4) in vec4 aBoneWeights;
+// NOTE: See Model::RenderInstanced and RenderQueue::Execute, only read when uInstanced is set
+layout (location = 5) in mat4 aInstanceModel;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+// NOTE: Shared by every program, see FrameUniforms::Camera
+layout (std140) uniform Camera {
+	mat4 uProjection;
+	mat4 uView;
+	vec3 uViewPos;
+};
 uniform mat4 uModel;
+uniform bool uInstanced;
+
+// NOTE: Compact vertices (see VertexFormat::CompactVertex) store position as shorts relative
+// to the mesh AABB and the normal octahedral encoded as 2 shorts
+uniform bool uCompactVertices;
+uniform vec3 uPositionScale;
+uniform vec3 uPositionOffset;
+
+// NOTE: Bone matrix palette, see Skeleton::EvaluatePose. Size matches Skeleton::MAX_BONES
+#define MAX_BONES 48
+uniform bool uSkinned;
+uniform mat4 uBones[MAX_BONES];
 
 out vec2 UV;
 out vec3 vWorldSpaceFragment;
 out vec3 vWorldSpaceNormal;
 
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f) {
+		vec2 SignNotZero = vec2(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+		n.xy = (1.0f - abs(e.yx)) * SignNotZero;
+	}
+	return normalize(n);
+}
+
 void main() {
-	vWorldSpaceFragment = vec3(uModel * vec4(aPos, 1.0f));
-	vWorldSpaceNormal = normalize(mat3(transpose(inverse(uModel))) * aNormal);
+	vec3 Position = aPos;
+	vec3 Normal = aNormal;
+	if (uCompactVertices) {
+		Position = aPos * uPositionScale + uPositionOffset;
+		Normal = octDecode(aNormal.xy / 32767.0f);
+	}
+	if (uSkinned) {
+		mat4 Skin = aBoneWeights.x * uBones[aBoneIds.x] + aBoneWeights.y * uBones[aBoneIds.y]
+			+ aBoneWeights.z * uBones[aBoneIds.z] + aBoneWeights.w * uBones[aBoneIds.w];
+		Position = vec3(Skin * vec4(Position, 1.0f));
+		Normal = mat3(Skin) * Normal;
+	}
+
+	mat4 Model = uInstanced ? aInstanceModel : uModel;
+	vWorldSpaceFragment = vec3(Model * vec4(Position, 1.0f));
+	vWorldSpaceNormal = normalize(mat3(transpose(inverse(Model))) * Normal);
 
 	UV = aUV;
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	gl_Position = uProjection * uView * Model * vec4(Position, 1.0f);
 }
\ No newline at end of file
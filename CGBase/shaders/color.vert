@@ -1,11 +1,19 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPos;
+// NOTE: See RenderQueue::Execute, only read when uInstanced is set
+layout (location = 5) in mat4 aInstanceModel;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+// NOTE: Shared by every program, see FrameUniforms::Camera
+layout (std140) uniform Camera {
+	mat4 uProjection;
+	mat4 uView;
+	vec3 uViewPos;
+};
 uniform mat4 uModel;
+uniform bool uInstanced;
 
 void main() {
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	mat4 Model = uInstanced ? aInstanceModel : uModel;
+	gl_Position = uProjection * uView * Model * vec4(aPos, 1.0f);
 }
\ No newline at end of file
@@ -1,25 +1,27 @@
 #version 330 core
 
+// NOTE: Members are ordered so every vec3 is followed by a float, the std140 layout
+// then has no implicit padding. See FrameUniforms::PointLight and DirectionalLight
 struct PositionalLight {
 	vec3 Position;
-	vec3 Ka;
-	vec3 Kd;
-	vec3 Ks;
 	float Kc;
+	vec3 Ka;
 	float Kl;
+	vec3 Kd;
 	float Kq;
+	vec3 Ks;
 };
 
 struct DirectionalLight {
 	vec3 Position;
-	vec3 Direction;
-	vec3 Ka;
-	vec3 Kd;
-	vec3 Ks;
 	float InnerCutOff;
+	vec3 Direction;
 	float OuterCutOff;
+	vec3 Ka;
 	float Kc;
+	vec3 Kd;
 	float Kl;
+	vec3 Ks;
 	float Kq;
 };
 
@@ -33,12 +35,21 @@ struct Material {
 
 #define NR_POINT_LIGHTS 2
 
-uniform PositionalLight uPointLights[NR_POINT_LIGHTS];
+// NOTE: Shared by every program, see FrameUniforms::Lights
+layout (std140) uniform Lights {
+	DirectionalLight uDirLight;
+	DirectionalLight uSpotlight;
+	PositionalLight uPointLights[NR_POINT_LIGHTS];
+};
+
+// NOTE: Shared by every program, see FrameUniforms::Camera
+layout (std140) uniform Camera {
+	mat4 uProjection;
+	mat4 uView;
+	vec3 uViewPos;
+};
 
-uniform DirectionalLight uSpotlight;
-uniform DirectionalLight uDirLight;
 uniform Material uMaterial;
-uniform vec3 uViewPos;
 
 in vec2 UV;
 in vec3 vWorldSpaceFragment;
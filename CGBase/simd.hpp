@@ -0,0 +1,14 @@
+/**
+ * @file simd.hpp
+ * @brief Instruction sets the hot loops (bounds, meshlet culling, skinning) may use
+ *
+ */
+#pragma once
+
+// NOTE: SSE2 is always there on x64, 32-bit builds fall back to scalar code without it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CG_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define CG_SIMD_SSE2 0
+#endif
@@ -0,0 +1,240 @@
+#include "skeleton.hpp"
+#include "simd.hpp"
+#include <cmath>
+#include <algorithm>
+
+// NOTE: Assimp leaves mTicksPerSecond at 0 for formats without it
+static const double DEFAULT_TICKS_PER_SECOND = 25.0;
+
+Skeleton::Skeleton()
+    : mGlobalInverse(1.0f) {}
+
+glm::mat4
+Skeleton::ToMat4(const aiMatrix4x4& m) {
+    return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                     m.a2, m.b2, m.c2, m.d2,
+                     m.a3, m.b3, m.c3, m.d3,
+                     m.a4, m.b4, m.c4, m.d4);
+}
+
+int
+Skeleton::findNode(const std::string& name) const {
+    for (size_t NodeIdx = 0; NodeIdx < mNodeNames.size(); ++NodeIdx) {
+        if (mNodeNames[NodeIdx] == name) {
+            return (int)NodeIdx;
+        }
+    }
+    return -1;
+}
+
+void
+Skeleton::addNode(const aiNode* node, int parent) {
+    int NodeIdx = (int)mParents.size();
+    mParents.push_back(parent);
+    mBindLocals.push_back(ToMat4(node->mTransformation));
+    mNodeNames.push_back(node->mName.C_Str());
+    for (unsigned ChildIdx = 0; ChildIdx < node->mNumChildren; ++ChildIdx) {
+        addNode(node->mChildren[ChildIdx], NodeIdx);
+    }
+}
+
+void
+Skeleton::Import(const aiScene* scene) {
+    mParents.clear();
+    mBindLocals.clear();
+    mNodeNames.clear();
+    mBoneNodes.clear();
+    mInverseBinds.clear();
+    mAnimations.clear();
+    mGlobalInverse = glm::mat4(1.0f);
+    if (!scene->mRootNode) {
+        return;
+    }
+
+    addNode(scene->mRootNode, -1);
+    mGlobalInverse = glm::inverse(mBindLocals[0]);
+    for (unsigned AnimationIdx = 0; AnimationIdx < scene->mNumAnimations; ++AnimationIdx) {
+        const aiAnimation* Source = scene->mAnimations[AnimationIdx];
+        double TicksPerSecond = Source->mTicksPerSecond != 0.0 ? Source->mTicksPerSecond : DEFAULT_TICKS_PER_SECOND;
+        Animation Imported;
+        Imported.Duration = (float)(Source->mDuration / TicksPerSecond);
+        for (unsigned ChannelIdx = 0; ChannelIdx < Source->mNumChannels; ++ChannelIdx) {
+            const aiNodeAnim* Channel = Source->mChannels[ChannelIdx];
+            int Node = findNode(Channel->mNodeName.C_Str());
+            if (Node < 0) {
+                continue;
+            }
+
+            Track CurrTrack;
+            CurrTrack.Node = (unsigned)Node;
+            CurrTrack.KeyOffset[KEY_POSITION] = (unsigned)Imported.Times.size();
+            CurrTrack.KeyCount[KEY_POSITION] = Channel->mNumPositionKeys;
+            for (unsigned KeyIdx = 0; KeyIdx < Channel->mNumPositionKeys; ++KeyIdx) {
+                const aiVectorKey& Key = Channel->mPositionKeys[KeyIdx];
+                Imported.Times.push_back((float)(Key.mTime / TicksPerSecond));
+                Imported.Keys.push_back(glm::vec4(Key.mValue.x, Key.mValue.y, Key.mValue.z, 0.0f));
+            }
+            CurrTrack.KeyOffset[KEY_ROTATION] = (unsigned)Imported.Times.size();
+            CurrTrack.KeyCount[KEY_ROTATION] = Channel->mNumRotationKeys;
+            for (unsigned KeyIdx = 0; KeyIdx < Channel->mNumRotationKeys; ++KeyIdx) {
+                const aiQuatKey& Key = Channel->mRotationKeys[KeyIdx];
+                Imported.Times.push_back((float)(Key.mTime / TicksPerSecond));
+                Imported.Keys.push_back(glm::vec4(Key.mValue.x, Key.mValue.y, Key.mValue.z, Key.mValue.w));
+            }
+            CurrTrack.KeyOffset[KEY_SCALE] = (unsigned)Imported.Times.size();
+            CurrTrack.KeyCount[KEY_SCALE] = Channel->mNumScalingKeys;
+            for (unsigned KeyIdx = 0; KeyIdx < Channel->mNumScalingKeys; ++KeyIdx) {
+                const aiVectorKey& Key = Channel->mScalingKeys[KeyIdx];
+                Imported.Times.push_back((float)(Key.mTime / TicksPerSecond));
+                Imported.Keys.push_back(glm::vec4(Key.mValue.x, Key.mValue.y, Key.mValue.z, 0.0f));
+            }
+            Imported.Tracks.push_back(CurrTrack);
+        }
+        mAnimations.push_back(std::move(Imported));
+    }
+}
+
+int
+Skeleton::AddBone(const std::string& nodeName, const glm::mat4& inverseBind) {
+    int Node = findNode(nodeName);
+    if (Node < 0) {
+        return -1;
+    }
+
+    for (size_t BoneIdx = 0; BoneIdx < mBoneNodes.size(); ++BoneIdx) {
+        if (mBoneNodes[BoneIdx] == (unsigned)Node) {
+            return (int)BoneIdx;
+        }
+    }
+    if (mBoneNodes.size() >= MAX_BONES) {
+        return -1;
+    }
+    mBoneNodes.push_back((unsigned)Node);
+    mInverseBinds.push_back(inverseBind);
+    return (int)mBoneNodes.size() - 1;
+}
+
+#if CG_SIMD_SSE2
+static inline __m128
+dot4(__m128 a, __m128 b) {
+    __m128 Product = _mm_mul_ps(a, b);
+    __m128 Sums = _mm_add_ps(Product, _mm_shuffle_ps(Product, Product, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(Sums, _mm_shuffle_ps(Sums, Sums, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+/**
+ * @brief Interpolates the keys around time. Rotations are normalized lerped along the shorter arc,
+ * which is close enough to slerp at animation key rates and much cheaper
+ *
+ */
+static glm::vec4
+sampleKeys(const Skeleton::Animation& animation, unsigned offset, unsigned count, float time, bool rotation) {
+    const float* Times = &animation.Times[offset];
+    const glm::vec4* Keys = &animation.Keys[offset];
+    unsigned Next = (unsigned)(std::upper_bound(Times, Times + count, time) - Times);
+    if (Next == 0 || Next == count) {
+        return Keys[Next == 0 ? 0 : count - 1];
+    }
+
+    unsigned Prev = Next - 1;
+    float Span = Times[Next] - Times[Prev];
+    float T = Span > 0.0f ? (time - Times[Prev]) / Span : 0.0f;
+    glm::vec4 Result;
+#if CG_SIMD_SSE2
+    __m128 A = _mm_loadu_ps(&Keys[Prev][0]);
+    __m128 B = _mm_loadu_ps(&Keys[Next][0]);
+    if (rotation) {
+        // NOTE: Flip B's sign when the quaternions are more than 90 degrees apart
+        __m128 Sign = _mm_and_ps(_mm_cmplt_ps(dot4(A, B), _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+        B = _mm_xor_ps(B, Sign);
+    }
+    __m128 Lerped = _mm_add_ps(A, _mm_mul_ps(_mm_sub_ps(B, A), _mm_set1_ps(T)));
+    if (rotation) {
+        Lerped = _mm_div_ps(Lerped, _mm_sqrt_ps(dot4(Lerped, Lerped)));
+    }
+    _mm_storeu_ps(&Result[0], Lerped);
+#else
+    glm::vec4 B = Keys[Next];
+    if (rotation && glm::dot(Keys[Prev], B) < 0.0f) {
+        B = -B;
+    }
+    Result = Keys[Prev] + (B - Keys[Prev]) * T;
+    if (rotation) {
+        Result = Result * (1.0f / glm::length(Result));
+    }
+#endif
+    return Result;
+}
+
+static glm::mat4
+composeTransform(const glm::vec4& position, const glm::vec4& rotation, const glm::vec4& scale) {
+    float X = rotation.x, Y = rotation.y, Z = rotation.z, W = rotation.w;
+    glm::mat4 Result;
+    Result[0] = glm::vec4(1.0f - 2.0f * (Y * Y + Z * Z), 2.0f * (X * Y + W * Z), 2.0f * (X * Z - W * Y), 0.0f) * scale.x;
+    Result[1] = glm::vec4(2.0f * (X * Y - W * Z), 1.0f - 2.0f * (X * X + Z * Z), 2.0f * (Y * Z + W * X), 0.0f) * scale.y;
+    Result[2] = glm::vec4(2.0f * (X * Z + W * Y), 2.0f * (Y * Z - W * X), 1.0f - 2.0f * (X * X + Y * Y), 0.0f) * scale.z;
+    Result[3] = glm::vec4(position.x, position.y, position.z, 1.0f);
+    return Result;
+}
+
+/**
+ * @brief out = a * b. out may alias a or b
+ *
+ */
+static void
+multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#if CG_SIMD_SSE2
+    __m128 A0 = _mm_loadu_ps(&a[0][0]);
+    __m128 A1 = _mm_loadu_ps(&a[1][0]);
+    __m128 A2 = _mm_loadu_ps(&a[2][0]);
+    __m128 A3 = _mm_loadu_ps(&a[3][0]);
+    for (unsigned Column = 0; Column < 4; ++Column) {
+        __m128 B = _mm_loadu_ps(&b[Column][0]);
+        __m128 Result = _mm_mul_ps(A0, _mm_shuffle_ps(B, B, _MM_SHUFFLE(0, 0, 0, 0)));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A1, _mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 1, 1, 1))));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A2, _mm_shuffle_ps(B, B, _MM_SHUFFLE(2, 2, 2, 2))));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A3, _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(&out[Column][0], Result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+void
+Skeleton::EvaluatePose(unsigned animation, float time, Pose& pose) const {
+    // NOTE: Locals are written into Globals, then made global in place. Parents come
+    // before their children, so a parent is already global when its children read it
+    pose.Globals.assign(mBindLocals.begin(), mBindLocals.end());
+    if (animation < mAnimations.size()) {
+        const Animation& Current = mAnimations[animation];
+        float Time = Current.Duration > 0.0f ? std::fmod(time, Current.Duration) : 0.0f;
+        if (Time < 0.0f) {
+            Time += Current.Duration;
+        }
+
+        for (const Track& CurrTrack : Current.Tracks) {
+            glm::vec4 Sampled[KEY_TYPE_COUNT] = { glm::vec4(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(1.0f) };
+            for (unsigned KeyType = 0; KeyType < KEY_TYPE_COUNT; ++KeyType) {
+                if (CurrTrack.KeyCount[KeyType]) {
+                    Sampled[KeyType] = sampleKeys(Current, CurrTrack.KeyOffset[KeyType], CurrTrack.KeyCount[KeyType], Time, KeyType == KEY_ROTATION);
+                }
+            }
+            pose.Globals[CurrTrack.Node] = composeTransform(Sampled[KEY_POSITION], Sampled[KEY_ROTATION], Sampled[KEY_SCALE]);
+        }
+    }
+
+    for (size_t NodeIdx = 0; NodeIdx < mParents.size(); ++NodeIdx) {
+        if (mParents[NodeIdx] >= 0) {
+            multiply(pose.Globals[mParents[NodeIdx]], pose.Globals[NodeIdx], pose.Globals[NodeIdx]);
+        }
+    }
+
+    pose.Palette.resize(mBoneNodes.size());
+    for (size_t BoneIdx = 0; BoneIdx < mBoneNodes.size(); ++BoneIdx) {
+        glm::mat4 BoneGlobal;
+        multiply(mGlobalInverse, pose.Globals[mBoneNodes[BoneIdx]], BoneGlobal);
+        multiply(BoneGlobal, mInverseBinds[BoneIdx], pose.Palette[BoneIdx]);
+    }
+}
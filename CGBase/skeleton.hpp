@@ -0,0 +1,122 @@
+/**
+ * @file skeleton.hpp
+ * @brief Node hierarchy, bones and keyframe animations of a skinned model, and pose
+ * evaluation into the bone matrix palette used by basic.vert
+ *
+ */
+#pragma once
+#include <vector>
+#include <string>
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+class Skeleton {
+public:
+    // NOTE: Size of uBones in basic.vert. 48 matrices stay within the 1024 vertex
+    // uniform components GL 3.3 guarantees, together with the other basic.vert uniforms
+    static const unsigned MAX_BONES = 48;
+
+    enum EKeyType {
+        KEY_POSITION = 0,
+        KEY_ROTATION = 1,
+        KEY_SCALE = 2,
+        KEY_TYPE_COUNT = 3,
+    };
+
+    /**
+     * @brief Keys animating one node, a range of Animation::Times/Keys per key type
+     *
+     */
+    struct Track {
+        unsigned Node;
+        unsigned KeyOffset[KEY_TYPE_COUNT];
+        unsigned KeyCount[KEY_TYPE_COUNT];
+    };
+
+    /**
+     * @brief Keyframes of all tracks in two parallel arrays. Every key is 4 floats so it is
+     * sampled with one SIMD load: xyz for position and scale, xyzw quaternion for rotation
+     *
+     */
+    struct Animation {
+        float Duration;
+        std::vector<Track> Tracks;
+        std::vector<float> Times;
+        std::vector<glm::vec4> Keys;
+    };
+
+    /**
+     * @brief Scratch and output of EvaluatePose, one per animated instance. Reused between frames
+     *
+     */
+    struct Pose {
+        std::vector<glm::mat4> Globals;
+        std::vector<glm::mat4> Palette;
+    };
+
+    // NOTE: Nodes are flattened with parents before children, the root has parent -1
+    std::vector<int> mParents;
+    std::vector<glm::mat4> mBindLocals;
+    std::vector<unsigned> mBoneNodes;
+    std::vector<glm::mat4> mInverseBinds;
+    glm::mat4 mGlobalInverse;
+    std::vector<Animation> mAnimations;
+
+    Skeleton();
+
+    /**
+     * @brief Imports the node hierarchy and animations of a scene. Bones are added by
+     * the meshes referencing them, see AddBone
+     *
+     * @param scene Assimp scene
+     */
+    void Import(const aiScene* scene);
+
+    /**
+     * @brief Gets the bone driven by a node, adding it on first use
+     *
+     * @param nodeName Name of the node the bone follows
+     * @param inverseBind Mesh space to bone space transform in the bind pose
+     * @returns Bone index, -1 if the node doesn't exist or there are more than MAX_BONES bones
+     */
+    int AddBone(const std::string& nodeName, const glm::mat4& inverseBind);
+
+    /**
+     * @brief Whether any mesh is skinned to the skeleton
+     *
+     * @returns true - Has bones, false - Static model
+     */
+    bool HasBones() const { return !mBoneNodes.empty(); }
+
+    /**
+     * @brief Gets the number of imported animations
+     *
+     * @returns Animation count
+     */
+    unsigned GetAnimationCount() const { return (unsigned)mAnimations.size(); }
+
+    /**
+     * @brief Samples an animation and builds the bone matrix palette
+     *
+     * @param animation Animation index
+     * @param time Time in seconds, wrapped to the animation duration
+     * @param pose Output pose, Palette has one matrix per bone
+     */
+    void EvaluatePose(unsigned animation, float time, Pose& pose) const;
+
+    /**
+     * @brief Converts an Assimp (row major) matrix to GLM
+     *
+     * @param m Assimp matrix
+     * @returns GLM matrix
+     */
+    static glm::mat4 ToMat4(const aiMatrix4x4& m);
+
+private:
+    // NOTE: Names are only needed to resolve bones and tracks at import, they are not cached
+    std::vector<std::string> mNodeNames;
+
+    int findNode(const std::string& name) const;
+    void addNode(const aiNode* node, int parent);
+};
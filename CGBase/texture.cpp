@@ -1,44 +1,272 @@
 #include "texture.hpp"
+#include "texturecache.hpp"
+#include "assetpack.hpp"
+#include "ktx.hpp"
+#include "glstate.hpp"
+#include <fstream>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-unsigned
+bool Texture::sUseBakedTextures = true;
+
+GLTexture
 Texture::LoadImageToTexture(const std::string& filePath) {
-    int TextureWidth;
-    int TextureHeight;
-    int TextureChannels;
     std::cout << "Loading texture: " << filePath << std::endl;
-    unsigned char* ImageData = stbi_load(filePath.c_str(), &TextureWidth, &TextureHeight, &TextureChannels, 0);
+    Image Decoded;
+    if (!DecodeImage(filePath, Decoded)) {
+        std::cerr << "Failed to load texture: " << filePath << std::endl;
+        return GLTexture();
+    }
+
+    GLTexture Texture = UploadImage(Decoded);
+    // NOTE(Jovan): ImageData is no longer necessary in RAM and can be deallocated
+    FreeImage(Decoded);
+    return Texture;
+}
+
+std::vector<GLTexture>
+Texture::LoadImagesToTextures(const std::vector<std::string>& filePaths) {
+    if (filePaths.empty()) {
+        return std::vector<GLTexture>();
+    }
+
+    typedef std::chrono::high_resolution_clock Clock;
+    auto Start = Clock::now();
+
+    std::vector<Image> Images;
+    unsigned ThreadCount = DecodeImages(filePaths, Images);
+    std::chrono::duration<double, std::milli> DecodeTime = Clock::now() - Start;
+
+    // NOTE: GL calls are only valid on the thread which owns the context, so uploads stay here
+    std::vector<GLTexture> Textures(filePaths.size());
+    double DecodeSum = 0.0;
+    size_t TextureBytes = 0;
+    for (size_t Idx = 0; Idx < Images.size(); ++Idx) {
+        Image& Decoded = Images[Idx];
+        if (!Decoded.Data) {
+            std::cerr << "Failed to load texture: " << filePaths[Idx] << std::endl;
+            continue;
+        }
+
+        auto UploadStart = Clock::now();
+        Textures[Idx] = UploadImage(Decoded);
+        std::chrono::duration<double, std::milli> UploadTime = Clock::now() - UploadStart;
+        DecodeSum += Decoded.DecodeMs;
+        TextureBytes += GetTextureBytes(Decoded);
+        std::cout << "Loaded texture: " << Decoded.Path << " (" << Decoded.Width << "x" << Decoded.Height
+            << (Decoded.InternalFormat ? ", baked" : "") << ") decode " << Decoded.DecodeMs << " ms, upload "
+            << UploadTime.count() << " ms, " << GetTextureBytes(Decoded) / 1024 << " KB" << std::endl;
+        FreeImage(Decoded);
+    }
+
+    std::chrono::duration<double, std::milli> TotalTime = Clock::now() - Start;
+    std::cout << "Loaded " << filePaths.size() << " textures on " << ThreadCount << " threads in "
+        << TotalTime.count() << " ms (decode " << DecodeTime.count() << " ms wall, "
+        << DecodeSum << " ms summed), " << TextureBytes / 1024 << " KB texture memory" << std::endl;
+    return Textures;
+}
+
+unsigned
+Texture::DecodeImages(const std::vector<std::string>& filePaths, std::vector<Image>& images) {
+    images.assign(filePaths.size(), Image());
+    std::atomic<size_t> NextImage(0);
+    auto DecodeWorker = [&]() {
+        for (size_t Idx = NextImage++; Idx < filePaths.size(); Idx = NextImage++) {
+            DecodeImage(filePaths[Idx], images[Idx]);
+        }
+    };
+
+    unsigned ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    ThreadCount = std::min(ThreadCount, (unsigned)filePaths.size());
+    std::vector<std::thread> Workers;
+    for (unsigned ThreadIdx = 0; ThreadIdx < ThreadCount; ++ThreadIdx) {
+        Workers.emplace_back(DecodeWorker);
+    }
+    for (std::thread& Worker : Workers) {
+        Worker.join();
+    }
+    return ThreadCount;
+}
 
-    if (!ImageData) {
-        std::cerr << "Failed to load texture: " << filePath << " loading default instead" << std::endl;
-        return LoadImageToTexture(MISSING_TEXTURE_PATH);
+bool
+Texture::DecodeImage(const std::string& filePath, Image& image) {
+    if (sUseBakedTextures && LoadBakedImage(filePath, image)) {
+        return true;
+    }
+    return DecodeSourceImage(filePath, image);
+}
+
+bool
+Texture::DecodeSourceImage(const std::string& filePath, Image& image) {
+    auto Start = std::chrono::high_resolution_clock::now();
+    image.Path = filePath;
+    AssetPack::View Packed;
+    if (AssetPack::Find(filePath, Packed)) {
+        // NOTE: Decodes straight out of the mapped pack, no intermediate file buffer
+        image.Data = stbi_load_from_memory(Packed.Data, (int)Packed.Size, &image.Width, &image.Height, &image.Channels, 0);
+    } else {
+        image.Data = stbi_load(filePath.c_str(), &image.Width, &image.Height, &image.Channels, 0);
+    }
+    if (!image.Data) {
+        return false;
     }
 
     // NOTE(Jovan): Images should usually flipped vertically as they are loaded "upside-down"
-    stbi__vertical_flip(ImageData, TextureWidth, TextureHeight, TextureChannels);
+    stbi__vertical_flip(image.Data, image.Width, image.Height, image.Channels);
+    image.Hash = TextureCache::HashImage(image);
+    std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+    image.DecodeMs = Elapsed.count();
+    return true;
+}
+
+bool
+Texture::LoadBakedImage(const std::string& filePath, Image& image) {
+    auto Start = std::chrono::high_resolution_clock::now();
+    std::string ContainerPath = Ktx::GetContainerPath(filePath);
+    AssetPack::View Packed;
+    const unsigned char* Container = 0;
+    size_t ContainerSize = 0;
+    if (AssetPack::Find(ContainerPath, Packed)) {
+        Container = Packed.Data;
+        ContainerSize = Packed.Size;
+        image.Mapped = true;
+    } else {
+        struct stat SourceInfo, ContainerInfo;
+        if (stat(ContainerPath.c_str(), &ContainerInfo) != 0) {
+            return false;
+        }
+        if (stat(filePath.c_str(), &SourceInfo) == 0 && SourceInfo.st_mtime > ContainerInfo.st_mtime) {
+            std::cout << "Baked texture " << ContainerPath << " is stale, decoding " << filePath << std::endl;
+            return false;
+        }
+
+        std::ifstream In(ContainerPath, std::ios::binary);
+        ContainerSize = (size_t)ContainerInfo.st_size;
+        // NOTE: Released with free in FreeImage
+        unsigned char* Buffer = (unsigned char*)malloc(ContainerSize);
+        if (!Buffer || !In.read((char*)Buffer, ContainerSize)) {
+            free(Buffer);
+            return false;
+        }
+        Container = Buffer;
+        image.Mapped = false;
+    }
 
+    Ktx::Header Header;
+    std::vector<Ktx::Level> Levels;
+    bool Compressed = false;
+    bool Valid = Ktx::Parse(Container, ContainerSize, Header, Levels);
+    if (Valid) {
+        Compressed = Header.Format == 0;
+        // NOTE: Without S3TC the source image is decoded instead
+        Valid = !Compressed || GLEW_EXT_texture_compression_s3tc;
+    }
+    if (!Valid) {
+        if (!image.Mapped) {
+            free((void*)Container);
+        }
+        image.Mapped = false;
+        return false;
+    }
+
+    image.Data = (unsigned char*)Container;
+    image.Path = filePath;
+    image.Width = Header.Width;
+    image.Height = Header.Height;
+    image.Channels = Header.BaseInternalFormat == GL_RGBA ? 4 : Header.BaseInternalFormat == GL_RG ? 2
+        : Header.BaseInternalFormat == GL_RED ? 1 : 3;
+    image.InternalFormat = Header.InternalFormat;
+    image.Format = Header.Format;
+    image.LevelData.clear();
+    image.LevelSizes.clear();
+    for (const Ktx::Level& Level : Levels) {
+        image.LevelData.push_back(Level.Data);
+        image.LevelSizes.push_back(Level.Size);
+    }
+    image.Hash = TextureCache::HashImage(image);
+    std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+    image.DecodeMs = Elapsed.count();
+    return true;
+}
+
+void
+Texture::SetUseBakedTextures(bool enabled) {
+    sUseBakedTextures = enabled;
+}
+
+GLenum
+Texture::GetPixelFormat(int channels) {
     // NOTE(Jovan): Checks or "guesses" the loaded image's format
-    GLint InternalFormat = -1;
-    switch (TextureChannels) {
-    case 1: InternalFormat = GL_RED; break;
-    case 3: InternalFormat = GL_RGB; break;
-    case 4: InternalFormat = GL_RGBA; break;
-    default: InternalFormat = GL_RGB; break;
+    switch (channels) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 4: return GL_RGBA;
+    default: return GL_RGB;
     }
+}
 
-    unsigned Texture;
-    glGenTextures(1, &Texture);
-    glBindTexture(GL_TEXTURE_2D, Texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, TextureWidth, TextureHeight, 0, InternalFormat, GL_UNSIGNED_BYTE, ImageData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+size_t
+Texture::GetTextureBytes(const Image& image) {
+    if (image.InternalFormat) {
+        size_t Bytes = 0;
+        for (size_t LevelSize : image.LevelSizes) {
+            Bytes += LevelSize;
+        }
+        return Bytes;
+    }
+
+    // NOTE: glGenerateMipmap adds a third of the base level
+    size_t BaseBytes = (size_t)image.Width * image.Height * image.Channels;
+    return BaseBytes + BaseBytes / 3;
+}
+
+GLTexture
+Texture::UploadImage(const Image& image) {
+    GLTexture Texture = GLTexture::Create();
+    GLState::BindTexture(0, Texture.Get());
+    if (image.InternalFormat) {
+        // NOTE: Baked mip chain, uploaded level by level without touching the pixels
+        GLsizei Width = image.Width, Height = image.Height;
+        for (size_t Level = 0; Level < image.LevelData.size(); ++Level) {
+            if (image.Format == 0) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)Level, image.InternalFormat, Width, Height, 0,
+                    (GLsizei)image.LevelSizes[Level], image.LevelData[Level]);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, (GLint)Level, image.InternalFormat, Width, Height, 0, image.Format,
+                    GL_UNSIGNED_BYTE, image.LevelData[Level]);
+            }
+            Width = std::max(1, Width / 2);
+            Height = std::max(1, Height / 2);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.LevelData.size() - 1);
+    } else {
+        GLenum Format = GetPixelFormat(image.Channels);
+        glTexImage2D(GL_TEXTURE_2D, 0, Format, image.Width, image.Height, 0, Format, GL_UNSIGNED_BYTE, image.Data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // NOTE(Jovan): ImageData is no longer necessary in RAM and can be deallocated
-    stbi_image_free(ImageData);
     return Texture;
-}
\ No newline at end of file
+}
+
+void
+Texture::FreeImage(Image& image) {
+    if (image.Data && !image.Mapped) {
+        if (image.InternalFormat) {
+            free(image.Data);
+        } else {
+            stbi_image_free(image.Data);
+        }
+    }
+    image.Data = 0;
+    image.LevelData.clear();
+}
@@ -1,20 +1,135 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <GL/glew.h>
 #include <iostream>
+#include "glresource.hpp"
 
 static const std::string MISSING_TEXTURE_PATH = "res/missing_texture";
 
 class Texture {
 public:
 	/**
-	 * @brief Loads image file and creates an OpenGL texture.
+	 * @brief Decoded, vertically flipped image waiting to be uploaded to GL
+	 *
+	 */
+	struct Image {
+		std::string Path;
+		unsigned char* Data = 0;
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		uint64_t Hash = 0;
+		double DecodeMs = 0.0;
+		// NOTE: Set for baked containers (see TextureBaker), which carry their own mip chain.
+		// Levels point into Data, or into the mapped asset pack when Mapped is set
+		unsigned InternalFormat = 0;
+		unsigned Format = 0;
+		std::vector<const unsigned char*> LevelData;
+		std::vector<size_t> LevelSizes;
+		bool Mapped = false;
+	};
+
+	/**
+	 * @brief Loads image file and creates an OpenGL texture. Bypasses the TextureCache,
+	 * prefer TextureCache::Acquire for textures which might be shared.
 	 * NOTE: Try avoiding .jpg and other lossy compression formats as
 	 * they are uncompressed during loading and the memory benefit is
 	 * negated with the addition of loss of quality
 	 *
 	 * @param filePath Image file path
-	 * @returns TextureID
+	 * @returns Texture, empty if loading failed
+	 */
+	static GLTexture LoadImageToTexture(const std::string& filePath);
+
+	/**
+	 * @brief Loads a batch of image files. Images are decoded and flipped concurrently
+	 * on a pool of worker threads, only the GL upload is done on the calling (context) thread.
+	 * Per image and total load times are reported
+	 *
+	 * @param filePaths Image file paths
+	 * @returns Textures, in the same order as filePaths. Empty for images which failed to load
+	 */
+	static std::vector<GLTexture> LoadImagesToTextures(const std::vector<std::string>& filePaths);
+
+	/**
+	 * @brief Decodes and flips a batch of image files concurrently on a pool of worker threads
+	 *
+	 * @param filePaths Image file paths
+	 * @param images Output images, in the same order as filePaths. Data is 0 for failed images
+	 * @returns Number of worker threads used
+	 */
+	static unsigned DecodeImages(const std::vector<std::string>& filePaths, std::vector<Image>& images);
+
+	/**
+	 * @brief Decodes and flips an image file and hashes its contents. Prefers an up to date
+	 * baked container next to the image (see Ktx::GetContainerPath) when baked textures are enabled.
+	 * Doesn't touch GL so it is safe to call from any thread
+	 *
+	 * @param filePath Image file path
+	 * @param image Output image, Data is 0 on failure
+	 * @returns true - Success, false - Failure
+	 */
+	static bool DecodeImage(const std::string& filePath, Image& image);
+
+	/**
+	 * @brief Decodes and flips the image file itself, ignoring baked containers
+	 *
+	 * @param filePath Image file path
+	 * @param image Output image, Data is 0 on failure
+	 * @returns true - Success, false - Failure
 	 */
-	static unsigned LoadImageToTexture(const std::string& filePath);
+	static bool DecodeSourceImage(const std::string& filePath, Image& image);
+
+	/**
+	 * @brief Loads the baked container of an image file. Containers in the asset pack are used in place.
+	 * Fails if there is no container, it is older than the image or the GPU can't sample its format
+	 *
+	 * @param filePath Image file path, not the container path
+	 * @param image Output image, Data is 0 on failure
+	 * @returns true - Success, false - Failure
+	 */
+	static bool LoadBakedImage(const std::string& filePath, Image& image);
+
+	/**
+	 * @brief Enables or disables loading baked containers, enabled by default
+	 *
+	 * @param enabled Whether DecodeImage should look for baked containers
+	 */
+	static void SetUseBakedTextures(bool enabled);
+
+	/**
+	 * @brief Returns the GL pixel format for uncompressed data
+	 *
+	 * @param channels Bytes per pixel
+	 * @returns GL pixel format
+	 */
+	static GLenum GetPixelFormat(int channels);
+
+	/**
+	 * @brief Returns the texture memory an image takes once uploaded, mip chain included
+	 *
+	 * @param image Decoded image
+	 * @returns Size in bytes
+	 */
+	static size_t GetTextureBytes(const Image& image);
+
+	/**
+	 * @brief Creates an OpenGL texture from a decoded image. Must be called on the context thread
+	 *
+	 * @param image Decoded image
+	 * @returns Texture
+	 */
+	static GLTexture UploadImage(const Image& image);
+
+	/**
+	 * @brief Frees decoded image data
+	 *
+	 * @param image Decoded image
+	 */
+	static void FreeImage(Image& image);
+
+private:
+	static bool sUseBakedTextures;
 };
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "texturebaker.hpp"
+#include "texture.hpp"
+#include "assetpack.hpp"
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+static uint16_t
+packRGB565(const float* color) {
+    int R = std::min(31, std::max(0, (int)std::lround(color[0] * 31.0f / 255.0f)));
+    int G = std::min(63, std::max(0, (int)std::lround(color[1] * 63.0f / 255.0f)));
+    int B = std::min(31, std::max(0, (int)std::lround(color[2] * 31.0f / 255.0f)));
+    return (uint16_t)((R << 11) | (G << 5) | B);
+}
+
+static void
+unpackRGB565(uint16_t packed, int* color) {
+    int R = (packed >> 11) & 31, G = (packed >> 5) & 63, B = packed & 31;
+    color[0] = (R << 3) | (R >> 2);
+    color[1] = (G << 2) | (G >> 4);
+    color[2] = (B << 3) | (B >> 2);
+}
+
+std::vector<std::vector<unsigned char>>
+TextureBaker::GenerateMips(const unsigned char* pixels, int width, int height, int channels) {
+    std::vector<std::vector<unsigned char>> Levels;
+    Levels.push_back(std::vector<unsigned char>(pixels, pixels + (size_t)width * height * channels));
+    while (width > 1 || height > 1) {
+        int NextWidth = std::max(1, width / 2);
+        int NextHeight = std::max(1, height / 2);
+        const std::vector<unsigned char>& Src = Levels.back();
+        std::vector<unsigned char> Dst((size_t)NextWidth * NextHeight * channels);
+        for (int Y = 0; Y < NextHeight; ++Y) {
+            // NOTE: Odd sizes clamp to the last row/column, same as a 1 pixel wide level
+            int Y0 = std::min(2 * Y, height - 1), Y1 = std::min(2 * Y + 1, height - 1);
+            for (int X = 0; X < NextWidth; ++X) {
+                int X0 = std::min(2 * X, width - 1), X1 = std::min(2 * X + 1, width - 1);
+                for (int C = 0; C < channels; ++C) {
+                    int Sum = Src[((size_t)Y0 * width + X0) * channels + C] + Src[((size_t)Y0 * width + X1) * channels + C]
+                        + Src[((size_t)Y1 * width + X0) * channels + C] + Src[((size_t)Y1 * width + X1) * channels + C];
+                    Dst[((size_t)Y * NextWidth + X) * channels + C] = (unsigned char)((Sum + 2) / 4);
+                }
+            }
+        }
+        Levels.push_back(std::move(Dst));
+        width = NextWidth;
+        height = NextHeight;
+    }
+    return Levels;
+}
+
+void
+TextureBaker::encodeColorBlock(const unsigned char rgba[64], unsigned char* out) {
+    // NOTE: Endpoints are the extremes along the principal axis of the block's colors
+    float Mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int Idx = 0; Idx < 16; ++Idx) {
+        for (int C = 0; C < 3; ++C) {
+            Mean[C] += rgba[Idx * 4 + C] / 16.0f;
+        }
+    }
+
+    float Covariance[6] = { 0.0f };
+    for (int Idx = 0; Idx < 16; ++Idx) {
+        float R = rgba[Idx * 4] - Mean[0], G = rgba[Idx * 4 + 1] - Mean[1], B = rgba[Idx * 4 + 2] - Mean[2];
+        Covariance[0] += R * R;
+        Covariance[1] += R * G;
+        Covariance[2] += R * B;
+        Covariance[3] += G * G;
+        Covariance[4] += G * B;
+        Covariance[5] += B * B;
+    }
+
+    float Axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int Iteration = 0; Iteration < 8; ++Iteration) {
+        float Next[3] = {
+            Covariance[0] * Axis[0] + Covariance[1] * Axis[1] + Covariance[2] * Axis[2],
+            Covariance[1] * Axis[0] + Covariance[3] * Axis[1] + Covariance[4] * Axis[2],
+            Covariance[2] * Axis[0] + Covariance[4] * Axis[1] + Covariance[5] * Axis[2],
+        };
+        float Length = std::sqrt(Next[0] * Next[0] + Next[1] * Next[1] + Next[2] * Next[2]);
+        if (Length < 1e-6f) {
+            break;
+        }
+        for (int C = 0; C < 3; ++C) {
+            Axis[C] = Next[C] / Length;
+        }
+    }
+
+    float MinProjection = 1e30f, MaxProjection = -1e30f;
+    for (int Idx = 0; Idx < 16; ++Idx) {
+        float Projection = 0.0f;
+        for (int C = 0; C < 3; ++C) {
+            Projection += (rgba[Idx * 4 + C] - Mean[C]) * Axis[C];
+        }
+        MinProjection = std::min(MinProjection, Projection);
+        MaxProjection = std::max(MaxProjection, Projection);
+    }
+
+    float Max[3], Min[3];
+    for (int C = 0; C < 3; ++C) {
+        Max[C] = Mean[C] + Axis[C] * MaxProjection;
+        Min[C] = Mean[C] + Axis[C] * MinProjection;
+        // NOTE: Inset the endpoints, the interpolated colors cover the block better
+        float Inset = (Max[C] - Min[C]) / 16.0f;
+        Max[C] -= Inset;
+        Min[C] += Inset;
+    }
+
+    uint16_t Color0 = packRGB565(Max);
+    uint16_t Color1 = packRGB565(Min);
+    // NOTE: Color0 > Color1 selects the 4 color mode
+    if (Color0 < Color1) {
+        std::swap(Color0, Color1);
+    }
+
+    int Palette[4][3];
+    unpackRGB565(Color0, Palette[0]);
+    unpackRGB565(Color1, Palette[1]);
+    for (int C = 0; C < 3; ++C) {
+        Palette[2][C] = (2 * Palette[0][C] + Palette[1][C]) / 3;
+        Palette[3][C] = (Palette[0][C] + 2 * Palette[1][C]) / 3;
+    }
+
+    uint32_t Indices = 0;
+    if (Color0 != Color1) {
+        for (int Idx = 0; Idx < 16; ++Idx) {
+            int Best = 0, BestDistance = 1 << 30;
+            for (int Entry = 0; Entry < 4; ++Entry) {
+                int Distance = 0;
+                for (int C = 0; C < 3; ++C) {
+                    int Delta = rgba[Idx * 4 + C] - Palette[Entry][C];
+                    Distance += Delta * Delta;
+                }
+                if (Distance < BestDistance) {
+                    BestDistance = Distance;
+                    Best = Entry;
+                }
+            }
+            Indices |= (uint32_t)Best << (2 * Idx);
+        }
+    }
+
+    out[0] = Color0 & 0xFF;
+    out[1] = Color0 >> 8;
+    out[2] = Color1 & 0xFF;
+    out[3] = Color1 >> 8;
+    for (int Byte = 0; Byte < 4; ++Byte) {
+        out[4 + Byte] = (Indices >> (8 * Byte)) & 0xFF;
+    }
+}
+
+void
+TextureBaker::encodeAlphaBlock(const unsigned char rgba[64], unsigned char* out) {
+    int Alpha0 = 0, Alpha1 = 255;
+    for (int Idx = 0; Idx < 16; ++Idx) {
+        Alpha0 = std::max(Alpha0, (int)rgba[Idx * 4 + 3]);
+        Alpha1 = std::min(Alpha1, (int)rgba[Idx * 4 + 3]);
+    }
+
+    // NOTE: Alpha0 > Alpha1 selects 6 interpolated values between the endpoints
+    int Palette[8] = { Alpha0, Alpha1 };
+    for (int Entry = 1; Entry < 7; ++Entry) {
+        Palette[Entry + 1] = ((7 - Entry) * Alpha0 + Entry * Alpha1) / 7;
+    }
+
+    uint64_t Indices = 0;
+    if (Alpha0 != Alpha1) {
+        for (int Idx = 0; Idx < 16; ++Idx) {
+            int Best = 0, BestDistance = 256;
+            for (int Entry = 0; Entry < 8; ++Entry) {
+                int Distance = std::abs(rgba[Idx * 4 + 3] - Palette[Entry]);
+                if (Distance < BestDistance) {
+                    BestDistance = Distance;
+                    Best = Entry;
+                }
+            }
+            Indices |= (uint64_t)Best << (3 * Idx);
+        }
+    }
+
+    out[0] = (unsigned char)Alpha0;
+    out[1] = (unsigned char)Alpha1;
+    for (int Byte = 0; Byte < 6; ++Byte) {
+        out[2 + Byte] = (Indices >> (8 * Byte)) & 0xFF;
+    }
+}
+
+std::vector<unsigned char>
+TextureBaker::EncodeBlocks(const unsigned char* pixels, int width, int height, int channels, bool alpha) {
+    int BlocksX = (width + 3) / 4, BlocksY = (height + 3) / 4;
+    size_t BlockBytes = alpha ? 16 : 8;
+    std::vector<unsigned char> Blocks((size_t)BlocksX * BlocksY * BlockBytes);
+    unsigned char Block[64];
+    for (int BlockY = 0; BlockY < BlocksY; ++BlockY) {
+        for (int BlockX = 0; BlockX < BlocksX; ++BlockX) {
+            for (int Idx = 0; Idx < 16; ++Idx) {
+                // NOTE: Blocks hanging over the edge repeat the last row/column
+                int X = std::min(BlockX * 4 + Idx % 4, width - 1);
+                int Y = std::min(BlockY * 4 + Idx / 4, height - 1);
+                const unsigned char* Pixel = pixels + ((size_t)Y * width + X) * channels;
+                for (int C = 0; C < 4; ++C) {
+                    Block[Idx * 4 + C] = C < channels ? Pixel[C] : 255;
+                }
+            }
+
+            unsigned char* Out = &Blocks[((size_t)BlockY * BlocksX + BlockX) * BlockBytes];
+            if (alpha) {
+                encodeAlphaBlock(Block, Out);
+                Out += 8;
+            }
+            encodeColorBlock(Block, Out);
+        }
+    }
+    return Blocks;
+}
+
+std::vector<unsigned char>
+TextureBaker::padRows(const std::vector<unsigned char>& pixels, int width, int height, int channels) {
+    // NOTE: KTX and the default GL_UNPACK_ALIGNMENT both expect rows aligned to 4 bytes
+    size_t RowBytes = (size_t)width * channels;
+    size_t PaddedRowBytes = (RowBytes + 3) & ~(size_t)3;
+    if (RowBytes == PaddedRowBytes) {
+        return pixels;
+    }
+
+    std::vector<unsigned char> Padded(PaddedRowBytes * height, 0);
+    for (int Y = 0; Y < height; ++Y) {
+        std::copy(pixels.begin() + Y * RowBytes, pixels.begin() + (Y + 1) * RowBytes, Padded.begin() + Y * PaddedRowBytes);
+    }
+    return Padded;
+}
+
+bool
+TextureBaker::Bake(const std::string& imagePath, EBakeFormat format, size_t& sourceBytes, size_t& bakedBytes) {
+    Texture::Image Source;
+    if (!Texture::DecodeSourceImage(imagePath, Source)) {
+        return false;
+    }
+
+    std::vector<std::vector<unsigned char>> Levels = GenerateMips(Source.Data, Source.Width, Source.Height, Source.Channels);
+    Ktx::Header Header;
+    Header.Width = Source.Width;
+    Header.Height = Source.Height;
+    bool Compress = format == BAKE_BLOCK_COMPRESSED && (Source.Channels == 3 || Source.Channels == 4);
+    if (Compress) {
+        bool Alpha = Source.Channels == 4;
+        Header.Type = 0;
+        Header.Format = 0;
+        Header.InternalFormat = Alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        Header.BaseInternalFormat = Alpha ? GL_RGBA : GL_RGB;
+    } else {
+        Header.Type = GL_UNSIGNED_BYTE;
+        Header.Format = Texture::GetPixelFormat(Source.Channels);
+        Header.InternalFormat = Header.Format;
+        Header.BaseInternalFormat = Header.Format;
+    }
+
+    sourceBytes = 0;
+    bakedBytes = 0;
+    int Width = Source.Width, Height = Source.Height;
+    for (std::vector<unsigned char>& Level : Levels) {
+        sourceBytes += Level.size();
+        Level = Compress ? EncodeBlocks(Level.data(), Width, Height, Source.Channels, Source.Channels == 4)
+            : padRows(Level, Width, Height, Source.Channels);
+        bakedBytes += Level.size();
+        Width = std::max(1, Width / 2);
+        Height = std::max(1, Height / 2);
+    }
+    Texture::FreeImage(Source);
+    return Ktx::Write(Ktx::GetContainerPath(imagePath), Header, Levels);
+}
+
+bool
+TextureBaker::BakeDirectories(const std::vector<std::string>& directories, EBakeFormat format) {
+    std::vector<std::string> Files;
+    for (const std::string& Directory : directories) {
+        AssetPack::ListFiles(Directory, Files);
+    }
+
+    std::vector<std::string> Images;
+    for (const std::string& File : Files) {
+        size_t Dot = File.find_last_of('.');
+        std::string Extension = Dot == std::string::npos ? "" : File.substr(Dot);
+        if (Extension == ".png" || Extension == ".jpg") {
+            Images.push_back(File);
+        }
+    }
+    std::sort(Images.begin(), Images.end());
+
+    struct Result {
+        bool Success;
+        size_t SourceBytes;
+        size_t BakedBytes;
+        double Ms;
+    };
+    std::vector<Result> Results(Images.size());
+    std::atomic<size_t> NextImage(0);
+    auto BakeWorker = [&]() {
+        for (size_t Idx = NextImage++; Idx < Images.size(); Idx = NextImage++) {
+            auto Start = std::chrono::high_resolution_clock::now();
+            Result& CurrResult = Results[Idx];
+            CurrResult.Success = Bake(Images[Idx], format, CurrResult.SourceBytes, CurrResult.BakedBytes);
+            std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+            CurrResult.Ms = Elapsed.count();
+        }
+    };
+
+    unsigned ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    ThreadCount = std::min(ThreadCount, (unsigned)std::max((size_t)1, Images.size()));
+    std::vector<std::thread> Workers;
+    for (unsigned ThreadIdx = 0; ThreadIdx < ThreadCount; ++ThreadIdx) {
+        Workers.emplace_back(BakeWorker);
+    }
+    for (std::thread& Worker : Workers) {
+        Worker.join();
+    }
+
+    bool Success = true;
+    size_t SourceTotal = 0, BakedTotal = 0;
+    for (size_t Idx = 0; Idx < Images.size(); ++Idx) {
+        const Result& CurrResult = Results[Idx];
+        if (!CurrResult.Success) {
+            std::cerr << "[Err] Failed to bake " << Images[Idx] << std::endl;
+            Success = false;
+            continue;
+        }
+        SourceTotal += CurrResult.SourceBytes;
+        BakedTotal += CurrResult.BakedBytes;
+        std::cout << "Baked " << Images[Idx] << ": " << CurrResult.SourceBytes / 1024 << " KB -> "
+            << CurrResult.BakedBytes / 1024 << " KB in " << CurrResult.Ms << " ms" << std::endl;
+    }
+    std::cout << "Baked " << Images.size() << " images (" << (format == BAKE_BLOCK_COMPRESSED ? "BC1/BC3" : "uncompressed")
+        << "), texture memory " << SourceTotal / 1024 << " KB -> " << BakedTotal / 1024 << " KB" << std::endl;
+    return Success;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file texturebaker.hpp
+ * @brief Offline baking of images into KTX containers with precomputed mips and optional BC1/BC3 compression
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include "ktx.hpp"
+
+enum EBakeFormat {
+    // NOTE: Precomputed mips only, same pixel format as the source image
+    BAKE_UNCOMPRESSED = 0,
+    // NOTE: BC1 for images without alpha, BC3 for images with alpha
+    BAKE_BLOCK_COMPRESSED = 1,
+};
+
+class TextureBaker {
+public:
+    /**
+     * @brief Bakes every .png and .jpg under the given directories, reporting
+     * texture memory before and after
+     *
+     * @param directories Directories to bake, recursively
+     * @param format Bake format
+     * @returns true - All images baked, false - At least one image failed
+     */
+    static bool BakeDirectories(const std::vector<std::string>& directories, EBakeFormat format);
+
+    /**
+     * @brief Bakes a single image into Ktx::GetContainerPath(imagePath)
+     *
+     * @param imagePath Source image path
+     * @param format Bake format
+     * @param sourceBytes Output texture memory of the image uploaded the old way, mips included
+     * @param bakedBytes Output texture memory of the baked image
+     * @returns true - Success, false - Failure
+     */
+    static bool Bake(const std::string& imagePath, EBakeFormat format, size_t& sourceBytes, size_t& bakedBytes);
+
+    /**
+     * @brief Builds a box filtered mip chain down to 1x1
+     *
+     * @param pixels Tightly packed level 0 pixels
+     * @param width Level 0 width
+     * @param height Level 0 height
+     * @param channels Bytes per pixel
+     * @returns Tightly packed levels, largest first
+     */
+    static std::vector<std::vector<unsigned char>> GenerateMips(const unsigned char* pixels, int width, int height, int channels);
+
+    /**
+     * @brief Encodes an image into BC1 (DXT1) or BC3 (DXT5) blocks
+     *
+     * @param pixels Tightly packed pixels, 3 or 4 channels
+     * @param width Width
+     * @param height Height
+     * @param channels Bytes per pixel
+     * @param alpha true - BC3, false - BC1
+     * @returns Encoded blocks, row by row
+     */
+    static std::vector<unsigned char> EncodeBlocks(const unsigned char* pixels, int width, int height, int channels, bool alpha);
+
+private:
+    static void encodeColorBlock(const unsigned char rgba[64], unsigned char* out);
+    static void encodeAlphaBlock(const unsigned char rgba[64], unsigned char* out);
+    static std::vector<unsigned char> padRows(const std::vector<unsigned char>& pixels, int width, int height, int channels);
+};
@@ -0,0 +1,307 @@
+#include "texturecache.hpp"
+#include <cstring>
+#include <vector>
+#include "glstate.hpp"
+
+std::unordered_map<std::string, unsigned> TextureCache::sPathTextures;
+std::unordered_map<uint64_t, unsigned> TextureCache::sContentTextures;
+std::unordered_map<unsigned, TextureCache::Entry> TextureCache::sEntries;
+GLTexture TextureCache::sMissingTexture;
+TextureCache::Stats TextureCache::sStats = { 0 };
+
+TextureCache::Reference::Reference(Reference&& other)
+    : mTexture(other.mTexture) {
+    other.mTexture = 0;
+}
+
+TextureCache::Reference&
+TextureCache::Reference::operator=(Reference&& other) {
+    if (this != &other) {
+        Release(mTexture);
+        mTexture = other.mTexture;
+        other.mTexture = 0;
+    }
+    return *this;
+}
+
+TextureCache::Reference::~Reference() {
+    Release(mTexture);
+}
+
+unsigned
+TextureCache::Acquire(const std::string& filePath) {
+    return AcquireBatch(std::vector<std::string>(1, filePath))[0];
+}
+
+std::vector<unsigned>
+TextureCache::AcquireBatch(const std::vector<std::string>& filePaths) {
+    std::vector<unsigned> Textures(filePaths.size(), 0);
+    std::vector<std::string> MissPaths;
+    std::vector<size_t> MissSlots;
+    std::unordered_map<std::string, size_t> MissIndices;
+
+    for (size_t Idx = 0; Idx < filePaths.size(); ++Idx) {
+        std::string Path = NormalizePath(filePaths[Idx]);
+        if (acquireCached(Path, Textures[Idx])) {
+            continue;
+        }
+
+        // NOTE: Same path requested twice in one batch, decode it once
+        if (MissIndices.find(Path) == MissIndices.end()) {
+            MissIndices[Path] = MissPaths.size();
+            MissPaths.push_back(Path);
+        }
+        MissSlots.push_back(Idx);
+    }
+
+    std::vector<Texture::Image> Images;
+    Texture::DecodeImages(MissPaths, Images);
+    std::vector<unsigned> MissTextures(MissPaths.size(), 0);
+    for (size_t MissIdx = 0; MissIdx < MissPaths.size(); ++MissIdx) {
+        MissTextures[MissIdx] = acquireDecoded(MissPaths[MissIdx], Images[MissIdx]);
+        Texture::FreeImage(Images[MissIdx]);
+    }
+
+    // NOTE: The first slot of each decoded path owns the reference taken by acquireDecoded,
+    // every other slot asking for the same path is a regular path hit
+    std::vector<bool> Claimed(MissPaths.size(), false);
+    for (size_t Slot : MissSlots) {
+        const std::string Path = NormalizePath(filePaths[Slot]);
+        size_t MissIdx = MissIndices[Path];
+        if (Claimed[MissIdx] && acquireCached(Path, Textures[Slot])) {
+            continue;
+        }
+        Textures[Slot] = MissTextures[MissIdx];
+        Claimed[MissIdx] = true;
+    }
+
+    return Textures;
+}
+
+unsigned
+TextureCache::AcquireDecoded(const std::string& filePath, Texture::Image& image) {
+    std::string Path = NormalizePath(filePath);
+    unsigned TextureID = 0;
+    if (acquireCached(Path, TextureID)) {
+        return TextureID;
+    }
+    return acquireDecoded(Path, image);
+}
+
+bool
+TextureCache::acquireCached(const std::string& path, unsigned& texture) {
+    auto It = sPathTextures.find(path);
+    if (It == sPathTextures.end()) {
+        return false;
+    }
+
+    texture = It->second;
+    if (texture == sMissingTexture.Get()) {
+        // NOTE: Known bad path, don't try decoding it again
+        return true;
+    }
+
+    Entry& CachedEntry = sEntries[texture];
+    ++CachedEntry.RefCount;
+    ++sStats.PathHits;
+    sStats.BytesSaved += CachedEntry.Bytes;
+    return true;
+}
+
+unsigned
+TextureCache::acquireDecoded(const std::string& path, Texture::Image& image) {
+    if (!image.Data) {
+        std::cerr << "Failed to load texture: " << path << " loading default instead" << std::endl;
+        sPathTextures[path] = GetMissingTexture();
+        return sMissingTexture.Get();
+    }
+
+    size_t Bytes = Texture::GetTextureBytes(image);
+    auto It = sContentTextures.find(image.Hash);
+    if (It != sContentTextures.end() && matchesImage(sEntries[It->second], image)) {
+        // NOTE: Different file, identical pixels. Share the texture and remember the new path
+        Entry& CachedEntry = sEntries[It->second];
+        ++CachedEntry.RefCount;
+        ++sStats.ContentHits;
+        sStats.BytesSaved += CachedEntry.Bytes;
+        sPathTextures[path] = It->second;
+        std::cout << "Texture " << path << " is identical to an already loaded texture, sharing it" << std::endl;
+        return It->second;
+    }
+
+    if (It != sContentTextures.end()) {
+        std::cout << "Texture " << path << " collides with a loaded texture's hash, loading it separately" << std::endl;
+    }
+
+    Entry NewEntry = { 1, image.Hash, Bytes, image.Width, image.Height, image.Channels, image.InternalFormat, Texture::UploadImage(image) };
+    unsigned TextureID = NewEntry.Texture.Get();
+    sEntries.emplace(TextureID, std::move(NewEntry));
+    sPathTextures[path] = TextureID;
+    sContentTextures[image.Hash] = TextureID;
+    ++sStats.Misses;
+    sStats.BytesLoaded += Bytes;
+    std::cout << "Loaded texture: " << path << " (" << image.Width << "x" << image.Height << (image.InternalFormat ? ", baked" : "")
+        << ") decode " << image.DecodeMs << " ms, " << Bytes / 1024 << " KB" << std::endl;
+    return TextureID;
+}
+
+void
+TextureCache::Release(unsigned texture) {
+    auto It = sEntries.find(texture);
+    if (It == sEntries.end() || --It->second.RefCount > 0) {
+        return;
+    }
+
+    for (auto PathIt = sPathTextures.begin(); PathIt != sPathTextures.end();) {
+        PathIt = PathIt->second == texture ? sPathTextures.erase(PathIt) : ++PathIt;
+    }
+    // NOTE: After a hash collision the hash maps to the newer texture, leave that one alone
+    auto ContentIt = sContentTextures.find(It->second.Hash);
+    if (ContentIt != sContentTextures.end() && ContentIt->second == texture) {
+        sContentTextures.erase(ContentIt);
+    }
+    sEntries.erase(It);
+}
+
+bool
+TextureCache::matchesImage(const Entry& entry, const Texture::Image& image) {
+    if (entry.Width != image.Width || entry.Height != image.Height || entry.Channels != image.Channels
+        || entry.InternalFormat != image.InternalFormat) {
+        return false;
+    }
+
+    // NOTE: Hashes can collide, so the hashed bytes are read back from level 0 and compared.
+    // Only runs on content hits, which happen at load time
+    const unsigned char* Data = image.InternalFormat ? image.LevelData[0] : image.Data;
+    size_t Size = image.InternalFormat ? image.LevelSizes[0] : (size_t)image.Width * image.Height * image.Channels;
+    std::vector<unsigned char> Pixels(Size);
+    GLState::BindTexture(0, entry.Texture.Get());
+    if (image.InternalFormat && image.Format == 0) {
+        GLint CompressedSize = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &CompressedSize);
+        if ((size_t)CompressedSize != Size) {
+            return false;
+        }
+        glGetCompressedTexImage(GL_TEXTURE_2D, 0, Pixels.data());
+    } else {
+        // NOTE: Baked levels keep rows aligned to 4 bytes, decoded pixels are tightly packed
+        GLenum Format = image.InternalFormat ? image.Format : Texture::GetPixelFormat(image.Channels);
+        glPixelStorei(GL_PACK_ALIGNMENT, image.InternalFormat ? 4 : 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, Format, GL_UNSIGNED_BYTE, Pixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+    return memcmp(Pixels.data(), Data, Size) == 0;
+}
+
+void
+TextureCache::AddReference(unsigned texture) {
+    auto It = sEntries.find(texture);
+    if (It != sEntries.end()) {
+        ++It->second.RefCount;
+    }
+}
+
+unsigned
+TextureCache::GetMissingTexture() {
+    if (sMissingTexture.Get()) {
+        return sMissingTexture.Get();
+    }
+
+    Texture::Image Missing;
+    if (Texture::DecodeImage(MISSING_TEXTURE_PATH, Missing)) {
+        sMissingTexture = Texture::UploadImage(Missing);
+        Texture::FreeImage(Missing);
+        return sMissingTexture.Get();
+    }
+
+    // NOTE: Missing texture is missing as well, fall back to a magenta/black checkerboard
+    // instead of recursing forever
+    const int Size = 8;
+    std::vector<unsigned char> Pixels(Size * Size * 3);
+    for (int Y = 0; Y < Size; ++Y) {
+        for (int X = 0; X < Size; ++X) {
+            unsigned char Value = ((X / 2 + Y / 2) % 2) ? 255 : 0;
+            unsigned char* Pixel = &Pixels[(Y * Size + X) * 3];
+            Pixel[0] = Value;
+            Pixel[1] = 0;
+            Pixel[2] = Value;
+        }
+    }
+    Missing.Path = MISSING_TEXTURE_PATH;
+    Missing.Data = Pixels.data();
+    Missing.Width = Size;
+    Missing.Height = Size;
+    Missing.Channels = 3;
+    sMissingTexture = Texture::UploadImage(Missing);
+    return sMissingTexture.Get();
+}
+
+void
+TextureCache::Shutdown() {
+    sMissingTexture.Reset();
+}
+
+void
+TextureCache::PrintStats() {
+    std::cout << "Texture cache: " << sEntries.size() << " textures, "
+        << sStats.Misses << " misses, " << sStats.PathHits << " path hits, "
+        << sStats.ContentHits << " content hits, "
+        << sStats.BytesLoaded / 1024 << " KB texture memory, "
+        << sStats.BytesSaved / 1024 << " KB saved" << std::endl;
+}
+
+std::string
+TextureCache::NormalizePath(const std::string& filePath) {
+    std::vector<std::string> Segments;
+    std::string Segment;
+    bool Absolute = !filePath.empty() && (filePath[0] == '/' || filePath[0] == '\\');
+    for (size_t Idx = 0; Idx <= filePath.size(); ++Idx) {
+        char C = Idx < filePath.size() ? filePath[Idx] : '/';
+        if (C != '/' && C != '\\') {
+            Segment += C;
+            continue;
+        }
+
+        if (Segment == "..") {
+            if (!Segments.empty() && Segments.back() != "..") {
+                Segments.pop_back();
+            } else {
+                Segments.push_back(Segment);
+            }
+        } else if (!Segment.empty() && Segment != ".") {
+            Segments.push_back(Segment);
+        }
+        Segment.clear();
+    }
+
+    std::string Normalized = Absolute ? "/" : "";
+    for (size_t Idx = 0; Idx < Segments.size(); ++Idx) {
+        Normalized += (Idx ? "/" : "") + Segments[Idx];
+    }
+    return Normalized;
+}
+
+uint64_t
+TextureCache::HashImage(const Texture::Image& image) {
+    // NOTE: FNV-1a over 64-bit words, good enough to tell textures apart
+    const uint64_t Prime = 0x100000001B3ull;
+    uint64_t Hash = 0xCBF29CE484222325ull;
+    Hash = (Hash ^ (uint64_t)image.Width) * Prime;
+    Hash = (Hash ^ (uint64_t)image.Height) * Prime;
+    Hash = (Hash ^ (uint64_t)image.Channels) * Prime;
+    Hash = (Hash ^ (uint64_t)image.InternalFormat) * Prime;
+
+    // NOTE: Baked images are hashed by their level 0 data, decoded images by their pixels
+    const unsigned char* Data = image.InternalFormat ? image.LevelData[0] : image.Data;
+    size_t Size = image.InternalFormat ? image.LevelSizes[0] : (size_t)image.Width * image.Height * image.Channels;
+    size_t Idx = 0;
+    for (; Idx + 8 <= Size; Idx += 8) {
+        uint64_t Word;
+        memcpy(&Word, Data + Idx, sizeof(Word));
+        Hash = (Hash ^ Word) * Prime;
+    }
+    for (; Idx < Size; ++Idx) {
+        Hash = (Hash ^ Data[Idx]) * Prime;
+    }
+    return Hash;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file texturecache.hpp
+ * @brief Reference counted texture registry shared by all meshes and models
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <iostream>
+#include "texture.hpp"
+
+class TextureCache {
+public:
+	/**
+	 * @brief Owns one reference to a shared texture and releases it when destroyed. Move-only.
+	 * Releasing 0 or the missing texture does nothing, so both are safe to hold
+	 *
+	 */
+	class Reference {
+	public:
+		Reference() : mTexture(0) {}
+		explicit Reference(unsigned texture) : mTexture(texture) {}
+		Reference(Reference&& other);
+		Reference& operator=(Reference&& other);
+		Reference(const Reference&) = delete;
+		Reference& operator=(const Reference&) = delete;
+		~Reference();
+
+		/**
+		 * @brief Gets the referenced texture
+		 *
+		 * @returns TextureID, 0 for empty references
+		 */
+		unsigned Get() const { return mTexture; }
+
+	private:
+		unsigned mTexture;
+	};
+
+	/**
+	 * @brief Returns a shared texture for the image file, loading it on first use.
+	 * Textures are deduplicated by normalized path first and by decoded content second.
+	 * Every Acquire should be paired with a Release
+	 *
+	 * @param filePath Image file path
+	 * @returns TextureID, the missing texture if loading failed
+	 */
+	static unsigned Acquire(const std::string& filePath);
+
+	/**
+	 * @brief Acquire for a batch of image files. Images which aren't cached yet are
+	 * decoded in parallel (see Texture::LoadImagesToTextures)
+	 *
+	 * @param filePaths Image file paths
+	 * @returns TextureIDs, in the same order as filePaths
+	 */
+	static std::vector<unsigned> AcquireBatch(const std::vector<std::string>& filePaths);
+
+	/**
+	 * @brief Acquire for an image decoded elsewhere (see AssetStreamer). Uploads it unless
+	 * the path or the content is already cached. The caller still frees the image
+	 *
+	 * @param filePath Image file path
+	 * @param image Decoded image, Data is 0 if decoding failed
+	 * @returns TextureID, the missing texture if decoding failed
+	 */
+	static unsigned AcquireDecoded(const std::string& filePath, Texture::Image& image);
+
+	/**
+	 * @brief Drops a reference to a shared texture. The GL texture is deleted
+	 * once nothing references it anymore
+	 *
+	 * @param texture TextureID returned by Acquire
+	 */
+	static void Release(unsigned texture);
+
+	/**
+	 * @brief Takes another reference to a texture returned by Acquire, for callers
+	 * handing one texture to several owners
+	 *
+	 * @param texture TextureID returned by Acquire
+	 */
+	static void AddReference(unsigned texture);
+
+	/**
+	 * @brief Returns the fallback texture used for images which failed to load.
+	 * Created once, lives as long as the GL context
+	 *
+	 * @returns TextureID
+	 */
+	static unsigned GetMissingTexture();
+
+	/**
+	 * @brief Deletes the missing texture. Call before GLResources::Shutdown, once every
+	 * Reference is gone. Textures still referenced at that point are reported as leaks
+	 *
+	 */
+	static void Shutdown();
+
+	/**
+	 * @brief Prints hit/miss counts and bytes saved by deduplication
+	 *
+	 */
+	static void PrintStats();
+
+	/**
+	 * @brief Normalizes separators, "." and ".." path segments
+	 *
+	 * @param filePath File path
+	 * @returns Normalized path
+	 */
+	static std::string NormalizePath(const std::string& filePath);
+
+	/**
+	 * @brief Hashes decoded image dimensions and pixels
+	 *
+	 * @param image Decoded image
+	 * @returns 64-bit content hash
+	 */
+	static uint64_t HashImage(const Texture::Image& image);
+
+private:
+	struct Entry {
+		unsigned RefCount;
+		uint64_t Hash;
+		size_t Bytes;
+		int Width;
+		int Height;
+		int Channels;
+		unsigned InternalFormat;
+		GLTexture Texture;
+	};
+
+	struct Stats {
+		unsigned PathHits;
+		unsigned ContentHits;
+		unsigned Misses;
+		size_t BytesLoaded;
+		size_t BytesSaved;
+	};
+
+	static std::unordered_map<std::string, unsigned> sPathTextures;
+	static std::unordered_map<uint64_t, unsigned> sContentTextures;
+	static std::unordered_map<unsigned, Entry> sEntries;
+	static GLTexture sMissingTexture;
+	static Stats sStats;
+
+	static bool acquireCached(const std::string& path, unsigned& texture);
+	static unsigned acquireDecoded(const std::string& path, Texture::Image& image);
+	static bool matchesImage(const Entry& entry, const Texture::Image& image);
+};
@@ -0,0 +1,271 @@
+#include "vertexcache.hpp"
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// NOTE: Forsyth's scoring constants, see "Linear-Speed Vertex Cache Optimisation"
+static const unsigned FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+static const unsigned INVALID_INDEX = 0xFFFFFFFF;
+
+static float
+vertexScore(int cachePosition, unsigned liveTriangles) {
+    if (liveTriangles == 0) {
+        return -1.0f;
+    }
+
+    float Score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // NOTE: Vertices of the last triangle get a fixed score so the algorithm
+            // doesn't prefer reusing them over and over again
+            Score = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float Scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            Score = std::pow(1.0f - (cachePosition - 3) * Scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // NOTE: Boost vertices with few triangles left so they don't get stranded
+    Score += FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)liveTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    return Score;
+}
+
+VertexCache::Stats
+VertexCache::Analyze(const std::vector<unsigned>& indices, unsigned vertexCount) {
+    Stats Result = { 0.0f, 0.0f };
+    if (indices.empty() || vertexCount == 0) {
+        return Result;
+    }
+
+    // NOTE: Timestamp based FIFO, a vertex is in the cache if it was inserted
+    // less than SIMULATED_CACHE_SIZE misses ago
+    std::vector<unsigned> InsertedAt(vertexCount, 0);
+    unsigned Timestamp = SIMULATED_CACHE_SIZE + 1;
+    unsigned Misses = 0;
+    for (unsigned Index : indices) {
+        if (Timestamp - InsertedAt[Index] > SIMULATED_CACHE_SIZE) {
+            InsertedAt[Index] = Timestamp++;
+            ++Misses;
+        }
+    }
+
+    Result.ACMR = (float)Misses / (indices.size() / 3);
+    Result.ATVR = (float)Misses / vertexCount;
+    return Result;
+}
+
+void
+VertexCache::OptimizeVertexCache(std::vector<unsigned>& indices, unsigned vertexCount) {
+    const size_t TriangleCount = indices.size() / 3;
+    if (TriangleCount == 0) {
+        return;
+    }
+
+    // NOTE: Per vertex list of triangles which still need to be emitted
+    std::vector<unsigned> LiveTriangles(vertexCount, 0);
+    for (size_t Idx = 0; Idx < TriangleCount * 3; ++Idx) {
+        ++LiveTriangles[indices[Idx]];
+    }
+    std::vector<unsigned> AdjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned Vertex = 0; Vertex < vertexCount; ++Vertex) {
+        AdjacencyOffsets[Vertex + 1] = AdjacencyOffsets[Vertex] + LiveTriangles[Vertex];
+    }
+    std::vector<unsigned> Adjacency(TriangleCount * 3);
+    std::vector<unsigned> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+    for (size_t Idx = 0; Idx < TriangleCount * 3; ++Idx) {
+        Adjacency[Fill[indices[Idx]]++] = (unsigned)(Idx / 3);
+    }
+
+    std::vector<int> CachePositions(vertexCount, -1);
+    std::vector<float> VertexScores(vertexCount);
+    for (unsigned Vertex = 0; Vertex < vertexCount; ++Vertex) {
+        VertexScores[Vertex] = vertexScore(-1, LiveTriangles[Vertex]);
+    }
+
+    std::vector<float> TriangleScores(TriangleCount);
+    std::vector<bool> Emitted(TriangleCount, false);
+    unsigned BestTriangle = 0;
+    for (size_t Triangle = 0; Triangle < TriangleCount; ++Triangle) {
+        const unsigned* Tri = &indices[Triangle * 3];
+        TriangleScores[Triangle] = VertexScores[Tri[0]] + VertexScores[Tri[1]] + VertexScores[Tri[2]];
+        if (TriangleScores[Triangle] > TriangleScores[BestTriangle]) {
+            BestTriangle = (unsigned)Triangle;
+        }
+    }
+
+    std::vector<unsigned> Result;
+    Result.reserve(TriangleCount * 3);
+    std::vector<unsigned> Cache;
+    std::vector<unsigned> NewCache;
+    Cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    NewCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t Cursor = 0;
+
+    while (Result.size() < TriangleCount * 3) {
+        if (BestTriangle == INVALID_INDEX) {
+            // NOTE: Nothing adjacent to the cache is left, continue with the next unemitted triangle
+            while (Emitted[Cursor]) {
+                ++Cursor;
+            }
+            BestTriangle = (unsigned)Cursor;
+        }
+
+        const unsigned* Tri = &indices[BestTriangle * 3];
+        Emitted[BestTriangle] = true;
+        NewCache.clear();
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned Vertex = Tri[Corner];
+            Result.push_back(Vertex);
+            NewCache.push_back(Vertex);
+
+            unsigned* Begin = &Adjacency[AdjacencyOffsets[Vertex]];
+            unsigned* End = Begin + LiveTriangles[Vertex];
+            unsigned* Found = std::find(Begin, End, BestTriangle);
+            if (Found != End) {
+                std::swap(*Found, *(End - 1));
+                --LiveTriangles[Vertex];
+            }
+        }
+
+        for (unsigned Vertex : Cache) {
+            if (Vertex != Tri[0] && Vertex != Tri[1] && Vertex != Tri[2]) {
+                NewCache.push_back(Vertex);
+            }
+        }
+
+        for (size_t Position = 0; Position < NewCache.size(); ++Position) {
+            unsigned Vertex = NewCache[Position];
+            CachePositions[Vertex] = Position < FORSYTH_CACHE_SIZE ? (int)Position : -1;
+            VertexScores[Vertex] = vertexScore(CachePositions[Vertex], LiveTriangles[Vertex]);
+        }
+
+        BestTriangle = INVALID_INDEX;
+        float BestScore = -1.0f;
+        for (unsigned Vertex : NewCache) {
+            const unsigned* Begin = &Adjacency[AdjacencyOffsets[Vertex]];
+            for (unsigned LiveIdx = 0; LiveIdx < LiveTriangles[Vertex]; ++LiveIdx) {
+                unsigned Triangle = Begin[LiveIdx];
+                const unsigned* Other = &indices[Triangle * 3];
+                float Score = VertexScores[Other[0]] + VertexScores[Other[1]] + VertexScores[Other[2]];
+                TriangleScores[Triangle] = Score;
+                if (Score > BestScore) {
+                    BestScore = Score;
+                    BestTriangle = Triangle;
+                }
+            }
+        }
+
+        if (NewCache.size() > FORSYTH_CACHE_SIZE) {
+            NewCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        Cache.swap(NewCache);
+    }
+
+    indices.swap(Result);
+}
+
+void
+VertexCache::OptimizeOverdraw(std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride) {
+    const size_t TriangleCount = indices.size() / 3;
+    const unsigned VertexCount = (unsigned)(vertices.size() / stride);
+    if (TriangleCount == 0 || VertexCount == 0) {
+        return;
+    }
+
+    // NOTE: Split the cache-optimized order into clusters at hard boundaries, i.e. where the
+    // simulated cache was flushed and all three vertices missed. Reordering whole clusters
+    // keeps the ACMR almost unchanged
+    std::vector<unsigned> ClusterStarts;
+    std::vector<unsigned> InsertedAt(VertexCount, 0);
+    unsigned Timestamp = SIMULATED_CACHE_SIZE + 1;
+    for (size_t Triangle = 0; Triangle < TriangleCount; ++Triangle) {
+        unsigned Misses = 0;
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned Vertex = indices[Triangle * 3 + Corner];
+            if (Timestamp - InsertedAt[Vertex] > SIMULATED_CACHE_SIZE) {
+                InsertedAt[Vertex] = Timestamp++;
+                ++Misses;
+            }
+        }
+        if (Triangle == 0 || Misses == 3) {
+            ClusterStarts.push_back((unsigned)Triangle);
+        }
+    }
+    ClusterStarts.push_back((unsigned)TriangleCount);
+
+    auto Position = [&](unsigned vertex) {
+        const float* P = &vertices[(size_t)vertex * stride];
+        return glm::vec3(P[0], P[1], P[2]);
+    };
+
+    glm::vec3 MeshCentroid(0.0f);
+    float MeshArea = 0.0f;
+    const size_t ClusterCount = ClusterStarts.size() - 1;
+    std::vector<glm::vec3> ClusterCentroids(ClusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> ClusterNormals(ClusterCount, glm::vec3(0.0f));
+    for (size_t Cluster = 0; Cluster < ClusterCount; ++Cluster) {
+        float ClusterArea = 0.0f;
+        for (unsigned Triangle = ClusterStarts[Cluster]; Triangle < ClusterStarts[Cluster + 1]; ++Triangle) {
+            glm::vec3 A = Position(indices[Triangle * 3]);
+            glm::vec3 B = Position(indices[Triangle * 3 + 1]);
+            glm::vec3 C = Position(indices[Triangle * 3 + 2]);
+            glm::vec3 Normal = glm::cross(B - A, C - A);
+            float Area = glm::length(Normal);
+            ClusterCentroids[Cluster] += (A + B + C) * (Area / 3.0f);
+            ClusterNormals[Cluster] += Normal;
+            ClusterArea += Area;
+        }
+        MeshCentroid += ClusterCentroids[Cluster];
+        MeshArea += ClusterArea;
+        if (ClusterArea > 0.0f) {
+            ClusterCentroids[Cluster] /= ClusterArea;
+        }
+    }
+    if (MeshArea > 0.0f) {
+        MeshCentroid /= MeshArea;
+    }
+
+    // NOTE: Clusters facing away from the mesh center are likely to occlude the rest,
+    // so they are drawn first
+    std::vector<float> SortKeys(ClusterCount);
+    std::vector<unsigned> ClusterOrder(ClusterCount);
+    for (size_t Cluster = 0; Cluster < ClusterCount; ++Cluster) {
+        float NormalLength = glm::length(ClusterNormals[Cluster]);
+        glm::vec3 Normal = NormalLength > 0.0f ? ClusterNormals[Cluster] / NormalLength : glm::vec3(0.0f);
+        SortKeys[Cluster] = glm::dot(ClusterCentroids[Cluster] - MeshCentroid, Normal);
+        ClusterOrder[Cluster] = (unsigned)Cluster;
+    }
+    std::stable_sort(ClusterOrder.begin(), ClusterOrder.end(), [&](unsigned a, unsigned b) {
+        return SortKeys[a] > SortKeys[b];
+    });
+
+    std::vector<unsigned> Result;
+    Result.reserve(indices.size());
+    for (unsigned Cluster : ClusterOrder) {
+        Result.insert(Result.end(), indices.begin() + ClusterStarts[Cluster] * 3, indices.begin() + ClusterStarts[Cluster + 1] * 3);
+    }
+    indices.swap(Result);
+}
+
+std::vector<unsigned>
+VertexCache::OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned>& indices, unsigned stride) {
+    const unsigned VertexCount = (unsigned)(vertices.size() / stride);
+    std::vector<unsigned> Remap(VertexCount, INVALID_INDEX);
+    std::vector<float> Result;
+    Result.reserve(vertices.size());
+
+    unsigned NextVertex = 0;
+    for (unsigned& Index : indices) {
+        if (Remap[Index] == INVALID_INDEX) {
+            Remap[Index] = NextVertex++;
+            Result.insert(Result.end(), vertices.begin() + (size_t)Index * stride, vertices.begin() + ((size_t)Index + 1) * stride);
+        }
+        Index = Remap[Index];
+    }
+    vertices.swap(Result);
+    return Remap;
+}
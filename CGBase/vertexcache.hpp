@@ -0,0 +1,56 @@
+/**
+ * @file vertexcache.hpp
+ * @brief Index and vertex reordering for post-transform vertex cache, overdraw and vertex fetch locality
+ *
+ */
+#pragma once
+#include <vector>
+
+class VertexCache {
+public:
+    // NOTE: FIFO size used when simulating the post-transform cache for statistics
+    static const unsigned SIMULATED_CACHE_SIZE = 16;
+
+    struct Stats {
+        float ACMR; // Average cache miss ratio - transformed vertices per triangle
+        float ATVR; // Average transformed vertex ratio - transformed vertices per unique vertex
+    };
+
+    /**
+     * @brief Simulates a FIFO post-transform cache over the index buffer
+     *
+     * @param indices Triangle indices
+     * @param vertexCount Number of vertices referenced by indices
+     * @returns ACMR and ATVR
+     */
+    static Stats Analyze(const std::vector<unsigned>& indices, unsigned vertexCount);
+
+    /**
+     * @brief Reorders triangles for vertex cache locality (Forsyth's linear-speed algorithm)
+     *
+     * @param indices Triangle indices, reordered in place
+     * @param vertexCount Number of vertices referenced by indices
+     */
+    static void OptimizeVertexCache(std::vector<unsigned>& indices, unsigned vertexCount);
+
+    /**
+     * @brief Reorders clusters of cache-optimized triangles so outward facing clusters
+     * are drawn first, reducing overdraw without destroying cache locality (Tipsify-style)
+     *
+     * @param indices Cache-optimized triangle indices, reordered in place
+     * @param vertices Interleaved vertices, position is expected in the first 3 floats
+     * @param stride Floats per vertex
+     */
+    static void OptimizeOverdraw(std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride);
+
+    /**
+     * @brief Reorders vertices in order of first use so vertex fetch walks memory linearly.
+     * Unreferenced vertices are dropped
+     *
+     * @param vertices Interleaved vertices, reordered in place
+     * @param indices Triangle indices, remapped in place
+     * @param stride Floats per vertex
+     * @returns New index of every old vertex, 0xFFFFFFFF for dropped ones. For remapping other vertex streams
+     */
+    static std::vector<unsigned> OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned>& indices, unsigned stride);
+};
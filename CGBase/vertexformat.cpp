@@ -0,0 +1,150 @@
+#include "vertexformat.hpp"
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+
+// NOTE: Quantized values are uploaded as plain (non-normalized) shorts and the 1/32767 is
+// folded into the dequantization. Normalized signed conversion differs between GL 3.3 and 4.2+
+static const float SNORM16_MAX = 32767.0f;
+
+static int16_t
+quantizeSnorm16(float v) {
+    return (int16_t)std::lround(glm::clamp(v, -1.0f, 1.0f) * SNORM16_MAX);
+}
+
+void
+VertexFormat::SetupFullAttributes() {
+    const GLsizei Stride = 8 * sizeof(float);
+    glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, Stride, (void*)0);
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, Stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+    glVertexAttribPointer(UV_LOCATION, 2, GL_FLOAT, GL_FALSE, Stride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(UV_LOCATION);
+}
+
+void
+VertexFormat::SetupCompactAttributes() {
+    const GLsizei Stride = sizeof(CompactVertex);
+    glVertexAttribPointer(POSITION_LOCATION, 3, GL_SHORT, GL_FALSE, Stride, (void*)offsetof(CompactVertex, Position));
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glVertexAttribPointer(NORMAL_LOCATION, 2, GL_SHORT, GL_FALSE, Stride, (void*)offsetof(CompactVertex, Normal));
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+    glVertexAttribPointer(UV_LOCATION, 2, GL_HALF_FLOAT, GL_FALSE, Stride, (void*)offsetof(CompactVertex, UV));
+    glEnableVertexAttribArray(UV_LOCATION);
+}
+
+void
+VertexFormat::SetupSkinAttributes() {
+    const GLsizei Stride = sizeof(SkinVertex);
+    // NOTE: Integer attribute, read as uvec4 in basic.vert
+    glVertexAttribIPointer(BONES_LOCATION, 4, GL_UNSIGNED_BYTE, Stride, (void*)offsetof(SkinVertex, Bones));
+    glEnableVertexAttribArray(BONES_LOCATION);
+    glVertexAttribPointer(WEIGHTS_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, Stride, (void*)offsetof(SkinVertex, Weights));
+    glEnableVertexAttribArray(WEIGHTS_LOCATION);
+}
+
+void
+VertexFormat::SetupInstanceAttributes(size_t offset) {
+    for (unsigned Column = 0; Column < 4; ++Column) {
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + Column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + Column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + Column);
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + Column, 1);
+    }
+}
+
+glm::vec2
+VertexFormat::OctEncode(const glm::vec3& n) {
+    float L1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (L1 == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+
+    glm::vec2 E(n.x / L1, n.y / L1);
+    if (n.z < 0.0f) {
+        // NOTE: Fold the lower hemisphere over the diagonals
+        glm::vec2 Folded((1.0f - std::abs(E.y)) * (E.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(E.x)) * (E.y >= 0.0f ? 1.0f : -1.0f));
+        E = Folded;
+    }
+    return E;
+}
+
+glm::vec3
+VertexFormat::OctDecode(const glm::vec2& e) {
+    glm::vec3 N(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    if (N.z < 0.0f) {
+        float X = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+        float Y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+        N.x = X;
+        N.y = Y;
+    }
+    return glm::normalize(N);
+}
+
+std::vector<VertexFormat::CompactVertex>
+VertexFormat::Compact(const float* vertices, size_t vertexCount, Quantization& quantization, Error& error) {
+    std::vector<CompactVertex> Result(vertexCount);
+    error.Position = 0.0f;
+    error.NormalDegrees = 0.0f;
+    error.UV = 0.0f;
+    if (vertexCount == 0) {
+        quantization.Scale = glm::vec3(1.0f);
+        quantization.Offset = glm::vec3(0.0f);
+        return Result;
+    }
+
+    glm::vec3 Min(vertices[0], vertices[1], vertices[2]);
+    glm::vec3 Max = Min;
+    for (size_t Idx = 0; Idx < vertexCount; ++Idx) {
+        glm::vec3 Position(vertices[Idx * 8], vertices[Idx * 8 + 1], vertices[Idx * 8 + 2]);
+        Min = glm::min(Min, Position);
+        Max = glm::max(Max, Position);
+    }
+
+    glm::vec3 Center = (Min + Max) * 0.5f;
+    glm::vec3 HalfExtent = (Max - Min) * 0.5f;
+    for (int Axis = 0; Axis < 3; ++Axis) {
+        // NOTE: Flat meshes would otherwise divide by zero
+        HalfExtent[Axis] = std::max(HalfExtent[Axis], 1e-6f);
+    }
+    quantization.Scale = HalfExtent / SNORM16_MAX;
+    quantization.Offset = Center;
+
+    for (size_t Idx = 0; Idx < vertexCount; ++Idx) {
+        const float* Src = vertices + Idx * 8;
+        CompactVertex& Dst = Result[Idx];
+        glm::vec3 Position(Src[0], Src[1], Src[2]);
+        glm::vec3 Normal(Src[3], Src[4], Src[5]);
+
+        glm::vec3 Decoded;
+        for (int Axis = 0; Axis < 3; ++Axis) {
+            Dst.Position[Axis] = quantizeSnorm16((Position[Axis] - Center[Axis]) / HalfExtent[Axis]);
+            Decoded[Axis] = Dst.Position[Axis] * quantization.Scale[Axis] + quantization.Offset[Axis];
+        }
+        Dst.Position[3] = 0;
+        error.Position = std::max(error.Position, glm::length(Decoded - Position));
+
+        float NormalLength = glm::length(Normal);
+        if (NormalLength > 0.0f) {
+            Normal /= NormalLength;
+        }
+        glm::vec2 Encoded = OctEncode(Normal);
+        Dst.Normal[0] = quantizeSnorm16(Encoded.x);
+        Dst.Normal[1] = quantizeSnorm16(Encoded.y);
+        if (NormalLength > 0.0f) {
+            glm::vec3 DecodedNormal = OctDecode(glm::vec2(Dst.Normal[0] / SNORM16_MAX, Dst.Normal[1] / SNORM16_MAX));
+            float Angle = std::acos(glm::clamp(glm::dot(DecodedNormal, Normal), -1.0f, 1.0f));
+            error.NormalDegrees = std::max(error.NormalDegrees, glm::degrees(Angle));
+        }
+
+        for (int Component = 0; Component < 2; ++Component) {
+            Dst.UV[Component] = glm::packHalf1x16(Src[6 + Component]);
+            float DecodedUV = glm::unpackHalf1x16(Dst.UV[Component]);
+            error.UV = std::max(error.UV, std::abs(DecodedUV - Src[6 + Component]));
+        }
+    }
+
+    return Result;
+}
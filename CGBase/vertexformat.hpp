@@ -0,0 +1,116 @@
+/**
+ * @file vertexformat.hpp
+ * @brief Vertex attribute layouts: full float and compact quantized
+ *
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class VertexFormat {
+public:
+    static const unsigned POSITION_LOCATION = 0;
+    static const unsigned NORMAL_LOCATION = 1;
+    static const unsigned UV_LOCATION = 2;
+    static const unsigned BONES_LOCATION = 3;
+    static const unsigned WEIGHTS_LOCATION = 4;
+    static const unsigned MAX_BONE_INFLUENCES = 4;
+    // NOTE: Per-instance model matrix, one vec4 column per location from here on
+    static const unsigned INSTANCE_MODEL_LOCATION = 5;
+
+    /**
+     * @brief 16 byte vertex: 16-bit position relative to the mesh AABB, octahedral
+     * encoded 2x16-bit normal and half float UV. Dequantized in basic.vert
+     *
+     */
+    struct CompactVertex {
+        int16_t Position[4];
+        int16_t Normal[2];
+        uint16_t UV[2];
+    };
+
+    /**
+     * @brief 8 byte skinning vertex, uploaded as a separate stream next to the full or compact
+     * layout: indices of up to 4 bones and their weights as unorm8, summing to 255
+     *
+     */
+    struct SkinVertex {
+        uint8_t Bones[MAX_BONE_INFLUENCES];
+        uint8_t Weights[MAX_BONE_INFLUENCES];
+    };
+
+    /**
+     * @brief Dequantization parameters, Position = Quantized * Scale + Offset
+     *
+     */
+    struct Quantization {
+        glm::vec3 Scale;
+        glm::vec3 Offset;
+    };
+
+    /**
+     * @brief Largest error introduced by quantization
+     *
+     */
+    struct Error {
+        float Position;
+        float NormalDegrees;
+        float UV;
+    };
+
+    /**
+     * @brief Sets up attribute pointers for the full float layout (position 3f, normal 3f, UV 2f)
+     * on the currently bound VAO and GL_ARRAY_BUFFER
+     *
+     */
+    static void SetupFullAttributes();
+
+    /**
+     * @brief Sets up attribute pointers for CompactVertex on the currently bound VAO and GL_ARRAY_BUFFER
+     *
+     */
+    static void SetupCompactAttributes();
+
+    /**
+     * @brief Sets up attribute pointers for SkinVertex on the currently bound VAO and GL_ARRAY_BUFFER
+     *
+     */
+    static void SetupSkinAttributes();
+
+    /**
+     * @brief Sets up a per-instance mat4 model matrix on the currently bound VAO and GL_ARRAY_BUFFER,
+     * advancing once per instance
+     *
+     * @param offset Byte offset of the first instance's matrix in the buffer
+     */
+    static void SetupInstanceAttributes(size_t offset = 0);
+
+    /**
+     * @brief Quantizes full float vertices into the compact layout
+     *
+     * @param vertices Interleaved position/normal/UV vertices
+     * @param vertexCount Number of vertices
+     * @param quantization Output dequantization parameters
+     * @param error Output largest quantization error
+     * @returns Compact vertices
+     */
+    static std::vector<CompactVertex> Compact(const float* vertices, size_t vertexCount, Quantization& quantization, Error& error);
+
+    /**
+     * @brief Octahedral normal encoding, maps a unit vector onto [-1, 1]^2
+     *
+     * @param n Unit normal
+     * @returns Encoded normal
+     */
+    static glm::vec2 OctEncode(const glm::vec3& n);
+
+    /**
+     * @brief Inverse of OctEncode, matches octDecode in basic.vert
+     *
+     * @param e Encoded normal
+     * @returns Unit normal
+     */
+    static glm::vec3 OctDecode(const glm::vec2& e);
+};